@@ -678,6 +678,7 @@ public indirect enum PythonError: LocalizedError {
     case ImportError(PythonConvertible)
     case AssertionError(PythonConvertible)
     case KeyError(PythonConvertible)
+    case MemoryError(PythonConvertible)
     case StopIteration(PythonConvertible)
     case BaseException(PythonConvertible)
     
@@ -702,6 +703,7 @@ public indirect enum PythonError: LocalizedError {
         case let .ImportError(value): value
         case let .AssertionError(value): value
         case let .KeyError(value): value
+        case let .MemoryError(value): value
         case let .StopIteration(value): value
         case let .BaseException(value): value
         }
@@ -730,6 +732,7 @@ public indirect enum PythonError: LocalizedError {
         case .ImportError: .ImportError
         case .AssertionError: .AssertionError
         case .KeyError: .KeyError
+        case .MemoryError: .MemoryError
         case .StopIteration: .StopIteration
         case .BaseException: .BaseException
         }
@@ -778,6 +781,7 @@ extension PythonError: PythonConvertible {
         case .ImportError: .ImportError(value)
         case .AssertionError: .AssertionError(value)
         case .KeyError: .KeyError(value)
+        case .MemoryError: .MemoryError(value)
 
         case .StopIteration: .StopIteration(value)
         default: .BaseException(value)
@@ -42,6 +42,7 @@ public extension PyType {
     static let ImportError = PyType(tp_ImportError.rawValue)
     static let AssertionError = PyType(tp_AssertionError.rawValue)
     static let KeyError = PyType(tp_KeyError.rawValue)
+    static let MemoryError = PyType(tp_MemoryError.rawValue)
     static let StopIteration = PyType(tp_StopIteration.rawValue)
 
     // MARK: - Convenient extensions.
@@ -41,11 +41,47 @@
 #define PK_ENABLE_MIMALLOC          0                
 #endif
 
+// Use a 16-byte `py_TValue` instead of the default 24-byte one.
+// `vec3`, `vec3i` and `vec4i` become heap objects and inline strings are limited to 7 bytes.
+#ifndef PK_ENABLE_COMPACT_TVALUE    // can be overridden by cmake
+#define PK_ENABLE_COMPACT_TVALUE    0
+#endif
+
+// Lay out `dict` as a Swiss table: 16 one-byte hash tags are probed at a time with SIMD
+// (scalar loop without SSE2/NEON). Set to 0 to use linear probing over the index array.
+#ifndef PK_ENABLE_SWISS_DICT        // can be overridden by cmake
+#define PK_ENABLE_SWISS_DICT        1
+#endif
+
 // GC min threshold
 #ifndef PK_GC_MIN_THRESHOLD         // can be overridden by cmake
     #define PK_GC_MIN_THRESHOLD     20000
 #endif
 
+// Number of completely empty arenas each small-object pool keeps after a sweep.
+// Extra empty arenas are returned to the allocator, retained ones are decommitted.
+#ifndef PK_GC_RETAINED_ARENAS       // can be overridden by cmake
+    #define PK_GC_RETAINED_ARENAS   2
+#endif
+
+// Slices, `split` and `strip` results of at least this many bytes, and at least 1/8 of
+// their parent string, reference the parent instead of copying it. Set to 0 to always copy.
+#ifndef PK_STR_VIEW_MIN_SIZE        // can be overridden by cmake
+    #define PK_STR_VIEW_MIN_SIZE    64
+#endif
+
+// `a + b` on strings producing at least this many bytes builds a rope that is flattened on
+// first read, so repeated `s += piece` is linear. Set to 0 to always copy.
+#ifndef PK_STR_ROPE_MIN_SIZE        // can be overridden by cmake
+    #define PK_STR_ROPE_MIN_SIZE    256
+#endif
+
+// Non-ASCII heap strings of at least this many bytes reserve a sparse code point index, so
+// that indexing and slicing them is O(1) amortized. It costs 1/16 of the string size.
+#ifndef PK_STR_INDEX_MIN_SIZE       // can be overridden by cmake
+    #define PK_STR_INDEX_MIN_SIZE   512
+#endif
+
 // This is the maximum size of the value stack in py_TValue units
 // The actual size in bytes equals `sizeof(py_TValue) * PK_VM_STACK_SIZE`
 #ifndef PK_VM_STACK_SIZE            // can be overridden by cmake
@@ -364,6 +400,37 @@ PK_API void py_sys_setargv(int argc, char** argv);
 PK_API void py_sys_settrace(py_TraceFunc func, bool reset);
 /// Invoke the garbage collector.
 PK_API int py_gc_collect();
+/// Invoke the garbage collector and return all empty arenas to the allocator.
+/// Returns the number of bytes released.
+PK_API size_t py_gc_shrink();
+/// Cumulative garbage collector statistics of the current VM.
+/// Durations are in nanoseconds, percentiles are estimated from histograms.
+typedef struct py_GCStats {
+    int64_t collections;       // all collections
+    int64_t auto_collections;  // collections triggered by the threshold
+    int64_t small_freed;       // objects freed from pools
+    int64_t large_freed;       // objects freed from the large object space
+    int64_t mark_ns_total;
+    int64_t mark_ns_p50;
+    int64_t mark_ns_p99;
+    int64_t mark_ns_max;
+    int64_t sweep_ns_total;
+    int64_t sweep_ns_p50;
+    int64_t sweep_ns_p99;
+    int64_t sweep_ns_max;
+    int64_t threshold_raised;   // automatic threshold adjustments upwards
+    int64_t threshold_lowered;  // automatic threshold adjustments downwards
+    int gc_threshold;           // current threshold
+} py_GCStats;
+
+/// Get the garbage collector statistics of the current VM.
+PK_API void py_gc_stats(py_GCStats* out);
+/// Get the number of objects of `type` freed by the garbage collector so far.
+PK_API int64_t py_gc_freedcount(py_Type type);
+/// Limit the memory the current VM may allocate for objects and container buffers.
+/// An emergency collection is triggered near the limit and `MemoryError` is raised above it.
+/// @param bytes hard limit in bytes, `0` means unlimited.
+PK_API void py_setmemorylimit(size_t bytes);
 
 /// Wrapper for `PK_MALLOC(size)`.
 PK_API void* py_malloc(size_t size);
@@ -880,6 +947,7 @@ PK_API bool py_raise(py_Ref) PY_RAISE;
 #define TypeError(...) py_exception(tp_TypeError, __VA_ARGS__)
 #define RuntimeError(...) py_exception(tp_RuntimeError, __VA_ARGS__)
 #define TimeoutError(...) py_exception(tp_TimeoutError, __VA_ARGS__)
+#define MemoryError(...) py_exception(tp_MemoryError, __VA_ARGS__)
 #define OSError(...) py_exception(tp_OSError, __VA_ARGS__)
 #define ValueError(...) py_exception(tp_ValueError, __VA_ARGS__)
 #define IndexError(...) py_exception(tp_IndexError, __VA_ARGS__)
@@ -1131,6 +1199,43 @@ enum py_PredefinedType {
     tp_array2d,
     tp_array2d_view,
     tp_chunked_array2d,
+    /* collections */
+    tp_deque,
+    tp_deque_iterator,
+    tp_Counter,
+    tp_defaultdict,
+    /* functools */
+    tp_lru_cache_wrapper,
+    tp_CacheInfo,
+    tp_partial,  // 3 slots (func, args, flat keyword pairs)
+    /* itertools */
+    tp_itertools_chain,
+    tp_itertools_islice,
+    tp_itertools_count,
+    tp_itertools_repeat,
+    tp_itertools_cycle,
+    tp_itertools_product,
+    tp_itertools_permutations,
+    tp_itertools_combinations,
+    tp_itertools_groupby,
+    tp_itertools_grouper,
+    tp_itertools_accumulate,
+    tp_itertools_takewhile,
+    tp_itertools_dropwhile,
+    tp_itertools_pairwise,
+    /* operator */
+    tp_operator_itemgetter,
+    tp_operator_attrgetter,
+    tp_operator_methodcaller,
+    tp_MemoryError,
+    tp_member_descriptor,  // __slots__ entry, userdata: name + slot index
+    tp_set,                // Dict with None values
+    tp_frozenset,          // Dict with None values
+    tp_map,                // 1 + N slots (function, iterators)
+    tp_filter,             // 2 slots (function, iterator)
+    tp_zip,                // N slots (iterators)
+    tp_enumerate,          // 1 slot (iterator) + py_i64 counter
+    tp_reversed,           // 1 slot (sequence) + py_i64 index
 };
 
 #ifndef PK_IS_AMALGAMATED_C
@@ -1147,7 +1252,11 @@ typedef struct py_TValue {
         py_CFunction _cfunc;
         void* _obj;
         void* _ptr;
+#if PK_ENABLE_COMPACT_TVALUE
+        char _chars[8];
+#else
         char _chars[16];
+#endif
     };
 } py_TValue;
 #endif
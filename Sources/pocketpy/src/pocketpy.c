@@ -16,6 +16,14 @@ bool tuple_iterator__next__(int argc, py_Ref argv);
 bool dict_items__next__(int argc, py_Ref argv);
 bool range_iterator__next__(int argc, py_Ref argv);
 bool str_iterator__next__(int argc, py_Ref argv);
+bool map__next__(int argc, py_Ref argv);
+bool filter__next__(int argc, py_Ref argv);
+bool zip__next__(int argc, py_Ref argv);
+bool enumerate__next__(int argc, py_Ref argv);
+bool reversed__next__(int argc, py_Ref argv);
+bool deque_iterator__next__(int argc, py_Ref argv);
+// `argv` holds `argc` positional arguments followed by `kwargc` [name, value] pairs
+bool lru_cache_wrapper__vectorcall(py_Ref self, int argc, int kwargc, py_Ref argv);
 // interpreter/modules.h
 
 
@@ -26,6 +34,8 @@ void pk__add_module_io();
 void pk__add_module_math();
 void pk__add_module_dis();
 void pk__add_module_random();
+void pk__add_module_heapq();
+void pk__add_module_bisect();
 void pk__add_module_json();
 void pk__add_module_gc();
 void pk__add_module_time();
@@ -42,6 +52,10 @@ void pk__add_module_stdc();
 void pk__add_module_vmath();
 void pk__add_module_array2d();
 void pk__add_module_colorcvt();
+void pk__add_module_collections();
+void pk__add_module_functools();
+void pk__add_module_itertools();
+void pk__add_module_operator();
 
 void pk__add_module_conio();
 void pk__add_module_lz4();
@@ -86,12 +100,18 @@ typedef struct py_TValue {
         PyObject* _obj;
         c11_vec2 _vec2;
         c11_vec2i _vec2i;
+#if !PK_ENABLE_COMPACT_TVALUE
         c11_vec3 _vec3;
         c11_vec3i _vec3i;
         c11_vec4i _vec4i;
+#endif
         c11_color32 _color32;
         void* _ptr;
+#if PK_ENABLE_COMPACT_TVALUE
+        char _chars[8];
+#else
         char _chars[16];
+#endif
     };
 } py_TValue;
 
@@ -103,25 +123,58 @@ typedef struct NameDict_KV {
     py_TValue value;
 } NameDict_KV;
 
+// A shape (hidden class) is an ordered list of keys shared by all instance dicts
+// that received the same attributes in the same order.
+// Shapes of a type form a transition tree rooted at an empty shape.
+typedef struct Shape {
+    struct Shape* parent;
+    struct Shape* first_child;
+    struct Shape* next_sibling;
+    int num_children;
+    int num_shapes;       // size of the whole tree, only kept by the root
+    int expected_length;  // max length of this shape and its descendants
+    int length;
+    py_Name keys[];
+} Shape;
+
+#define kShapeMaxLength 32
+#define kShapeMaxChildren 16
+#define kShapeMaxCount 1024  // per type, shape trees live as long as the vm
+
+Shape* Shape__new_root();
+void Shape__delete_tree(Shape* self);
+int Shape__index(Shape* self, py_Name key);
+
 // https://github.com/pocketpy/pocketpy/blob/v1.x/include/pocketpy/namedict.h
+// hash mode: `shape == NULL`, open addressing over `items`
+// shape mode: `shape != NULL`, `values[i]` belongs to `shape->keys[i]`
+// frozen mode: `shape == NULL && critical_size < 0`, perfect hashing over `items`
 typedef struct NameDict {
     int length;
-    float load_factor;
     int capacity;
+    float load_factor;
     int critical_size;
-    uintptr_t mask;
-    NameDict_KV* items;
+    Shape* shape;
+
+    union {
+        NameDict_KV* items;
+        py_TValue* values;
+    };
 } NameDict;
 
 NameDict* NameDict__new(float load_factor);
 void NameDict__delete(NameDict* self);
 void NameDict__ctor(NameDict* self, float load_factor);
+void NameDict__ctor_shaped(NameDict* self, Shape* root);
 void NameDict__dtor(NameDict* self);
 py_TValue* NameDict__try_get(NameDict* self, py_Name key);
 bool NameDict__contains(NameDict* self, py_Name key);
 void NameDict__set(NameDict* self, py_Name key, py_TValue* value);
 bool NameDict__del(NameDict* self, py_Name key);
 void NameDict__clear(NameDict* self);
+bool NameDict__next(NameDict* self, int* i, py_Name* key, py_TValue** value);
+size_t NameDict__buffer_size(NameDict* self);
+void NameDict__freeze(NameDict* self);
 // objects/object.h
 
 
@@ -162,16 +215,13 @@ void PyObject__dtor(PyObject* self);
 
 const char* load_kPythonLib(const char* name);
 
-extern const char kPythonLibs_bisect[];
 extern const char kPythonLibs_builtins[];
 extern const char kPythonLibs_cmath[];
 extern const char kPythonLibs_collections[];
 extern const char kPythonLibs_dataclasses[];
 extern const char kPythonLibs_datetime[];
 extern const char kPythonLibs_functools[];
-extern const char kPythonLibs_heapq[];
 extern const char kPythonLibs_linalg[];
-extern const char kPythonLibs_operator[];
 extern const char kPythonLibs_typing[];
 
 // common/_log_spline_tbl.h
@@ -4585,6 +4635,15 @@ void c11_thrdpool__join(c11_thrdpool* pool);
 
 #define PK_REGION(name) 1
 
+// 16-byte vectors for byte scanning, code without them falls back to scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define PK_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PK_SIMD_NEON 1
+#endif
+
 #define PK_SLICE_LOOP(i, start, stop, step)                                                        \
     for(int i = start; step > 0 ? i < stop : i > stop; i += step)
 
@@ -4669,12 +4728,12 @@ typedef struct RefCounted {
     } while(0)
 
 /**
- * @brief Sorts an array of elements of the same type, using the given comparison function.
+ * @brief Stably sorts an array of elements of the same type with Timsort.
  * @param ptr Pointer to the first element of the array.
- * @param count Number of elements in the array.
+ * @param length Number of elements in the array.
  * @param elem_size Size of each element in the array.
- * @param cmp Comparison function that takes two elements and returns an integer similar to
- * `strcmp`.
+ * @param f_lt Comparison function that returns 1 if `a < b`, 0 if not and -1 on error.
+ * @return false if `f_lt` failed, the array is then left as some permutation of the input.
  */
 bool c11__stable_sort(void* ptr,
                       int length,
@@ -4682,7 +4741,9 @@ bool c11__stable_sort(void* ptr,
                       int (*f_lt)(const void* a, const void* b, void* extra),
                       void* extra);
 
+
 int c11__bit_length(unsigned long x);
+int c11__ctz64(uint64_t x);
 // common/vector.h
 
 
@@ -4700,6 +4761,7 @@ void c11_vector__ctor(c11_vector* self, int elem_size);
 void c11_vector__dtor(c11_vector* self);
 c11_vector c11_vector__copy(const c11_vector* self);
 void c11_vector__reserve(c11_vector* self, int capacity);
+void c11_vector__shrink(c11_vector* self);
 void c11_vector__clear(c11_vector* self);
 void* c11_vector__emplace(c11_vector* self);
 bool c11_vector__contains(const c11_vector* self, void* elem);
@@ -4775,6 +4837,7 @@ typedef struct py_TypeInfo {
 
     bool is_python;  // is it a python class? (not derived from c object)
     bool is_final;  // can it be subclassed?
+    int instance_slots;  // inline slots of python instances, -1 if they have a __dict__
 
     bool (*getattribute)(py_Ref self, py_Name name) PY_RAISE PY_RETURN;
     bool (*setattribute)(py_Ref self, py_Name name, py_Ref val) PY_RAISE PY_RETURN;
@@ -4817,15 +4880,59 @@ typedef struct {
 
 typedef struct {
     int length;
+    uint32_t state;  // bumped on insertion, deletion and rebuild, only compared for equality
     uint32_t capacity;
+#if PK_ENABLE_SWISS_DICT
+    uint32_t growth_left;  // insertions into empty slots left before the table is rebuilt
+    bool index_is_short;
+    uint8_t* ctrl;  // | uint8_t ctrl[capacity] | uint16_t or uint32_t indices[capacity] |
+#else
     uint32_t null_index_value;
     bool index_is_short;
     void* indices;
+#endif
     c11_vector /*T=DictEntry*/ entries;
 } Dict;
 
+size_t Dict__buffer_size(Dict* self);
+
 typedef c11_vector List;
 
+typedef struct {
+    py_TValue* data;  // ring buffer, `capacity` is a power of two
+    int capacity;
+    int head;
+    int length;
+    int maxlen;      // -1 if unbounded
+    uint32_t state;  // bumped on mutation to invalidate iterators, only compared for equality
+} Deque;
+
+typedef struct {
+    int index;
+    uint32_t state;  // `deque->state` when the iterator was created
+} DequeIterator;
+
+typedef struct {
+    uint64_t hash;
+    py_TValue key;  // the only argument, or a tuple of all arguments and keyword pairs
+    py_TValue result;
+    int size;    // number of items in `key`
+    int kwargc;  // keyword pairs at the end of `key`
+    int prev;  // neighbours in the circular LRU list
+    int next;
+} LruCacheNode;
+
+typedef struct {
+    c11_vector /*T=LruCacheNode*/ nodes;
+    int* table;    // linear probing table of node indices, -1 if empty
+    int capacity;  // of `table`, a power of two
+    int head;      // most recently used node, -1 if empty or unbounded
+    int maxsize;   // -1 if unbounded
+    bool typed;
+    py_i64 hits;
+    py_i64 misses;
+} LruCache;
+
 void c11_chunked_array2d__mark(void* ud, c11_vector* p_stack);
 void function__gc_mark(void* ud, c11_vector* p_stack);
 
@@ -5052,7 +5159,27 @@ typedef struct c11_string {
     char data[];  // flexible array member
 } c11_string;
 
+/* heap str */
+// | hash | int u8_length | int size | char[] | '\0' | int u8_index[] |
+// `u8_index` is only reserved for strings of at least PK_STR_INDEX_MIN_SIZE bytes that may
+// contain non-ASCII text, ASCII strings get their `u8_length` up front instead. It holds the byte offset of every `kStrIndexStride`-th code point and is filled
+// together with `u8_length`, so indexing non-ASCII text does not scan from the start.
+#define kStrIndexStride 64
+
+typedef struct StrHeader {
+    uint64_t hash;  // 0 if not computed yet
+    int u8_length;  // number of code points, -1 if not computed yet
+} StrHeader;
+
+int StrHeader__alloc_size(int size, bool ascii);
+c11_string* StrHeader__str(StrHeader* self);
+
 c11_string* pk_tostr(py_Ref self);
+uint64_t pk_strhash(py_Ref self);
+char* pk_newstrn(py_OutRef out, int size, bool ascii);
+void pk_newsubstr(py_OutRef out, py_Ref parent, c11_sv sv);
+void pk_newconcat(py_OutRef out, py_Ref lhs, py_Ref rhs);
+void pk_flattenstr(PyObject* obj);
 
 /* bytes */
 typedef struct c11_bytes {
@@ -5086,6 +5213,7 @@ void c11_string__delete(c11_string* self);
 c11_sv c11_string__sv(c11_string* self);
 
 int c11_sv__u8_length(c11_sv self);
+bool c11_sv__is_ascii(c11_sv self);
 c11_sv c11_sv__u8_getitem(c11_sv self, int i);
 c11_string* c11_sv__u8_slice(c11_sv self, int start, int stop, int step);
 
@@ -5134,13 +5262,15 @@ IntParsingResult c11__parse_uint(c11_sv text, int64_t* out, int base);
 
 
 #define kPoolArenaSize (120 * 1024)
-#define kMultiPoolCount 5
-// #define kPoolMaxBlockSize (32 * kMultiPoolCount)
+#define kMultiPoolCount 19
+#define kPoolMaxBlockSize 1024
 
 typedef struct PoolArena {
     int block_size;
     int block_count;
     int unused_length;
+    bool mapped;       // allocated with mmap, so its pages can be released to the OS
+    bool decommitted;  // pages were released via madvise while the arena was empty
 
     union {
         char data[kPoolArenaSize];
@@ -5158,10 +5288,13 @@ typedef struct Pool {
 
 typedef struct MultiPool {
     Pool pools[kMultiPoolCount];
+    int retained_arenas;  // max empty arenas kept per pool after sweep
+    size_t used_bytes;    // bytes of all blocks in use
 } MultiPool;
 
 void* MultiPool__alloc(MultiPool* self, int size);
 int MultiPool__sweep_dealloc(MultiPool* self, int* out_types);
+size_t MultiPool__shrink(MultiPool* self);
 void MultiPool__ctor(MultiPool* self);
 void MultiPool__dtor(MultiPool* self);
 size_t MultiPool__total_allocated_bytes(MultiPool* self);
@@ -5171,17 +5304,51 @@ c11_string* MultiPool__summary(MultiPool* self);
 
 #include <time.h>
 
+// 4 buckets per power of two nanoseconds
+#define kGCHistogramSize 192
+
+typedef struct ManagedHeapStats {
+    int64_t collections;
+    int64_t auto_collections;
+    int64_t small_freed;
+    int64_t large_freed;
+    int64_t mark_ns_total;
+    int64_t mark_ns_max;
+    int64_t sweep_ns_total;
+    int64_t sweep_ns_max;
+    uint32_t mark_ns_hist[kGCHistogramSize];
+    uint32_t sweep_ns_hist[kGCHistogramSize];
+    int64_t threshold_raised;
+    int64_t threshold_lowered;
+    c11_vector /* int64_t */ freed_types;
+    c11_vector /* int */ sweep_types;  // scratch counters: small objects, then large objects
+} ManagedHeapStats;
+
+int64_t ManagedHeapStats__percentile(const uint32_t* hist, int64_t count, int64_t max, float q);
+
 typedef struct ManagedHeap {
     MultiPool small_objects;
     c11_vector /* PyObject_p */ large_objects;
     c11_vector /* PyObject_p */ gc_roots;
     size_t large_total_size;
 
+    // freed large objects segregated by `size_8b`, linked through `flex`
+    PyObject* large_free_lists[256];
+    size_t large_cached_size;
+
+    // container buffers measured by the last mark plus growth since then
+    size_t buffer_bytes;
+    size_t memory_limit;         // 0 means unlimited
+    size_t memory_soft_trigger;  // usage that schedules an emergency collection
+    bool memory_exceeded;        // checked by the interpreter at safe points
+
     int freed_ma[3];
     int gc_threshold;  // threshold for gc_counter
     int gc_counter;    // objects created since last gc
     bool gc_enabled;
     py_TValue debug_callback;
+
+    ManagedHeapStats stats;
 } ManagedHeap;
 
 typedef struct {
@@ -5214,7 +5381,20 @@ void ManagedHeapSwpetInfo__delete(ManagedHeapSwpetInfo* self);
 
 int ManagedHeap__collect_hint(ManagedHeap* self);
 int ManagedHeap__collect(ManagedHeap* self);
-int ManagedHeap__sweep(ManagedHeap* self, ManagedHeapSwpetInfo* out_info);
+size_t ManagedHeap__shrink(ManagedHeap* self);
+
+size_t ManagedHeap__memory_usage(ManagedHeap* self);
+void ManagedHeap__set_memory_limit(ManagedHeap* self, size_t bytes);
+// account for a grown container buffer
+void ManagedHeap__account_buffer(ManagedHeap* self, size_t bytes);
+// make sure `bytes` more can be allocated, otherwise raise `MemoryError`
+bool ManagedHeap__reserve(ManagedHeap* self, size_t bytes);
+// raise `MemoryError` if the limit is still exceeded after a collection
+bool ManagedHeap__check_memory_limit(ManagedHeap* self);
+int ManagedHeap__sweep(ManagedHeap* self,
+                       int* small_types,
+                       int* large_types,
+                       ManagedHeapSwpetInfo* out_info);
 
 #define ManagedHeap__new(self, type, slots, udsize)                                                \
     ManagedHeap__gcnew((self), (type), (slots), (udsize))
@@ -6501,6 +6681,8 @@ typedef struct WatchdogInfo {
 typedef struct TypePointer {
     py_TypeInfo* ti;
     py_Dtor dtor;
+    Shape* shape;    // root shape of instance dicts, lazily created
+    py_Type layout;  // native type whose userdata layout the instances share
 } TypePointer;
 
 typedef struct py_ModuleInfo {
@@ -6578,6 +6760,15 @@ FrameResult VM__vectorcall(VM* self, uint16_t argc, uint16_t kwargc, bool opcall
 const char* pk_opname(Opcode op);
 
 int pk_arrayview(py_Ref self, py_TValue** p);
+/// Call `f` on each item of `iterable`, with fast paths for list, tuple and range.
+/// `f` returns -1 on error, 0 to stop, or 1 to continue.
+/// Returns -1 on error, 0 if `f` stopped early, or 1 if `iterable` was exhausted.
+int pk_foreach(py_Ref iterable, int (*f)(py_Ref item, void* ctx), void* ctx);
+/// Write the indices of the `n` smallest (or largest) `keys` to `out`, ordered like a stable
+/// sort. `keys` must stay reachable by the GC, as comparisons may run arbitrary code.
+bool pk_nselect(py_TValue* keys, int length, int n, bool largest, int* out);
+void pk_newset(py_OutRef out);
+bool pk_set_add(py_Ref self, py_Ref key);
 bool pk_wrapper__arrayequal(py_Type type, int argc, py_Ref argv);
 bool pk_arraycontains(py_Ref self, py_Ref val);
 
@@ -6604,6 +6795,15 @@ py_Type pk_str_iterator__register();
 py_Type pk_bytes__register();
 py_Type pk_dict__register();
 py_Type pk_dict_items__register();
+py_Type pk_set__register();
+py_Type pk_frozenset__register();
+py_Type pk_Counter__register(py_GlobalRef mod);
+py_Type pk_defaultdict__register(py_GlobalRef mod);
+py_Type pk_map__register();
+py_Type pk_filter__register();
+py_Type pk_zip__register();
+py_Type pk_enumerate__register();
+py_Type pk_reversed__register();
 py_Type pk_list__register();
 py_Type pk_tuple__register();
 py_Type pk_list_iterator__register();
@@ -6620,6 +6820,7 @@ py_Type pk_Exception__register();
 py_Type pk_StopIteration__register();
 py_Type pk_super__register();
 py_Type pk_property__register();
+py_Type pk_member_descriptor__register();
 py_Type pk_staticmethod__register();
 py_Type pk_classmethod__register();
 py_Type pk_generator__register();
@@ -6630,6 +6831,16 @@ py_GlobalRef pk_builtins__register();
 
 /* mappingproxy */
 void pk_mappingproxy__namedict(py_Ref out, py_Ref object);
+
+/* __slots__ */
+typedef struct MemberDescriptor {
+    py_Name name;
+    int index;
+} MemberDescriptor;
+
+bool pk_member__init_slots(py_TypeInfo* ti);
+int pk_member__index(py_TypeInfo* ti, py_Name name);
+void pk_member__names(py_TypeInfo* ti, py_Name* out);
 // objects/error.h
 
 
@@ -6868,22 +7079,87 @@ Error* pk_compile(SourceData_ src, CodeObject* out);
 #include <stdbool.h>
 #include <string.h>
 
+#if(defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// strict ISO C modes of glibc hide `madvise` and `MAP_ANONYMOUS`, arenas then stay committed
+#if defined(MAP_ANONYMOUS) && defined(MADV_DONTNEED)
+#define PK_HAS_MADVISE 1
+#else
+#define PK_HAS_MADVISE 0
+#endif
+
+static size_t PoolArena__size(int block_count) {
+    return sizeof(PoolArena) + sizeof(int) * block_count;
+}
+
 static PoolArena* PoolArena__new(int block_size) {
-    assert(kPoolArenaSize % block_size == 0);
+    assert(block_size % 8 == 0);
+    // the tail of `data` is unused if `block_size` does not divide `kPoolArenaSize`
     int block_count = kPoolArenaSize / block_size;
-    PoolArena* self = PK_MALLOC(sizeof(PoolArena) + sizeof(int) * block_count);
+    PoolArena* self = NULL;
+#if PK_HAS_MADVISE
+    // anonymous mappings are zero-filled and never shared with the allocator
+    void* p = mmap(NULL,
+                   PoolArena__size(block_count),
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1,
+                   0);
+    if(p != MAP_FAILED) {
+        self = p;
+        self->mapped = true;
+    }
+#endif
+    if(self == NULL) {
+        self = PK_MALLOC(PoolArena__size(block_count));
+        self->mapped = false;
+        memset(self->data, 0, kPoolArenaSize);
+    }
     self->block_size = block_size;
     self->block_count = block_count;
     self->unused_length = block_count;
+    self->decommitted = false;
     for(int i = 0; i < block_count; i++) {
         self->unused[i] = i;
     }
-    memset(self->data, 0, kPoolArenaSize);
     return self;
 }
 
+static void PoolArena__delete(PoolArena* self) {
+#if PK_HAS_MADVISE
+    if(self->mapped) {
+        munmap(self, PoolArena__size(self->block_count));
+        return;
+    }
+#endif
+    PK_FREE(self);
+}
+
+static void PoolArena__decommit(PoolArena* self) {
+    assert(self->unused_length == self->block_count);
+    if(self->decommitted || !self->mapped) return;
+#if PK_HAS_MADVISE
+    // all blocks are free (type == 0) so the pages may come back zero-filled or untouched
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = ((uintptr_t)self->data + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)self->data + kPoolArenaSize) & ~(page - 1);
+    if(end > begin) {
+#ifdef __APPLE__
+        madvise((void*)begin, end - begin, MADV_FREE);
+#else
+        madvise((void*)begin, end - begin, MADV_DONTNEED);
+#endif
+    }
+#endif
+    self->decommitted = true;
+}
+
 static void* PoolArena__alloc(PoolArena* self) {
     assert(self->unused_length > 0);
+    self->decommitted = false;
     int index = self->unused[self->unused_length - 1];
     self->unused_length--;
     return self->data + index * self->block_size;
@@ -6928,7 +7204,7 @@ static void Pool__dtor(Pool* self) {
             PyObject* obj = (PyObject*)(arena->data + i * self->block_size);
             if(obj->type != 0) PyObject__dtor(obj);
         }
-        PK_FREE(arena);
+        PoolArena__delete(arena);
     }
     c11_vector__dtor(&self->arenas);
 }
@@ -6947,12 +7223,15 @@ static void* Pool__alloc(Pool* self) {
     return ptr;
 }
 
-static int Pool__sweep_dealloc(Pool* self, int* out_types) {
+static int Pool__sweep_dealloc(Pool* self, int* out_types, int retained_arenas) {
     PoolArena** p = self->arenas.data;
 
     int freed = 0;
     for(int i = 0; i < self->arenas.length; i++) {
+        bool was_empty = p[i]->unused_length == p[i]->block_count;
         freed += PoolArena__sweep_dealloc(p[i], out_types);
+        // an arena that stayed empty for a whole gc cycle is unlikely to be needed soon
+        if(was_empty && p[i]->unused_length == p[i]->block_count) PoolArena__decommit(p[i]);
     }
 
     // move arenas with `unused_length == 0` to the front
@@ -6977,17 +7256,11 @@ static int Pool__sweep_dealloc(Pool* self, int* out_types) {
         }
     }
 
-    // free excess free arenas
-    int free_quota = self->arenas.length / 2;
-    int min_length = c11__max(free_quota, j + 1);
-    while(self->arenas.length > min_length) {
+    // free empty arenas exceeding the retention policy
+    while(self->arenas.length > k + retained_arenas) {
         PoolArena* back_arena = c11_vector__back(PoolArena*, &self->arenas);
-        if(back_arena->unused_length == back_arena->block_count) {
-            PK_FREE(back_arena);
-            c11_vector__pop(&self->arenas);
-        } else {
-            break;
-        }
+        PoolArena__delete(back_arena);
+        c11_vector__pop(&self->arenas);
     }
 
     // [[0, 0, 0, 0, 0, 1], 1, 1, 1, 2, 2]
@@ -6996,29 +7269,64 @@ static int Pool__sweep_dealloc(Pool* self, int* out_types) {
     return freed;
 }
 
+static size_t Pool__shrink(Pool* self) {
+    // arenas are ordered by `Pool__sweep_dealloc`, empty ones are at the back
+    size_t released = 0;
+    while(self->arenas.length > self->available_index) {
+        PoolArena* back_arena = c11_vector__back(PoolArena*, &self->arenas);
+        if(back_arena->unused_length != back_arena->block_count) break;
+        released += PoolArena__size(back_arena->block_count);
+        PoolArena__delete(back_arena);
+        c11_vector__pop(&self->arenas);
+    }
+    c11_vector__shrink(&self->arenas);
+    return released;
+}
+
+// block size of each pool, spaced at most 25% apart above 128 bytes
+static const int kMultiPoolBlockSizes[kMultiPoolCount] = {
+    32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024};
+
+// maps `(size - 1) >> 4` to the smallest pool that fits
+static const int8_t kMultiPoolIndex[kPoolMaxBlockSize >> 4] = {
+    0, 0, 1, 2, 3, 4, 5, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+    11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14,
+    15, 15, 15, 15, 15, 15, 15, 15, 16, 16, 16, 16, 16, 16, 16, 16,
+    17, 17, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18};
+
 void* MultiPool__alloc(MultiPool* self, int size) {
     assert(size > 0);
-    int index = (size - 1) >> 5;
-    if(index < kMultiPoolCount) {
-        Pool* pool = &self->pools[index];
-        return Pool__alloc(pool);
-    }
-    return NULL;
+    if(size > kPoolMaxBlockSize) return NULL;
+    Pool* pool = &self->pools[kMultiPoolIndex[(size - 1) >> 4]];
+    self->used_bytes += pool->block_size;
+    return Pool__alloc(pool);
 }
 
 int MultiPool__sweep_dealloc(MultiPool* self, int* out_types) {
     int freed = 0;
     for(int i = 0; i < kMultiPoolCount; i++) {
         Pool* item = &self->pools[i];
-        freed += Pool__sweep_dealloc(item, out_types);
+        int item_freed = Pool__sweep_dealloc(item, out_types, self->retained_arenas);
+        self->used_bytes -= (size_t)item_freed * item->block_size;
+        freed += item_freed;
     }
     return freed;
 }
 
+size_t MultiPool__shrink(MultiPool* self) {
+    size_t released = 0;
+    for(int i = 0; i < kMultiPoolCount; i++) {
+        released += Pool__shrink(&self->pools[i]);
+    }
+    return released;
+}
+
 void MultiPool__ctor(MultiPool* self) {
     for(int i = 0; i < kMultiPoolCount; i++) {
-        Pool__ctor(&self->pools[i], 32 * (i + 1));
+        Pool__ctor(&self->pools[i], kMultiPoolBlockSizes[i]);
     }
+    self->retained_arenas = PK_GC_RETAINED_ARENAS;
+    self->used_bytes = 0;
 }
 
 void MultiPool__dtor(MultiPool* self) {
@@ -7054,7 +7362,7 @@ c11_string* MultiPool__summary(MultiPool* self) {
         if(total_bytes == 0) used_pct = 0.0f;
         snprintf(buf,
                  sizeof(buf),
-                 "Pool %3d: len(arenas)=%d (%d full), size=%d/%d (%.1f%% used)\n",
+                 "Pool %4d: len(arenas)=%d (%d full), size=%d/%d (%.1f%% used)\n",
                  item->block_size,
                  item->arenas.length,
                  item->available_index,
@@ -7073,23 +7381,70 @@ c11_string* MultiPool__summary(MultiPool* self) {
 // src/interpreter/heap.c
 #include <assert.h>
 
-static uint8_t encode_size_8b(int size, int* out_size) {
-    int bit_length = c11__bit_length(size);
-    int min_val = 1 << (bit_length - 1);
-    int gap = min_val;
-    float ratio = (float)(size - min_val) / gap;
-    int ratio_3bit = (int)(ratio * 7.999f);
-    *out_size = min_val + (int)(gap * ((float)ratio_3bit / 7.999f));
-    return (uint8_t)((bit_length << 3) | ratio_3bit);
-}
+#define kLargeObjectCacheSize (4 * 1024 * 1024)
+#define kLargeObjectMaxCachedSize (64 * 1024)
 
 static int decode_size_8b(uint8_t byte) {
     int bit_length = byte >> 3;
     int ratio_3bit = byte & 0x07;
     int min_val = 1 << (bit_length - 1);
-    int gap = min_val;
-    float ratio = (float)ratio_3bit / 7.999f;
-    return min_val + (int)(gap * ratio);
+    return min_val + ratio_3bit * c11__max(min_val >> 3, 1);
+}
+
+// round `size` up to one of 8 size classes per power of two
+static uint8_t encode_size_8b(int size, int* out_size) {
+    int bit_length = c11__bit_length(size);
+    int min_val = 1 << (bit_length - 1);
+    int step = c11__max(min_val >> 3, 1);
+    int ratio_3bit = (size - min_val + step - 1) / step;
+    if(ratio_3bit == 8) {
+        bit_length++;
+        ratio_3bit = 0;
+    }
+    uint8_t byte = (uint8_t)((bit_length << 3) | ratio_3bit);
+    *out_size = decode_size_8b(byte);
+    return byte;
+}
+
+static PyObject* ManagedHeap__alloc_large(ManagedHeap* self, int size, uint8_t* out_size_8b) {
+    int quantized_size;
+    uint8_t size_8b = encode_size_8b(size, &quantized_size);
+    PyObject* obj = self->large_free_lists[size_8b];
+    if(obj != NULL) {
+        self->large_free_lists[size_8b] = *(PyObject**)obj->flex;
+        self->large_cached_size -= quantized_size;
+    } else {
+        obj = PK_MALLOC(quantized_size);
+    }
+    self->large_total_size += quantized_size;
+    *out_size_8b = size_8b;
+    return obj;
+}
+
+static void ManagedHeap__free_large(ManagedHeap* self, PyObject* obj) {
+    int size = decode_size_8b(obj->size_8b);
+    self->large_total_size -= size;
+    if(size <= kLargeObjectMaxCachedSize &&
+       self->large_cached_size + size <= kLargeObjectCacheSize) {
+        *(PyObject**)obj->flex = self->large_free_lists[obj->size_8b];
+        self->large_free_lists[obj->size_8b] = obj;
+        self->large_cached_size += size;
+    } else {
+        PK_FREE(obj);
+    }
+}
+
+static void ManagedHeap__release_large_cache(ManagedHeap* self) {
+    for(int i = 0; i < c11__count_array(self->large_free_lists); i++) {
+        PyObject* obj = self->large_free_lists[i];
+        while(obj != NULL) {
+            PyObject* next = *(PyObject**)obj->flex;
+            PK_FREE(obj);
+            obj = next;
+        }
+        self->large_free_lists[i] = NULL;
+    }
+    self->large_cached_size = 0;
 }
 
 void ManagedHeap__ctor(ManagedHeap* self) {
@@ -7097,6 +7452,17 @@ void ManagedHeap__ctor(ManagedHeap* self) {
     c11_vector__ctor(&self->large_objects, sizeof(PyObject*));
     c11_vector__ctor(&self->gc_roots, sizeof(PyObject*));
     self->large_total_size = 0;
+    memset(self->large_free_lists, 0, sizeof(self->large_free_lists));
+    self->large_cached_size = 0;
+
+    self->buffer_bytes = 0;
+    self->memory_limit = 0;
+    self->memory_soft_trigger = SIZE_MAX;
+    self->memory_exceeded = false;
+
+    memset(&self->stats, 0, sizeof(ManagedHeapStats));
+    c11_vector__ctor(&self->stats.freed_types, sizeof(int64_t));
+    c11_vector__ctor(&self->stats.sweep_types, sizeof(int));
 
     for(int i = 0; i < c11__count_array(self->freed_ma); i++) {
         self->freed_ma[i] = PK_GC_MIN_THRESHOLD;
@@ -7118,6 +7484,9 @@ void ManagedHeap__dtor(ManagedHeap* self) {
     }
     c11_vector__dtor(&self->large_objects);
     c11_vector__dtor(&self->gc_roots);
+    ManagedHeap__release_large_cache(self);
+    c11_vector__dtor(&self->stats.freed_types);
+    c11_vector__dtor(&self->stats.sweep_types);
 }
 
 static void ManagedHeap__fire_debug_callback_start(ManagedHeap* self) {
@@ -7194,6 +7563,138 @@ static void ManagedHeap__fire_debug_callback_stop(ManagedHeap* self,
     }
 }
 
+size_t ManagedHeap__memory_usage(ManagedHeap* self) {
+    return self->small_objects.used_bytes + self->large_total_size + self->buffer_bytes;
+}
+
+static void ManagedHeap__update_soft_trigger(ManagedHeap* self) {
+    if(self->memory_limit == 0) return;
+    // collect at 7/8 of the limit, but not again before usage grows by 1/16 of it
+    size_t soft_limit = self->memory_limit - self->memory_limit / 8;
+    size_t usage = ManagedHeap__memory_usage(self);
+    self->memory_soft_trigger = c11__max(soft_limit, usage + self->memory_limit / 16);
+}
+
+static void ManagedHeap__check_soft_limit(ManagedHeap* self) {
+    size_t usage = ManagedHeap__memory_usage(self);
+    if(usage <= self->memory_soft_trigger) return;
+    // request an emergency collection at the next safe point
+    self->gc_counter = c11__max(self->gc_counter, self->gc_threshold);
+    if(usage > self->memory_limit) self->memory_exceeded = true;
+}
+
+void ManagedHeap__set_memory_limit(ManagedHeap* self, size_t bytes) {
+    self->memory_limit = bytes;
+    self->memory_soft_trigger = SIZE_MAX;
+    self->memory_exceeded = false;
+    ManagedHeap__update_soft_trigger(self);
+}
+
+void ManagedHeap__account_buffer(ManagedHeap* self, size_t bytes) {
+    if(self->memory_limit == 0) return;
+    self->buffer_bytes += bytes;
+    ManagedHeap__check_soft_limit(self);
+}
+
+bool ManagedHeap__reserve(ManagedHeap* self, size_t bytes) {
+    if(self->memory_limit == 0) return true;
+    if(ManagedHeap__memory_usage(self) + bytes <= self->memory_limit) return true;
+    if(self->gc_enabled) ManagedHeap__collect(self);
+    if(ManagedHeap__memory_usage(self) + bytes <= self->memory_limit) return true;
+    return MemoryError("cannot allocate %i bytes, memory limit is %i bytes",
+                       (py_i64)bytes,
+                       (py_i64)self->memory_limit);
+}
+
+bool ManagedHeap__check_memory_limit(ManagedHeap* self) {
+    self->memory_exceeded = false;
+    if(self->memory_limit == 0) return true;
+    if(self->gc_enabled) ManagedHeap__collect(self);
+    if(ManagedHeap__memory_usage(self) <= self->memory_limit) return true;
+    return MemoryError("memory limit exceeded: %i bytes", (py_i64)self->memory_limit);
+}
+
+static int ManagedHeapStats__bucket(int64_t ns) {
+    if(ns < 4) return (int)c11__max(ns, 0);
+    int bit_length = c11__bit_length((unsigned long)ns);
+    int sub = (int)(ns >> (bit_length - 3)) & 3;
+    return c11__min((bit_length - 2) * 4 + sub, kGCHistogramSize - 1);
+}
+
+static int64_t ManagedHeapStats__bucket_upper(int index) {
+    if(index < 4) return index;
+    int shift = index / 4 - 1;
+    int64_t lower = (int64_t)(4 + index % 4) << shift;
+    return lower + ((int64_t)1 << shift) - 1;
+}
+
+int64_t ManagedHeapStats__percentile(const uint32_t* hist, int64_t count, int64_t max, float q) {
+    if(count == 0) return 0;
+    int64_t target = (int64_t)(q * count + 0.999999f);
+    int64_t acc = 0;
+    for(int i = 0; i < kGCHistogramSize; i++) {
+        acc += hist[i];
+        if(acc >= target) return c11__min(ManagedHeapStats__bucket_upper(i), max);
+    }
+    return max;
+}
+
+// run a mark-and-sweep cycle and record it into `self->stats` without allocating
+static int ManagedHeap__mark_and_sweep(ManagedHeap* self, ManagedHeapSwpetInfo* out_info) {
+    ManagedHeapStats* stats = &self->stats;
+    int types_length = pk_current_vm->types.length;
+    if(stats->freed_types.length < types_length) {
+        // only grows when new types are registered
+        int old_length = stats->freed_types.length;
+        c11_vector__reserve(&stats->freed_types, types_length);
+        memset((int64_t*)stats->freed_types.data + old_length,
+               0,
+               (types_length - old_length) * sizeof(int64_t));
+        stats->freed_types.length = types_length;
+        c11_vector__reserve(&stats->sweep_types, types_length * 2);
+        memset(stats->sweep_types.data, 0, types_length * 2 * sizeof(int));
+        stats->sweep_types.length = types_length * 2;
+    }
+
+    int* small_types = stats->sweep_types.data;
+    int* large_types = small_types + types_length;
+    if(out_info) {
+        small_types = out_info->small_types;
+        large_types = out_info->large_types;
+    }
+
+    int64_t start_ns = time_monotonic_ns();
+    ManagedHeap__mark(self);
+    int64_t mark_end_ns = time_monotonic_ns();
+    if(out_info) out_info->mark_end_ns = time_ns();
+    int freed = ManagedHeap__sweep(self, small_types, large_types, out_info);
+    int64_t sweep_end_ns = time_monotonic_ns();
+    if(out_info) out_info->swpet_end_ns = time_ns();
+    ManagedHeap__update_soft_trigger(self);
+
+    int64_t mark_ns = mark_end_ns - start_ns;
+    int64_t sweep_ns = sweep_end_ns - mark_end_ns;
+    stats->collections++;
+    stats->mark_ns_total += mark_ns;
+    stats->sweep_ns_total += sweep_ns;
+    stats->mark_ns_max = c11__max(stats->mark_ns_max, mark_ns);
+    stats->sweep_ns_max = c11__max(stats->sweep_ns_max, sweep_ns);
+    stats->mark_ns_hist[ManagedHeapStats__bucket(mark_ns)]++;
+    stats->sweep_ns_hist[ManagedHeapStats__bucket(sweep_ns)]++;
+
+    int64_t* freed_types = stats->freed_types.data;
+    for(int i = 0; i < types_length; i++) {
+        freed_types[i] += small_types[i] + large_types[i];
+        stats->small_freed += small_types[i];
+        stats->large_freed += large_types[i];
+        if(!out_info) {
+            small_types[i] = 0;
+            large_types[i] = 0;
+        }
+    }
+    return freed;
+}
+
 int ManagedHeap__collect_hint(ManagedHeap* self) {
     if(self->gc_counter < self->gc_threshold) return 0;
     self->gc_counter = 0;
@@ -7204,10 +7705,8 @@ int ManagedHeap__collect_hint(ManagedHeap* self) {
         ManagedHeap__fire_debug_callback_start(self);
     }
 
-    ManagedHeap__mark(self);
-    if(out_info) out_info->mark_end_ns = time_ns();
-    int freed = ManagedHeap__sweep(self, out_info);
-    if(out_info) out_info->swpet_end_ns = time_ns();
+    int freed = ManagedHeap__mark_and_sweep(self, out_info);
+    self->stats.auto_collections++;
 
     // adjust `gc_threshold` based on `freed_ma`
     self->freed_ma[0] = self->freed_ma[1];
@@ -7226,7 +7725,10 @@ int ManagedHeap__collect_hint(ManagedHeap* self) {
         out_info->auto_thres.avg_freed = avg_freed;
         out_info->auto_thres.free_ratio = free_ratio;
     }
-    self->gc_threshold = c11__min(c11__max(new_threshold, lower), upper);
+    new_threshold = c11__min(c11__max(new_threshold, lower), upper);
+    if(new_threshold > self->gc_threshold) self->stats.threshold_raised++;
+    if(new_threshold < self->gc_threshold) self->stats.threshold_lowered++;
+    self->gc_threshold = new_threshold;
 
     if(!py_isnone(&self->debug_callback)) {
         ManagedHeap__fire_debug_callback_stop(self, out_info);
@@ -7244,10 +7746,7 @@ int ManagedHeap__collect(ManagedHeap* self) {
         ManagedHeap__fire_debug_callback_start(self);
     }
 
-    ManagedHeap__mark(self);
-    if(out_info) out_info->mark_end_ns = time_ns();
-    int freed = ManagedHeap__sweep(self, out_info);
-    if(out_info) out_info->swpet_end_ns = time_ns();
+    int freed = ManagedHeap__mark_and_sweep(self, out_info);
 
     if(out_info) {
         out_info->auto_thres.before = self->gc_threshold;
@@ -7261,10 +7760,29 @@ int ManagedHeap__collect(ManagedHeap* self) {
     return freed;
 }
 
-int ManagedHeap__sweep(ManagedHeap* self, ManagedHeapSwpetInfo* out_info) {
+static size_t ManagedHeap__reserved_bytes(ManagedHeap* self) {
+    size_t size = MultiPool__total_allocated_bytes(&self->small_objects);
+    size += self->large_total_size + self->large_cached_size;
+    size += (size_t)self->large_objects.capacity * sizeof(PyObject*);
+    return size;
+}
+
+size_t ManagedHeap__shrink(ManagedHeap* self) {
+    size_t before = ManagedHeap__reserved_bytes(self);
+    ManagedHeap__collect(self);
+    MultiPool__shrink(&self->small_objects);
+    ManagedHeap__release_large_cache(self);
+    c11_vector__shrink(&self->large_objects);
+    size_t after = ManagedHeap__reserved_bytes(self);
+    return before > after ? before - after : 0;
+}
+
+int ManagedHeap__sweep(ManagedHeap* self,
+                       int* small_types,
+                       int* large_types,
+                       ManagedHeapSwpetInfo* out_info) {
     // small_objects
-    int small_freed =
-        MultiPool__sweep_dealloc(&self->small_objects, out_info ? out_info->small_types : NULL);
+    int small_freed = MultiPool__sweep_dealloc(&self->small_objects, small_types);
     // large_objects
     int large_living_count = 0;
     for(int i = 0; i < self->large_objects.length; i++) {
@@ -7274,10 +7792,9 @@ int ManagedHeap__sweep(ManagedHeap* self, ManagedHeapSwpetInfo* out_info) {
             c11__setitem(PyObject*, &self->large_objects, large_living_count, obj);
             large_living_count++;
         } else {
-            if(out_info) out_info->large_types[obj->type]++;
-            self->large_total_size -= decode_size_8b(obj->size_8b);
+            large_types[obj->type]++;
             PyObject__dtor(obj);
-            PK_FREE(obj);
+            ManagedHeap__free_large(self, obj);
         }
     }
     // shrink `self->large_objects`
@@ -7297,10 +7814,7 @@ PyObject* ManagedHeap__gcnew(ManagedHeap* self, py_Type type, int slots, int uds
     PyObject* obj = MultiPool__alloc(&self->small_objects, size);
     uint8_t size_8b = 0;
     if(obj == NULL) {
-        obj = PK_MALLOC(size);
-        int quantized_size;
-        size_8b = encode_size_8b(size, &quantized_size);
-        self->large_total_size += quantized_size;
+        obj = ManagedHeap__alloc_large(self, size, &size_8b);
         c11_vector__push(PyObject*, &self->large_objects, obj);
     }
     obj->type = type;
@@ -7311,13 +7825,16 @@ PyObject* ManagedHeap__gcnew(ManagedHeap* self, py_Type type, int slots, int uds
     // initialize slots or dict
     if(slots >= 0) {
         memset(obj->flex, 0, slots * sizeof(py_TValue));
+    } else if(type == tp_type || type == tp_module) {
+        NameDict__ctor((void*)obj->flex, PK_TYPE_ATTR_LOAD_FACTOR);
     } else {
-        float load_factor = (type == tp_type || type == tp_module) ? PK_TYPE_ATTR_LOAD_FACTOR
-                                                                   : PK_INST_ATTR_LOAD_FACTOR;
-        NameDict__ctor((void*)obj->flex, load_factor);
+        TypePointer* pointer = c11__at(TypePointer, &pk_current_vm->types, type);
+        if(pointer->shape == NULL) pointer->shape = Shape__new_root();
+        NameDict__ctor_shaped((void*)obj->flex, pointer->shape);
     }
 
     self->gc_counter++;
+    if(self->memory_limit != 0) ManagedHeap__check_soft_limit(self);
     return obj;
 }
 // src/interpreter/py_compile.c
@@ -7425,6 +7942,13 @@ static int BinTree__cmp_cstr(void* lhs, void* rhs) {
     return strcmp(l, r);
 }
 
+static void VM__freeze_modules(BinTree* node) {
+    if(node == NULL) return;
+    if(py_istype(&node->value, tp_module)) NameDict__freeze(PyObject__dict(node->value._obj));
+    VM__freeze_modules(node->left);
+    VM__freeze_modules(node->right);
+}
+
 void VM__ctor(VM* self) {
     self->top_frame = NULL;
 
@@ -7473,6 +7997,7 @@ void VM__ctor(VM* self) {
     TypePointer* placeholder = c11_vector__emplace(&self->types);
     placeholder->ti = NULL;
     placeholder->dtor = NULL;
+    placeholder->shape = NULL;
 
 #define validate(t, expr)                                                                          \
     if(t != (expr)) abort()
@@ -7559,6 +8084,28 @@ void VM__ctor(VM* self) {
     INJECT_BUILTIN_EXC(AssertionError, tp_Exception);
     INJECT_BUILTIN_EXC(KeyError, tp_Exception);
 
+    py_newnotimplemented(py_emplacedict(self->builtins, py_name("NotImplemented")));
+
+    pk__add_module_stdc();
+    pk__add_module_vmath();
+    pk__add_module_array2d();
+    pk__add_module_collections();
+    pk__add_module_functools();
+    pk__add_module_itertools();
+    pk__add_module_operator();
+    // pk__add_module_colorcvt();
+
+    // types added after the modules above are appended to keep their values stable
+    INJECT_BUILTIN_EXC(MemoryError, tp_Exception);
+    validate(tp_member_descriptor, pk_member_descriptor__register());
+    validate(tp_set, pk_set__register());
+    validate(tp_frozenset, pk_frozenset__register());
+    validate(tp_map, pk_map__register());
+    validate(tp_filter, pk_filter__register());
+    validate(tp_zip, pk_zip__register());
+    validate(tp_enumerate, pk_enumerate__register());
+    validate(tp_reversed, pk_reversed__register());
+
 #undef INJECT_BUILTIN_EXC
 #undef validate
 
@@ -7576,6 +8123,13 @@ void VM__ctor(VM* self) {
         tp_range,
         tp_bytes,
         tp_dict,
+        tp_set,
+        tp_frozenset,
+        tp_map,
+        tp_filter,
+        tp_zip,
+        tp_enumerate,
+        tp_reversed,
         tp_property,
         tp_staticmethod,
         tp_classmethod,
@@ -7589,13 +8143,6 @@ void VM__ctor(VM* self) {
         py_setdict(self->builtins, ti->name, &ti->self);
     }
 
-    py_newnotimplemented(py_emplacedict(self->builtins, py_name("NotImplemented")));
-
-    pk__add_module_stdc();
-    pk__add_module_vmath();
-    pk__add_module_array2d();
-    // pk__add_module_colorcvt();
-
     // add modules
     pk__add_module_os();
     pk__add_module_sys();
@@ -7603,6 +8150,8 @@ void VM__ctor(VM* self) {
     pk__add_module_math();
     pk__add_module_dis();
     pk__add_module_random();
+    pk__add_module_heapq();
+    pk__add_module_bisect();
     pk__add_module_json();
     pk__add_module_gc();
     pk__add_module_time();
@@ -7634,6 +8183,13 @@ void VM__ctor(VM* self) {
         c11__abort("failed to load python builtins!");
     } while(0);
 
+    // builtin types and modules are complete now
+    for(int i = 0; i < self->types.length; i++) {
+        TypePointer* pointer = c11__at(TypePointer, &self->types, i);
+        if(pointer->ti) NameDict__freeze(PyObject__dict(pointer->ti->self._obj));
+    }
+    VM__freeze_modules(&self->modules);
+
     self->main = py_newmodule("__main__");
 
     if(py_appcallbacks()->on_vm_ctor) {
@@ -7660,6 +8216,10 @@ void VM__dtor(VM* self) {
     BinTree__dtor(&self->modules);
     FixedMemoryPool__dtor(&self->pool_frame);
     CachedNames__dtor(&self->cached_names);
+    for(int i = 0; i < self->types.length; i++) {
+        TypePointer* pointer = c11__at(TypePointer, &self->types, i);
+        if(pointer->shape) Shape__delete_tree(pointer->shape);
+    }
     c11_vector__dtor(&self->types);
 }
 
@@ -7848,12 +8408,37 @@ FrameResult VM__vectorcall(VM* self, uint16_t argc, uint16_t kwargc, bool opcall
         // [unbound, self, args..., kwargs...]
     }
 
+    // handle partial, splice the bound arguments in front of the given ones
+    if(p0->type == tp_partial) {
+        assert(py_isnil(p0 + 1));  // self must be NULL
+        py_TValue* slots = PyObject__slots(p0->_obj);
+        int n = py_tuple_len(&slots[1]);
+        int m = py_tuple_len(&slots[2]);
+        if(self->stack.sp + n + m > self->stack.end) {
+            py_exception(tp_RecursionError, "maximum recursion depth exceeded");
+            return RES_ERROR;
+        }
+        memmove(p1 + n + m, p1, kwargc * 2 * sizeof(py_TValue));
+        memmove(p0 + 2 + n, p0 + 2, argc * sizeof(py_TValue));
+        memcpy(p0 + 2, py_tuple_data(&slots[1]), n * sizeof(py_TValue));
+        memcpy(p1 + n, py_tuple_data(&slots[2]), m * sizeof(py_TValue));
+        self->stack.sp += n + m;
+        p0[0] = slots[0];
+        // [func, NULL, bound_args..., args..., bound_kwargs..., kwargs...]
+        return VM__vectorcall(self, argc + n, kwargc + m / 2, opcall);
+    }
+
     py_StackRef argv = p0 + 1 + (int)py_isnil(p0 + 1);
     self->curr_function = p0;  // set current function for inspection
 
     if(p0->type == tp_function) {
         Function* fn = py_touserdata(p0);
         const CodeObject* co = &fn->decl->code;
+        // leave the extra room after `stack.end` for raising the error
+        if(argv + co->nlocals > self->stack.end) {
+            py_exception(tp_RecursionError, "maximum recursion depth exceeded");
+            return RES_ERROR;
+        }
 
         switch(fn->decl->type) {
             case FuncType_NORMAL: {
@@ -7969,7 +8554,26 @@ FrameResult VM__vectorcall(VM* self, uint16_t argc, uint16_t kwargc, bool opcall
         return RES_RETURN;
     }
 
+    if(p0->type == tp_lru_cache_wrapper && kwargc) {
+        // a native `__call__` can not take keyword arguments, which are part of the cache key
+        bool ok = lru_cache_wrapper__vectorcall(p0, p1 - argv, kwargc, argv);
+        self->stack.sp = p0;
+        return ok ? RES_RETURN : RES_ERROR;
+    }
+
     // handle `__call__` overload
+    if(!py_isnil(p0 + 1)) {
+        // a callable object bound as a method, make room for it as the first argument
+        // [obj, self, args..., kwargs...] -> [obj, NULL, self, args..., kwargs...]
+        if(self->stack.sp >= self->stack.end) {
+            py_exception(tp_RecursionError, "maximum recursion depth exceeded");
+            return RES_ERROR;
+        }
+        memmove(p0 + 2, p0 + 1, (self->stack.sp - (p0 + 1)) * sizeof(py_TValue));
+        self->stack.sp++;
+        py_newnil(p0 + 1);
+        argc++;
+    }
     if(pk_loadmethod(p0, __call__)) {
         // [__call__, self, args..., kwargs...]
         return VM__vectorcall(self, argc, kwargc, opcall);
@@ -8008,6 +8612,7 @@ void ManagedHeap__mark(ManagedHeap* self) {
     VM* vm = pk_current_vm;
     c11_vector* p_stack = &self->gc_roots;
     assert(p_stack->length == 0);
+    size_t buffer_bytes = 0;
 
     // mark value stack
     for(py_TValue* p = vm->stack.begin; p < vm->stack.sp; p++) {
@@ -8056,25 +8661,36 @@ void ManagedHeap__mark(ManagedHeap* self) {
                 pk__mark_value(p + i);
         } else if(obj->slots == -1) {
             NameDict* dict = PyObject__dict(obj);
-            for(int i = 0; i < dict->capacity; i++) {
-                NameDict_KV* kv = &dict->items[i];
-                if(kv->key == NULL) continue;
-                pk__mark_value(&kv->value);
+            buffer_bytes += NameDict__buffer_size(dict);
+            if(dict->shape) {
+                for(int i = 0; i < dict->length; i++)
+                    pk__mark_value(dict->values + i);
+            } else {
+                for(int i = 0; i < dict->capacity; i++) {
+                    NameDict_KV* kv = &dict->items[i];
+                    if(kv->key == NULL) continue;
+                    pk__mark_value(&kv->value);
+                }
             }
         }
 
         void* ud = PyObject__userdata(obj);
-        switch(obj->type) {
+        // instances of python subclasses carry the userdata of their native base
+        switch(c11__getitem(TypePointer, &vm->types, obj->type).layout) {
             case tp_list: {
                 List* self = ud;
+                buffer_bytes += (size_t)self->capacity * sizeof(py_TValue);
                 for(int i = 0; i < self->length; i++) {
                     py_TValue* val = c11__at(py_TValue, self, i);
                     pk__mark_value(val);
                 }
                 break;
             }
-            case tp_dict: {
+            case tp_dict:
+            case tp_set:
+            case tp_frozenset: {
                 Dict* self = ud;
+                buffer_bytes += Dict__buffer_size(self);
                 for(int i = 0; i < self->entries.length; i++) {
                     DictEntry* entry = c11__at(DictEntry, &self->entries, i);
                     if(py_isnil(&entry->key)) continue;
@@ -8111,8 +8727,27 @@ void ManagedHeap__mark(ManagedHeap* self) {
                 c11_chunked_array2d__mark(ud, p_stack);
                 break;
             }
+            case tp_deque: {
+                Deque* self = ud;
+                buffer_bytes += (size_t)self->capacity * sizeof(py_TValue);
+                for(int i = 0; i < self->length; i++) {
+                    pk__mark_value(&self->data[(self->head + i) & (self->capacity - 1)]);
+                }
+                break;
+            }
+            case tp_lru_cache_wrapper: {
+                LruCache* self = ud;
+                buffer_bytes += (size_t)self->nodes.capacity * sizeof(LruCacheNode);
+                buffer_bytes += (size_t)self->capacity * sizeof(int);
+                c11__foreach(LruCacheNode, &self->nodes, node) {
+                    pk__mark_value(&node->key);
+                    pk__mark_value(&node->result);
+                }
+                break;
+            }
         }
     }
+    self->buffer_bytes = buffer_bytes;
 }
 
 // src/interpreter/vmx.c
@@ -8289,6 +8924,12 @@ PK_INLINE py_TypeInfo* pk_typeinfo(py_Type type) {
     return c11__getitem(TypePointer, &pk_current_vm->types, type).ti;
 }
 
+// a type that inherits the dtor of its base also shares its userdata layout
+static py_Type pk_typelayout(py_Type index, py_Type base, void (*dtor)(void*)) {
+    if(dtor || !base || !pk_typeinfo(base)->dtor) return index;
+    return c11__getitem(TypePointer, &pk_current_vm->types, base).layout;
+}
+
 static void py_TypeInfo__common_init(py_Name name,
                                      py_Type base,
                                      py_Type index,
@@ -8314,6 +8955,7 @@ static void py_TypeInfo__common_init(py_Name name,
     if(!dtor && base) dtor = base_ti->dtor;
     self->is_python = is_python;
     self->is_final = is_final;
+    self->instance_slots = -1;
 
     self->getattribute = NULL;
     self->setattribute = NULL;
@@ -8332,6 +8974,7 @@ py_Type pk_newtype(const char* name,
                    bool is_python,
                    bool is_final) {
     py_Type index = pk_current_vm->types.length;
+    py_Type layout = pk_typelayout(index, base, dtor);
     py_TypeInfo* self = py_newobject(py_retval(), tp_type, -1, sizeof(py_TypeInfo));
     py_TypeInfo__common_init(py_name(name),
                              base,
@@ -8345,6 +8988,8 @@ py_Type pk_newtype(const char* name,
     TypePointer* pointer = c11_vector__emplace(&pk_current_vm->types);
     pointer->ti = self;
     pointer->dtor = self->dtor;
+    pointer->shape = NULL;
+    pointer->layout = layout;
     return index;
 }
 
@@ -8377,6 +9022,7 @@ py_Type pk_newtypewithmode(py_Name name,
             TypePointer* pointer = c11__at(TypePointer, &pk_current_vm->types, index);
             pointer->ti = self;
             pointer->dtor = self->dtor;
+            pointer->layout = pk_typelayout(index, base, dtor);
             return index;
         }
     }
@@ -9035,20 +9681,9 @@ __NEXT_STEP:
         }
         case OP_BUILD_SET: {
             py_TValue* begin = SP() - byte.arg;
-            py_Ref typeobject_set = py_getdict(self->builtins, py_name("set"));
-            assert(typeobject_set != NULL);
-            py_push(typeobject_set);
-            py_pushnil();
-            if(!py_vectorcall(0, 0)) goto __ERROR;
-            py_push(py_retval());  // empty set
-            py_Name id_add = py_name("add");
+            pk_newset(SP()++);
             for(int i = 0; i < byte.arg; i++) {
-                py_push(TOP());
-                if(!py_pushmethod(id_add)) {
-                    c11__abort("OP_BUILD_SET: failed to load method 'add'");
-                }
-                py_push(begin + i);
-                if(!py_vectorcall(1, 0)) goto __ERROR;
+                if(!pk_set_add(TOP(), begin + i)) goto __ERROR;
             }
             py_TValue tmp = *TOP();
             SP() = begin;
@@ -9134,7 +9769,13 @@ __NEXT_STEP:
             goto __ERROR;
         }
             /*****************************************/
-        case OP_JUMP_FORWARD: DISPATCH_JUMP((int16_t)byte.arg);
+        case OP_JUMP_FORWARD: {
+            // also the back edge of `while` loops
+            if(self->heap.memory_exceeded) {
+                if(!ManagedHeap__check_memory_limit(&self->heap)) goto __ERROR;
+            }
+            DISPATCH_JUMP((int16_t)byte.arg);
+        }
         case OP_POP_JUMP_IF_NOT_MATCH: {
             int res = py_equal(SECOND(), TOP());
             if(res < 0) goto __ERROR;
@@ -9197,6 +9838,9 @@ __NEXT_STEP:
         /*****************************************/
         case OP_CALL: {
             if(self->heap.gc_enabled) ManagedHeap__collect_hint(&self->heap);
+            if(self->heap.memory_exceeded) {
+                if(!ManagedHeap__check_memory_limit(&self->heap)) goto __ERROR;
+            }
             vectorcall_opcall(byte.arg & 0xFF, byte.arg >> 8);
             DISPATCH();
         }
@@ -9209,16 +9853,20 @@ __NEXT_STEP:
             py_TValue* sp = SP();
             py_TValue* p1 = sp - kwargc * 2;
             py_TValue* base = p1 - argc;
-            py_TValue* buf = self->vectorcall_buffer;
+            // the unpacked arguments may not fit in `vectorcall_buffer`,
+            // so they are gathered in the free stack above `sp` instead
+            py_TValue* buf = sp;
 
             for(py_TValue* curr = base; curr != p1; curr++) {
                 if(curr->type != tp_star_wrapper) {
+                    if(buf + n + 1 > self->stack.end) goto __VARGS_OVERFLOW;
                     buf[n++] = *curr;
                 } else {
                     py_TValue* args = py_getslot(curr, 0);
                     py_TValue* p;
                     int length = pk_arrayview(args, &p);
                     if(length != -1) {
+                        if(buf + n + length > self->stack.end) goto __VARGS_OVERFLOW;
                         for(int j = 0; j < length; j++) {
                             buf[n++] = p[j];
                         }
@@ -9232,12 +9880,14 @@ __NEXT_STEP:
 
             for(py_TValue* curr = p1; curr != sp; curr += 2) {
                 if(curr[1].type != tp_star_wrapper) {
+                    if(buf + n + 2 > self->stack.end) goto __VARGS_OVERFLOW;
                     buf[n++] = curr[0];
                     buf[n++] = curr[1];
                 } else {
                     assert(py_toint(&curr[0]) == 0);
                     py_TValue* kwargs = py_getslot(&curr[1], 0);
                     if(kwargs->type == tp_dict) {
+                        if(buf + n + py_dict_len(kwargs) * 2 > self->stack.end) goto __VARGS_OVERFLOW;
                         py_TValue* p = buf + n;
                         if(!py_dict_apply(kwargs, unpack_dict_to_buffer, &p)) goto __ERROR;
                         n = p - buf;
@@ -9249,11 +9899,14 @@ __NEXT_STEP:
                 }
             }
 
-            memcpy(base, buf, n * sizeof(py_TValue));
+            memmove(base, buf, n * sizeof(py_TValue));
             SP() = base + n;
 
             vectorcall_opcall(argc, kwargc);
             DISPATCH();
+        __VARGS_OVERFLOW:
+            py_exception(tp_RecursionError, "maximum recursion depth exceeded");
+            goto __ERROR;
         }
         case OP_RETURN_VALUE: {
             if(byte.arg == BC_NOARG) {
@@ -9310,12 +9963,7 @@ __NEXT_STEP:
         }
         case OP_SET_ADD: {
             // [set, iter, value]
-            py_push(THIRD());  // [| set]
-            if(!py_pushmethod(py_name("add"))) {
-                c11__abort("OP_SET_ADD: failed to load method 'add'");
-            }  // [|add() set]
-            py_push(THIRD());
-            if(!py_vectorcall(1, 0)) goto __ERROR;
+            if(!pk_set_add(THIRD(), TOP())) goto __ERROR;
             POP();
             DISPATCH();
         }
@@ -9350,6 +9998,9 @@ __NEXT_STEP:
             DISPATCH();
         }
         case OP_FOR_ITER: {
+            if(self->heap.memory_exceeded) {
+                if(!ManagedHeap__check_memory_limit(&self->heap)) goto __ERROR;
+            }
             int res = py_next(TOP());
             if(res == -1) goto __ERROR;
             if(res) {
@@ -9396,12 +10047,13 @@ __NEXT_STEP:
                     }
                 }
             } else {
-                for(int i = 0; i < dict->capacity; i++) {
-                    NameDict_KV* kv = &dict->items[i];
-                    if(kv->key == NULL) continue;
-                    c11_sv name = py_name2sv(kv->key);
+                int i = 0;
+                py_Name key;
+                py_TValue* value;
+                while(NameDict__next(dict, &i, &key, &value)) {
+                    c11_sv name = py_name2sv(key);
                     if(name.size == 0 || name.data[0] == '_') continue;
-                    if(!Frame__setglobal(frame, kv->key, &kv->value)) goto __ERROR;
+                    if(!Frame__setglobal(frame, key, value)) goto __ERROR;
                 }
             }
             POP();
@@ -9531,6 +10183,7 @@ __NEXT_STEP:
         case OP_END_CLASS: {
             // [cls or decorated]
             py_Name name = co_names[byte.arg];
+            if(!pk_member__init_slots(py_touserdata(self->curr_class))) goto __ERROR;
             if(!Frame__setglobal(frame, name, TOP())) goto __ERROR;
 
             if(py_istype(TOP(), tp_type)) {
@@ -9546,6 +10199,7 @@ __NEXT_STEP:
                     TypeError("'%n' implements '__eq__' but not '__ne__'", ti->name);
                     goto __ERROR;
                 }
+                NameDict__freeze(PyObject__dict(ti->self._obj));
             }
             // class with decorator is unsafe currently
             // it skips the above check
@@ -10740,33 +11394,88 @@ uintptr_t ThomasWangInt32Hash(void* Ptr) {
 
 #define HASH_KEY(__k) ThomasWangInt32Hash(__k)
 
+#define HASH_MASK ((uintptr_t)self->capacity - 1)
+
 #define HASH_PROBE_0(__k, ok, i)                                                                   \
     ok = false;                                                                                    \
-    i = HASH_KEY(__k) & self->mask;                                                                \
+    i = HASH_KEY(__k) & HASH_MASK;                                                                 \
     do {                                                                                           \
         if(self->items[i].key == (__k)) {                                                          \
             ok = true;                                                                             \
             break;                                                                                 \
         }                                                                                          \
         if(self->items[i].key == NULL) break;                                                      \
-        i = (i + 1) & self->mask;                                                                  \
+        i = (i + 1) & HASH_MASK;                                                                   \
     } while(true);
 
 #define HASH_PROBE_1(__k, ok, i)                                                                   \
     ok = false;                                                                                    \
-    i = HASH_KEY(__k) & self->mask;                                                                \
+    i = HASH_KEY(__k) & HASH_MASK;                                                                 \
     while(self->items[i].key != NULL) {                                                            \
         if(self->items[i].key == (__k)) {                                                          \
             ok = true;                                                                             \
             break;                                                                                 \
         }                                                                                          \
-        i = (i + 1) & self->mask;                                                                  \
+        i = (i + 1) & HASH_MASK;                                                                   \
+    }
+
+static Shape* Shape__new(Shape* parent, int length) {
+    Shape* self = PK_MALLOC(sizeof(Shape) + sizeof(py_Name) * length);
+    self->parent = parent;
+    self->first_child = NULL;
+    self->next_sibling = NULL;
+    self->num_children = 0;
+    self->num_shapes = 1;
+    self->expected_length = length;
+    self->length = length;
+    return self;
+}
+
+Shape* Shape__new_root() { return Shape__new(NULL, 0); }
+
+void Shape__delete_tree(Shape* self) {
+    Shape* child = self->first_child;
+    while(child) {
+        Shape* next = child->next_sibling;
+        Shape__delete_tree(child);
+        child = next;
+    }
+    PK_FREE(self);
+}
+
+int Shape__index(Shape* self, py_Name key) {
+    for(int i = 0; i < self->length; i++) {
+        if(self->keys[i] == key) return i;
     }
+    return -1;
+}
+
+// returns NULL if the shape tree is too deep, too wide or too large
+static Shape* Shape__transition(Shape* self, py_Name key) {
+    for(Shape* child = self->first_child; child; child = child->next_sibling) {
+        if(child->keys[self->length] == key) return child;
+    }
+    if(self->length >= kShapeMaxLength || self->num_children >= kShapeMaxChildren) return NULL;
+    Shape* root = self;
+    while(root->parent) root = root->parent;
+    if(root->num_shapes >= kShapeMaxCount) return NULL;
+    root->num_shapes++;
+    Shape* child = Shape__new(self, self->length + 1);
+    memcpy(child->keys, self->keys, sizeof(py_Name) * self->length);
+    child->keys[self->length] = key;
+    child->next_sibling = self->first_child;
+    self->first_child = child;
+    self->num_children++;
+    // let ancestors know how many values their instances will likely need
+    for(Shape* p = self; p && p->expected_length < child->length; p = p->parent) {
+        p->expected_length = child->length;
+    }
+    return child;
+}
 
 static void NameDict__set_capacity_and_alloc_items(NameDict* self, int val) {
     self->capacity = val;
     self->critical_size = val * self->load_factor;
-    self->mask = (uintptr_t)val - 1;
 
     self->items = PK_MALLOC(self->capacity * sizeof(NameDict_KV));
     memset(self->items, 0, self->capacity * sizeof(NameDict_KV));
@@ -10802,12 +11511,137 @@ void NameDict__ctor(NameDict* self, float load_factor) {
     assert(load_factor > 0.0f && load_factor < 1.0f);
     self->length = 0;
     self->load_factor = load_factor;
+    self->shape = NULL;
     NameDict__set_capacity_and_alloc_items(self, 4);
 }
 
+void NameDict__ctor_shaped(NameDict* self, Shape* root) {
+    assert(root->length == 0);
+    self->length = 0;
+    self->capacity = 0;
+    self->load_factor = PK_INST_ATTR_LOAD_FACTOR;
+    self->critical_size = 0;
+    self->shape = root;
+    self->values = NULL;
+}
+
 void NameDict__dtor(NameDict* self) { PK_FREE(self->items); }
 
+/* Frozen mode. The slot of a key is a rotation of its hash, and the rotation amount is picked
+ * per dict so that no two keys share a slot. A lookup reads exactly one slot, a miss never
+ * walks a probe chain. Inserting or deleting a key thaws the dict back into hash mode. */
+#define kNameDictFrozenMaxGrowth 4  // a frozen table may be this many times sparser
+
+static bool NameDict__is_frozen(NameDict* self) { return self->critical_size < 0; }
+
+static uintptr_t NameDict__frozen_slot(uintptr_t hash, int rotation, uintptr_t mask) {
+    uint32_t h = (uint32_t)hash;
+    h = (h >> rotation) | (h << (-rotation & 31));
+    return h & mask;
+}
+
+static NameDict_KV* NameDict__frozen_find(NameDict* self, py_Name key) {
+    int rotation = -1 - self->critical_size;
+    NameDict_KV* kv = &self->items[NameDict__frozen_slot(HASH_KEY(key), rotation, HASH_MASK)];
+    return kv->key == key ? kv : NULL;
+}
+
+// returns the first rotation that places all keys on distinct slots, or -1
+static int NameDict__find_rotation(NameDict* self, int capacity, uint8_t* used) {
+    uintptr_t mask = (uintptr_t)capacity - 1;
+    for(int rotation = 0; rotation < 32; rotation++) {
+        memset(used, 0, capacity);
+        bool ok = true;
+        for(int i = 0; ok && i < self->capacity; i++) {
+            if(self->items[i].key == NULL) continue;
+            uintptr_t slot = NameDict__frozen_slot(HASH_KEY(self->items[i].key), rotation, mask);
+            ok = !used[slot];
+            used[slot] = 1;
+        }
+        if(ok) return rotation;
+    }
+    return -1;
+}
+
+// turn a hash mode dict that is not expected to change into frozen mode
+void NameDict__freeze(NameDict* self) {
+    if(self->shape || NameDict__is_frozen(self) || self->length == 0) return;
+    int capacity = 4;
+    while(self->length > (int)(capacity * self->load_factor)) {
+        capacity *= 2;
+    }
+    int max_capacity = capacity * kNameDictFrozenMaxGrowth;
+    uint8_t* used = PK_MALLOC(max_capacity);
+    int rotation = -1;
+    for(; capacity <= max_capacity; capacity *= 2) {
+        rotation = NameDict__find_rotation(self, capacity, used);
+        if(rotation >= 0) break;
+    }
+    PK_FREE(used);
+    if(rotation < 0) return;  // stay in hash mode
+    NameDict_KV* old_items = self->items;
+    int old_capacity = self->capacity;
+    NameDict__set_capacity_and_alloc_items(self, capacity);
+    for(int i = 0; i < old_capacity; i++) {
+        if(old_items[i].key == NULL) continue;
+        uintptr_t slot = NameDict__frozen_slot(HASH_KEY(old_items[i].key), rotation, HASH_MASK);
+        self->items[slot] = old_items[i];
+    }
+    PK_FREE(old_items);
+    self->critical_size = -1 - rotation;
+}
+
+static void NameDict__thaw(NameDict* self) {
+    assert(NameDict__is_frozen(self));
+    NameDict_KV* old_items = self->items;
+    int old_capacity = self->capacity;
+    int capacity = 4;
+    while(self->length > (int)(capacity * self->load_factor)) {
+        capacity *= 2;
+    }
+    NameDict__set_capacity_and_alloc_items(self, capacity);
+    for(int k = 0; k < old_capacity; k++) {
+        if(old_items[k].key == NULL) continue;
+        bool ok;
+        uintptr_t i;
+        HASH_PROBE_1(old_items[k].key, ok, i);
+        assert(!ok);
+        self->items[i] = old_items[k];
+    }
+    PK_FREE(old_items);
+}
+
+// leave shape mode, e.g. after a deletion or when the shape tree is full
+static void NameDict__to_hash(NameDict* self) {
+    assert(self->shape);
+    Shape* shape = self->shape;
+    py_TValue* values = self->values;
+    int capacity = 4;
+    while(self->length > (int)(capacity * self->load_factor)) {
+        capacity *= 2;
+    }
+    self->shape = NULL;
+    NameDict__set_capacity_and_alloc_items(self, capacity);
+    for(int k = 0; k < self->length; k++) {
+        bool ok;
+        uintptr_t i;
+        HASH_PROBE_1(shape->keys[k], ok, i);
+        assert(!ok);
+        self->items[i].key = shape->keys[k];
+        self->items[i].value = values[k];
+    }
+    PK_FREE(values);
+}
+
 py_TValue* NameDict__try_get(NameDict* self, py_Name key) {
+    if(self->shape) {
+        int index = Shape__index(self->shape, key);
+        return index >= 0 ? &self->values[index] : NULL;
+    }
+    if(NameDict__is_frozen(self)) {
+        NameDict_KV* kv = NameDict__frozen_find(self, key);
+        return kv ? &kv->value : NULL;
+    }
     bool ok;
     uintptr_t i;
     HASH_PROBE_0(key, ok, i);
@@ -10816,6 +11650,8 @@ py_TValue* NameDict__try_get(NameDict* self, py_Name key) {
 }
 
 bool NameDict__contains(NameDict* self, py_Name key) {
+    if(self->shape) return Shape__index(self->shape, key) >= 0;
+    if(NameDict__is_frozen(self)) return NameDict__frozen_find(self, key) != NULL;
     bool ok;
     uintptr_t i;
     HASH_PROBE_0(key, ok, i);
@@ -10823,6 +11659,41 @@ bool NameDict__contains(NameDict* self, py_Name key) {
 }
 
 void NameDict__set(NameDict* self, py_Name key, py_TValue* val) {
+    py_TValue tmp;
+    if(self->shape) {
+        int index = Shape__index(self->shape, key);
+        if(index >= 0) {
+            self->values[index] = *val;
+            return;
+        }
+        // `val` may point into `values`, which is about to be reallocated
+        tmp = *val;
+        val = &tmp;
+        Shape* next = Shape__transition(self->shape, key);
+        if(next) {
+            if(self->length == self->capacity) {
+                int new_capacity = c11__max(self->capacity * 2, 4);
+                new_capacity = c11__max(new_capacity, next->expected_length);
+                self->values = PK_REALLOC(self->values, sizeof(py_TValue) * new_capacity);
+                self->capacity = new_capacity;
+            }
+            self->values[self->length++] = *val;
+            self->shape = next;
+            return;
+        }
+        NameDict__to_hash(self);
+    }
+    if(NameDict__is_frozen(self)) {
+        NameDict_KV* kv = NameDict__frozen_find(self, key);
+        if(kv) {
+            kv->value = *val;
+            return;
+        }
+        // `val` may point into `items`, which is about to be reallocated
+        tmp = *val;
+        val = &tmp;
+        NameDict__thaw(self);
+    }
     bool ok;
     uintptr_t i;
     HASH_PROBE_1(key, ok, i);
@@ -10838,6 +11709,14 @@ void NameDict__set(NameDict* self, py_Name key, py_TValue* val) {
 }
 
 bool NameDict__del(NameDict* self, py_Name key) {
+    if(self->shape) {
+        if(Shape__index(self->shape, key) < 0) return false;
+        NameDict__to_hash(self);
+    }
+    if(NameDict__is_frozen(self)) {
+        if(!NameDict__frozen_find(self, key)) return false;
+        NameDict__thaw(self);
+    }
     bool ok;
     uintptr_t i;
     HASH_PROBE_0(key, ok, i);
@@ -10849,10 +11728,10 @@ bool NameDict__del(NameDict* self, py_Name key) {
     uintptr_t posToRemove = i;
     uintptr_t posToShift = posToRemove;
     while(true) {
-        posToShift = (posToShift + 1) & self->mask;
+        posToShift = (posToShift + 1) & HASH_MASK;
         if(self->items[posToShift].key == NULL) break;
         uintptr_t hash_z = HASH_KEY(self->items[posToShift].key);
-        uintptr_t insertPos = hash_z & self->mask;
+        uintptr_t insertPos = hash_z & HASH_MASK;
         bool cond1 = insertPos <= posToRemove;
         bool cond2 = posToRemove <= posToShift;
         if((cond1 && cond2) ||
@@ -10869,6 +11748,14 @@ bool NameDict__del(NameDict* self, py_Name key) {
 }
 
 void NameDict__clear(NameDict* self) {
+    if(self->shape) {
+        while(self->shape->parent) {
+            self->shape = self->shape->parent;
+        }
+        self->length = 0;
+        return;
+    }
+    if(NameDict__is_frozen(self)) NameDict__thaw(self);
     for(int i = 0; i < self->capacity; i++) {
         self->items[i].key = NULL;
         self->items[i].value = *py_NIL();
@@ -10876,8 +11763,32 @@ void NameDict__clear(NameDict* self) {
     self->length = 0;
 }
 
+bool NameDict__next(NameDict* self, int* i, py_Name* key, py_TValue** value) {
+    if(self->shape) {
+        if(*i >= self->length) return false;
+        *key = self->shape->keys[*i];
+        *value = &self->values[*i];
+        (*i)++;
+        return true;
+    }
+    while(*i < self->capacity) {
+        NameDict_KV* kv = &self->items[(*i)++];
+        if(kv->key == NULL) continue;
+        *key = kv->key;
+        *value = &kv->value;
+        return true;
+    }
+    return false;
+}
+
+size_t NameDict__buffer_size(NameDict* self) {
+    if(self->shape) return (size_t)self->capacity * sizeof(py_TValue);
+    return (size_t)self->capacity * sizeof(NameDict_KV);
+}
+
 #undef HASH_PROBE_0
 #undef HASH_PROBE_1
+#undef HASH_MASK
 #undef HASH_KEY
 // src/objects/codeobject_ser.c
 // Magic number for CodeObject serialization: "CO" = 0x434F
@@ -10946,9 +11857,8 @@ static void TValue__deserialize(c11_deserializer* d, py_OutRef out) {
         }
         case tp_str: {
             int size = c11_deserializer__read_i32(d);
-            char* dst = py_newstrn(out, size);
             char* src = c11_deserializer__read_bytes(d, size);
-            memcpy(dst, src, size);
+            py_newstrv(out, (c11_sv){src, size});
             break;
         }
         case tp_bool: {
@@ -11291,30 +12201,24 @@ char* CodeObject__loads(const void* data, int size, const char* filename, CodeOb
 // src/common/_generated.c
 // generated by prebuild.py
 #include <string.h>
-const char kPythonLibs_bisect[] = "\"\"\"Bisection algorithms.\"\"\"\n\ndef insort_right(a, x, lo=0, hi=None):\n    \"\"\"Insert item x in list a, and keep it sorted assuming a is sorted.\n\n    If x is already in a, insert it to the right of the rightmost x.\n\n    Optional args lo (default 0) and hi (default len(a)) bound the\n    slice of a to be searched.\n    \"\"\"\n\n    lo = bisect_right(a, x, lo, hi)\n    a.insert(lo, x)\n\ndef bisect_right(a, x, lo=0, hi=None):\n    \"\"\"Return the index where to insert item x in list a, assuming a is sorted.\n\n    The return value i is such that all e in a[:i] have e <= x, and all e in\n    a[i:] have e > x.  So if x already appears in the list, a.insert(x) will\n    insert just after the rightmost x already there.\n\n    Optional args lo (default 0) and hi (default len(a)) bound the\n    slice of a to be searched.\n    \"\"\"\n\n    if lo < 0:\n        raise ValueError('lo must be non-negative')\n    if hi is None:\n        hi = len(a)\n    while lo < hi:\n        mid = (lo+hi)//2\n        if x < a[mid]: hi = mid\n        else: lo = mid+1\n    return lo\n\ndef insort_left(a, x, lo=0, hi=None):\n    \"\"\"Insert item x in list a, and keep it sorted assuming a is sorted.\n\n    If x is already in a, insert it to the left of the leftmost x.\n\n    Optional args lo (default 0) and hi (default len(a)) bound the\n    slice of a to be searched.\n    \"\"\"\n\n    lo = bisect_left(a, x, lo, hi)\n    a.insert(lo, x)\n\n\ndef bisect_left(a, x, lo=0, hi=None):\n    \"\"\"Return the index where to insert item x in list a, assuming a is sorted.\n\n    The return value i is such that all e in a[:i] have e < x, and all e in\n    a[i:] have e >= x.  So if x already appears in the list, a.insert(x) will\n    insert just before the leftmost x already there.\n\n    Optional args lo (default 0) and hi (default len(a)) bound the\n    slice of a to be searched.\n    \"\"\"\n\n    if lo < 0:\n        raise ValueError('lo must be non-negative')\n    if hi is None:\n        hi = len(a)\n    while lo < hi:\n        mid = (lo+hi)//2\n        if a[mid] < x: lo = mid+1\n        else: hi = mid\n    return lo\n\n# Create aliases\nbisect = bisect_right\ninsort = insort_right\n";
-const char kPythonLibs_builtins[] = "def all(iterable):\n    for i in iterable:\n        if not i:\n            return False\n    return True\n\ndef any(iterable):\n    for i in iterable:\n        if i:\n            return True\n    return False\n\ndef enumerate(iterable, start=0):\n    n = start\n    for elem in iterable:\n        yield n, elem\n        n += 1\n\ndef __minmax_reduce(op, args):\n    if len(args) == 2:  # min(1, 2)\n        return args[0] if op(args[0], args[1]) else args[1]\n    if len(args) == 0:  # min()\n        raise TypeError('expected 1 arguments, got 0')\n    if len(args) == 1:  # min([1, 2, 3, 4]) -> min(1, 2, 3, 4)\n        args = args[0]\n    args = iter(args)\n    try:\n        res = next(args)\n    except StopIteration:\n        raise ValueError('args is an empty sequence')\n    while True:\n        try:\n            i = next(args)\n        except StopIteration:\n            break\n        if op(i, res):\n            res = i\n    return res\n\ndef min(*args, key=None):\n    key = key or (lambda x: x)\n    return __minmax_reduce(lambda x,y: key(x)<key(y), args)\n\ndef max(*args, key=None):\n    key = key or (lambda x: x)\n    return __minmax_reduce(lambda x,y: key(x)>key(y), args)\n\ndef sum(iterable):\n    res = 0\n    for i in iterable:\n        res += i\n    return res\n\ndef map(f, iterable):\n    for i in iterable:\n        yield f(i)\n\ndef filter(f, iterable):\n    for i in iterable:\n        if f(i):\n            yield i\n\nclass zip:\n    def __init__(self, *iterables):\n        self.iterables = [iter(it) for it in iterables]\n\n    def __iter__(self):\n        return self\n\n    def __next__(self):\n        result = []\n        for it in self.iterables:\n            result.append(next(it))\n        return tuple(result)\n\ndef reversed(iterable):\n    a = list(iterable)\n    a.reverse()\n    return a\n\ndef sorted(iterable, key=None, reverse=False):\n    a = list(iterable)\n    a.sort(key=key, reverse=reverse)\n    return a\n\n\ndef help(obj):\n    if hasattr(obj, '__func__'):\n        obj = obj.__func__\n    # print(obj.__signature__)\n    if obj.__doc__:\n        print(obj.__doc__)\n\ndef complex(real, imag=0):\n    import cmath\n    return cmath.complex(real, imag) # type: ignore\n\ndef dir(obj) -> list[str]:\n    tp_module = type(__import__('math'))\n    if isinstance(obj, tp_module):\n        return [k for k, _ in obj.__dict__.items()]\n    names = set()\n    if not isinstance(obj, type):\n        obj_d = obj.__dict__\n        if obj_d is not None:\n            names.update([k for k, _ in obj_d.items()])\n        cls = type(obj)\n    else:\n        cls = obj\n    while cls is not None:\n        names.update([k for k, _ in cls.__dict__.items()])\n        cls = cls.__base__\n    return sorted(list(names))\n\nclass set:\n    def __init__(self, iterable=None):\n        iterable = iterable or []\n        self._a = {}\n        self.update(iterable)\n\n    def add(self, elem):\n        self._a[elem] = None\n        \n    def discard(self, elem):\n        self._a.pop(elem, None)\n\n    def remove(self, elem):\n        del self._a[elem]\n        \n    def clear(self):\n        self._a.clear()\n\n    def update(self, other):\n        for elem in other:\n            self.add(elem)\n\n    def __len__(self):\n        return len(self._a)\n    \n    def copy(self):\n        return set(self._a.keys())\n    \n    def __and__(self, other):\n        return {elem for elem in self if elem in other}\n\n    def __sub__(self, other):\n        return {elem for elem in self if elem not in other}\n    \n    def __or__(self, other):\n        ret = self.copy()\n        ret.update(other)\n        return ret\n\n    def __xor__(self, other): \n        _0 = self - other\n        _1 = other - self\n        return _0 | _1\n\n    def union(self, other):\n        return self | other\n\n    def intersection(self, other):\n        return self & other\n\n    def difference(self, other):\n        return self - other\n\n    def symmetric_difference(self, other):      \n        return self ^ other\n    \n    def __eq__(self, other):\n        if not isinstance(other, set):\n            return NotImplemented\n        return len(self ^ other) == 0\n    \n    def __ne__(self, other):\n        if not isinstance(other, set):\n            return NotImplemented\n        return len(self ^ other) != 0\n\n    def isdisjoint(self, other):\n        return len(self & other) == 0\n    \n    def issubset(self, other):\n        return len(self - other) == 0\n    \n    def issuperset(self, other):\n        return len(other - self) == 0\n\n    def __contains__(self, elem):\n        return elem in self._a\n    \n    def __repr__(self):\n        if len(self) == 0:\n            return 'set()'\n        return '{'+ ', '.join([repr(i) for i in self._a.keys()]) + '}'\n    \n    def __iter__(self):\n        return iter(self._a.keys())";
+const char kPythonLibs_builtins[] = "def help(obj):\n    if hasattr(obj, '__func__'):\n        obj = obj.__func__\n    # print(obj.__signature__)\n    if obj.__doc__:\n        print(obj.__doc__)\n\ndef complex(real, imag=0):\n    import cmath\n    return cmath.complex(real, imag) # type: ignore\n\ndef dir(obj) -> list[str]:\n    tp_module = type(__import__('math'))\n    if isinstance(obj, tp_module):\n        return [k for k, _ in obj.__dict__.items()]\n    names = set()\n    if not isinstance(obj, type):\n        obj_d = obj.__dict__\n        if obj_d is not None:\n            names.update([k for k, _ in obj_d.items()])\n        cls = type(obj)\n    else:\n        cls = obj\n    while cls is not None:\n        names.update([k for k, _ in cls.__dict__.items()])\n        cls = cls.__base__\n    return sorted(list(names))";
 const char kPythonLibs_cmath[] = "import math\n\nclass complex:\n    def __init__(self, real, imag=0):\n        self._real = float(real)\n        self._imag = float(imag)\n\n    @property\n    def real(self):\n        return self._real\n    \n    @property\n    def imag(self):\n        return self._imag\n\n    def conjugate(self):\n        return complex(self.real, -self.imag)\n    \n    def __repr__(self):\n        s = ['(', str(self.real)]\n        s.append('-' if self.imag < 0 else '+')\n        s.append(str(abs(self.imag)))\n        s.append('j)')\n        return ''.join(s)\n    \n    def __eq__(self, other):\n        if type(other) is complex:\n            return self.real == other.real and self.imag == other.imag\n        if type(other) in (int, float):\n            return self.real == other and self.imag == 0\n        return NotImplemented\n    \n    def __ne__(self, other):\n        res = self == other\n        if res is NotImplemented:\n            return res\n        return not res\n    \n    def __add__(self, other):\n        if type(other) is complex:\n            return complex(self.real + other.real, self.imag + other.imag)\n        if type(other) in (int, float):\n            return complex(self.real + other, self.imag)\n        return NotImplemented\n        \n    def __radd__(self, other):\n        return self.__add__(other)\n    \n    def __sub__(self, other):\n        if type(other) is complex:\n            return complex(self.real - other.real, self.imag - other.imag)\n        if type(other) in (int, float):\n            return complex(self.real - other, self.imag)\n        return NotImplemented\n    \n    def __rsub__(self, other):\n        if type(other) is complex:\n            return complex(other.real - self.real, other.imag - self.imag)\n        if type(other) in (int, float):\n            return complex(other - self.real, -self.imag)\n        return NotImplemented\n    \n    def __mul__(self, other):\n        if type(other) is complex:\n            return complex(self.real * other.real - self.imag * other.imag,\n                           self.real * other.imag + self.imag * other.real)\n        if type(other) in (int, float):\n            return complex(self.real * other, self.imag * other)\n        return NotImplemented\n    \n    def __rmul__(self, other):\n        return self.__mul__(other)\n    \n    def __truediv__(self, other):\n        if type(other) is complex:\n            denominator = other.real ** 2 + other.imag ** 2\n            real_part = (self.real * other.real + self.imag * other.imag) / denominator\n            imag_part = (self.imag * other.real - self.real * other.imag) / denominator\n            return complex(real_part, imag_part)\n        if type(other) in (int, float):\n            return complex(self.real / other, self.imag / other)\n        return NotImplemented\n    \n    def __pow__(self, other: int | float):\n        if type(other) in (int, float):\n            return complex(self.__abs__() ** other * math.cos(other * phase(self)),\n                           self.__abs__() ** other * math.sin(other * phase(self)))\n        return NotImplemented\n    \n    def __abs__(self) -> float:\n        return math.sqrt(self.real ** 2 + self.imag ** 2)\n\n    def __neg__(self):\n        return complex(-self.real, -self.imag)\n    \n    def __hash__(self):\n        return hash((self.real, self.imag))\n\n\n# Conversions to and from polar coordinates\n\ndef phase(z: complex):\n    return math.atan2(z.imag, z.real)\n\ndef polar(z: complex):\n    return z.__abs__(), phase(z)\n\ndef rect(r: float, phi: float):\n    return r * math.cos(phi) + r * math.sin(phi) * 1j\n\n# Power and logarithmic functions\n\ndef exp(z: complex):\n    return math.exp(z.real) * rect(1, z.imag)\n\ndef log(z: complex, base=2.718281828459045):\n    return math.log(z.__abs__(), base) + phase(z) * 1j\n\ndef log10(z: complex):\n    return log(z, 10)\n\ndef sqrt(z: complex):\n    return z ** 0.5\n\n# Trigonometric functions\n\ndef acos(z: complex):\n    return -1j * log(z + sqrt(z * z - 1))\n\ndef asin(z: complex):\n    return -1j * log(1j * z + sqrt(1 - z * z))\n\ndef atan(z: complex):\n    return 1j / 2 * log((1 - 1j * z) / (1 + 1j * z))\n\ndef cos(z: complex):\n    return (exp(1j * z) + exp(-1j * z)) / 2\n\ndef sin(z: complex):\n    return (exp(1j * z) - exp(-1j * z)) / (2 * 1j)\n\ndef tan(z: complex):\n    return sin(z) / cos(z)\n\n# Hyperbolic functions\n\ndef acosh(z: complex):\n    return log(z + sqrt(z * z - 1))\n\ndef asinh(z: complex):\n    return log(z + sqrt(z * z + 1))\n\ndef atanh(z: complex):\n    return 1 / 2 * log((1 + z) / (1 - z))\n\ndef cosh(z: complex):\n    return (exp(z) + exp(-z)) / 2\n\ndef sinh(z: complex):\n    return (exp(z) - exp(-z)) / 2\n\ndef tanh(z: complex):\n    return sinh(z) / cosh(z)\n\n# Classification functions\n\ndef isfinite(z: complex):\n    return math.isfinite(z.real) and math.isfinite(z.imag)\n\ndef isinf(z: complex):\n    return math.isinf(z.real) or math.isinf(z.imag)\n\ndef isnan(z: complex):\n    return math.isnan(z.real) or math.isnan(z.imag)\n\ndef isclose(a: complex, b: complex):\n    return math.isclose(a.real, b.real) and math.isclose(a.imag, b.imag)\n\n# Constants\n\npi = math.pi\ne = math.e\ntau = 2 * pi\ninf = math.inf\ninfj = complex(0, inf)\nnan = math.nan\nnanj = complex(0, nan)\n";
-const char kPythonLibs_collections[] = "from typing import TypeVar, Iterable\n\ndef Counter[T](iterable: Iterable[T]):\n    a: dict[T, int] = {}\n    for x in iterable:\n        if x in a:\n            a[x] += 1\n        else:\n            a[x] = 1\n    return a\n\n\nclass defaultdict(dict):\n    def __init__(self, default_factory, *args):\n        super().__init__(*args)\n        self.default_factory = default_factory\n\n    def __missing__(self, key):\n        self[key] = self.default_factory()\n        return self[key]\n\n    def __repr__(self) -> str:\n        return f\"defaultdict({self.default_factory}, {super().__repr__()})\"\n\n    def copy(self):\n        return defaultdict(self.default_factory, self)\n\n\nclass deque[T]:\n    _head: int\n    _tail: int\n    _maxlen: int | None\n    _capacity: int\n    _data: list[T]\n\n    def __init__(self, iterable: Iterable[T] = None, maxlen: int | None = None):\n        if maxlen is not None:\n            assert maxlen > 0\n\n        self._head = 0\n        self._tail = 0\n        self._maxlen = maxlen\n        self._capacity = 8 if maxlen is None else maxlen + 1\n        self._data = [None] * self._capacity # type: ignore\n\n        if iterable is not None:\n            self.extend(iterable)\n\n    @property\n    def maxlen(self) -> int | None:\n        return self._maxlen\n\n    def __resize_2x(self):\n        backup = list(self)\n        self._capacity *= 2\n        self._head = 0\n        self._tail = len(backup)\n        self._data.clear()\n        self._data.extend(backup)\n        self._data.extend([None] * (self._capacity - len(backup)))\n\n    def append(self, x: T):\n        if (self._tail + 1) % self._capacity == self._head:\n            if self._maxlen is None:\n                self.__resize_2x()\n            else:\n                self.popleft()\n        self._data[self._tail] = x\n        self._tail = (self._tail + 1) % self._capacity\n\n    def appendleft(self, x: T):\n        if (self._tail + 1) % self._capacity == self._head:\n            if self._maxlen is None:\n                self.__resize_2x()\n            else:\n                self.pop()\n        self._head = (self._head - 1) % self._capacity\n        self._data[self._head] = x\n\n    def copy(self):\n        return deque(self, maxlen=self.maxlen)\n    \n    def count(self, x: T) -> int:\n        n = 0\n        for item in self:\n            if item == x:\n                n += 1\n        return n\n    \n    def extend(self, iterable: Iterable[T]):\n        for x in iterable:\n            self.append(x)\n\n    def extendleft(self, iterable: Iterable[T]):\n        for x in iterable:\n            self.appendleft(x)\n    \n    def pop(self) -> T:\n        if self._head == self._tail:\n            raise IndexError(\"pop from an empty deque\")\n        self._tail = (self._tail - 1) % self._capacity\n        x = self._data[self._tail]\n        self._data[self._tail] = None\n        return x\n    \n    def popleft(self) -> T:\n        if self._head == self._tail:\n            raise IndexError(\"pop from an empty deque\")\n        x = self._data[self._head]\n        self._data[self._head] = None\n        self._head = (self._head + 1) % self._capacity\n        return x\n    \n    def clear(self):\n        i = self._head\n        while i != self._tail:\n            self._data[i] = None # type: ignore\n            i = (i + 1) % self._capacity\n        self._head = 0\n        self._tail = 0\n\n    def rotate(self, n: int = 1):\n        if len(self) == 0:\n            return\n        if n > 0:\n            n = n % len(self)\n            for _ in range(n):\n                self.appendleft(self.pop())\n        elif n < 0:\n            n = -n % len(self)\n            for _ in range(n):\n                self.append(self.popleft())\n\n    def __len__(self) -> int:\n        return (self._tail - self._head) % self._capacity\n\n    def __contains__(self, x: object) -> bool:\n        for item in self:\n            if item == x:\n                return True\n        return False\n    \n    def __iter__(self):\n        i = self._head\n        while i != self._tail:\n            yield self._data[i]\n            i = (i + 1) % self._capacity\n\n    def __eq__(self, other: object) -> bool:\n        if not isinstance(other, deque):\n            return NotImplemented\n        if len(self) != len(other):\n            return False\n        for x, y in zip(self, other):\n            if x != y:\n                return False\n        return True\n    \n    def __ne__(self, other: object) -> bool:\n        if not isinstance(other, deque):\n            return NotImplemented\n        return not self == other\n    \n    def __repr__(self) -> str:\n        if self.maxlen is None:\n            return f\"deque({list(self)!r})\"\n        return f\"deque({list(self)!r}, maxlen={self.maxlen})\"\n\n";
-const char kPythonLibs_dataclasses[] = "def _get_annotations(cls: type):\n    inherits = []\n    while cls is not object:\n        inherits.append(cls)\n        cls = cls.__base__\n    inherits.reverse()\n    res = {}\n    for cls in inherits:\n        res.update(cls.__annotations__)\n    return res.keys()\n\ndef _wrapped__init__(self, *args, **kwargs):\n    cls = type(self)\n    cls_d = cls.__dict__\n    fields = _get_annotations(cls)\n    i = 0   # index into args\n    for field in fields:\n        if field in kwargs:\n            setattr(self, field, kwargs.pop(field))\n        else:\n            if i < len(args):\n                setattr(self, field, args[i])\n                i += 1\n            elif field in cls_d:    # has default value\n                setattr(self, field, cls_d[field])\n            else:\n                raise TypeError(f\"{cls.__name__} missing required argument {field!r}\")\n    if len(args) > i:\n        raise TypeError(f\"{cls.__name__} takes {len(fields)} positional arguments but {len(args)} were given\")\n    if len(kwargs) > 0:\n        raise TypeError(f\"{cls.__name__} got an unexpected keyword argument {next(iter(kwargs))!r}\")\n\ndef _wrapped__repr__(self):\n    fields = _get_annotations(type(self))\n    obj_d = self.__dict__\n    args: list = [f\"{field}={obj_d[field]!r}\" for field in fields]\n    return f\"{type(self).__name__}({', '.join(args)})\"\n\ndef _wrapped__eq__(self, other):\n    if type(self) is not type(other):\n        return False\n    fields = _get_annotations(type(self))\n    for field in fields:\n        if getattr(self, field) != getattr(other, field):\n            return False\n    return True\n\ndef _wrapped__ne__(self, other):\n    return not self.__eq__(other)\n\ndef dataclass(cls: type):\n    assert type(cls) is type\n    cls_d = cls.__dict__\n    if '__init__' not in cls_d:\n        cls.__init__ = _wrapped__init__\n    if '__repr__' not in cls_d:\n        cls.__repr__ = _wrapped__repr__\n    if '__eq__' not in cls_d:\n        cls.__eq__ = _wrapped__eq__\n    if '__ne__' not in cls_d:\n        cls.__ne__ = _wrapped__ne__\n    fields = _get_annotations(cls)\n    has_default = False\n    for field in fields:\n        if field in cls_d:\n            has_default = True\n        else:\n            if has_default:\n                raise TypeError(f\"non-default argument {field!r} follows default argument\")\n    return cls\n\ndef asdict(obj) -> dict:\n    fields = _get_annotations(type(obj))\n    obj_d = obj.__dict__\n    return {field: obj_d[field] for field in fields}";
+const char kPythonLibs_collections[] = "from _collections import Counter, defaultdict, deque\n";
+const char kPythonLibs_dataclasses[] = "def _get_annotations(cls: type):\n    inherits = []\n    while cls is not object:\n        inherits.append(cls)\n        cls = cls.__base__\n    inherits.reverse()\n    res = {}\n    for cls in inherits:\n        res.update(cls.__annotations__)\n    return res.keys()\n\ndef _wrapped__init__(self, *args, **kwargs):\n    cls = type(self)\n    cls_d = cls.__dict__\n    fields = _get_annotations(cls)\n    i = 0   # index into args\n    for field in fields:\n        if field in kwargs:\n            setattr(self, field, kwargs.pop(field))\n        else:\n            if i < len(args):\n                setattr(self, field, args[i])\n                i += 1\n            elif field in cls_d:    # has default value\n                setattr(self, field, cls_d[field])\n            else:\n                raise TypeError(f\"{cls.__name__} missing required argument {field!r}\")\n    if len(args) > i:\n        raise TypeError(f\"{cls.__name__} takes {len(fields)} positional arguments but {len(args)} were given\")\n    if len(kwargs) > 0:\n        raise TypeError(f\"{cls.__name__} got an unexpected keyword argument {next(iter(kwargs))!r}\")\n\ndef _wrapped__repr__(self):\n    fields = _get_annotations(type(self))\n    args: list = [f\"{field}={getattr(self, field)!r}\" for field in fields]\n    return f\"{type(self).__name__}({', '.join(args)})\"\n\ndef _wrapped__eq__(self, other):\n    if type(self) is not type(other):\n        return False\n    fields = _get_annotations(type(self))\n    for field in fields:\n        if getattr(self, field) != getattr(other, field):\n            return False\n    return True\n\ndef _wrapped__ne__(self, other):\n    return not self.__eq__(other)\n\ndef dataclass(cls: type):\n    assert type(cls) is type\n    cls_d = cls.__dict__\n    if '__init__' not in cls_d:\n        cls.__init__ = _wrapped__init__\n    if '__repr__' not in cls_d:\n        cls.__repr__ = _wrapped__repr__\n    if '__eq__' not in cls_d:\n        cls.__eq__ = _wrapped__eq__\n    if '__ne__' not in cls_d:\n        cls.__ne__ = _wrapped__ne__\n    fields = _get_annotations(cls)\n    has_default = False\n    for field in fields:\n        if field in cls_d:\n            has_default = True\n        else:\n            if has_default:\n                raise TypeError(f\"non-default argument {field!r} follows default argument\")\n    return cls\n\ndef asdict(obj) -> dict:\n    fields = _get_annotations(type(obj))\n    return {field: getattr(obj, field) for field in fields}";
 const char kPythonLibs_datetime[] = "from time import localtime\nimport operator\n\nclass timedelta:\n    def __init__(self, days=0, seconds=0):\n        self.days = days\n        self.seconds = seconds\n\n    def __repr__(self):\n        return f\"datetime.timedelta(days={self.days}, seconds={self.seconds})\"\n\n    def __eq__(self, other) -> bool:\n        if not isinstance(other, timedelta):\n            return NotImplemented\n        return (self.days, self.seconds) == (other.days, other.seconds)\n\n    def __ne__(self, other) -> bool:\n        if not isinstance(other, timedelta):\n            return NotImplemented\n        return (self.days, self.seconds) != (other.days, other.seconds)\n\n\nclass date:\n    def __init__(self, year: int, month: int, day: int):\n        self.year = year\n        self.month = month\n        self.day = day\n\n    @staticmethod\n    def today():\n        t = localtime()\n        return date(t.tm_year, t.tm_mon, t.tm_mday)\n    \n    def __cmp(self, other, op):\n        if not isinstance(other, date):\n            return NotImplemented\n        if self.year != other.year:\n            return op(self.year, other.year)\n        if self.month != other.month:\n            return op(self.month, other.month)\n        return op(self.day, other.day)\n\n    def __eq__(self, other) -> bool:\n        return self.__cmp(other, operator.eq)\n    \n    def __ne__(self, other) -> bool:\n        return self.__cmp(other, operator.ne)\n\n    def __lt__(self, other: 'date') -> bool:\n        return self.__cmp(other, operator.lt)\n\n    def __le__(self, other: 'date') -> bool:\n        return self.__cmp(other, operator.le)\n\n    def __gt__(self, other: 'date') -> bool:\n        return self.__cmp(other, operator.gt)\n\n    def __ge__(self, other: 'date') -> bool:\n        return self.__cmp(other, operator.ge)\n\n    def __str__(self):\n        return f\"{self.year}-{self.month:02}-{self.day:02}\"\n\n    def __repr__(self):\n        return f\"datetime.date({self.year}, {self.month}, {self.day})\"\n\n\nclass datetime(date):\n    def __init__(self, year: int, month: int, day: int, hour: int, minute: int, second: int):\n        super().__init__(year, month, day)\n        # Validate and set hour, minute, and second\n        if not 0 <= hour <= 23:\n            raise ValueError(\"Hour must be between 0 and 23\")\n        self.hour = hour\n        if not 0 <= minute <= 59:\n            raise ValueError(\"Minute must be between 0 and 59\")\n        self.minute = minute\n        if not 0 <= second <= 59:\n            raise ValueError(\"Second must be between 0 and 59\")\n        self.second = second\n\n    def date(self) -> date:\n        return date(self.year, self.month, self.day)\n\n    @staticmethod\n    def now():\n        t = localtime()\n        tm_sec = t.tm_sec\n        if tm_sec == 60:\n            tm_sec = 59\n        return datetime(t.tm_year, t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, tm_sec)\n\n    def __str__(self):\n        return f\"{self.year}-{self.month:02}-{self.day:02} {self.hour:02}:{self.minute:02}:{self.second:02}\"\n\n    def __repr__(self):\n        return f\"datetime.datetime({self.year}, {self.month}, {self.day}, {self.hour}, {self.minute}, {self.second})\"\n\n    def __cmp(self, other, op):\n        if not isinstance(other, datetime):\n            return NotImplemented\n        if self.year != other.year:\n            return op(self.year, other.year)\n        if self.month != other.month:\n            return op(self.month, other.month)\n        if self.day != other.day:\n            return op(self.day, other.day)\n        if self.hour != other.hour:\n            return op(self.hour, other.hour)\n        if self.minute != other.minute:\n            return op(self.minute, other.minute)\n        return op(self.second, other.second)\n\n    def __eq__(self, other) -> bool:\n        return self.__cmp(other, operator.eq)\n    \n    def __ne__(self, other) -> bool:\n        return self.__cmp(other, operator.ne)\n    \n    def __lt__(self, other) -> bool:\n        return self.__cmp(other, operator.lt)\n    \n    def __le__(self, other) -> bool:\n        return self.__cmp(other, operator.le)\n    \n    def __gt__(self, other) -> bool:\n        return self.__cmp(other, operator.gt)\n    \n    def __ge__(self, other) -> bool:\n        return self.__cmp(other, operator.ge)\n\n\n";
-const char kPythonLibs_functools[] = "class cache:\n    def __init__(self, f):\n        self.f = f\n        self.cache = {}\n\n    def __call__(self, *args):\n        if args not in self.cache:\n            self.cache[args] = self.f(*args)\n        return self.cache[args]\n    \nclass lru_cache:\n    def __init__(self, maxsize=128):\n        self.maxsize = maxsize\n        self.cache = {}\n\n    def __call__(self, f):\n        def wrapped(*args):\n            if args in self.cache:\n                res = self.cache.pop(args)\n                self.cache[args] = res\n                return res\n            \n            res = f(*args)\n            if len(self.cache) >= self.maxsize:\n                first_key = next(iter(self.cache))\n                self.cache.pop(first_key)\n            self.cache[args] = res\n            return res\n        return wrapped\n    \ndef reduce(function, sequence, initial=...):\n    it = iter(sequence)\n    if initial is ...:\n        try:\n            value = next(it)\n        except StopIteration:\n            raise TypeError(\"reduce() of empty sequence with no initial value\")\n    else:\n        value = initial\n    for element in it:\n        value = function(value, element)\n    return value\n\nclass partial:\n    def __init__(self, f, *args, **kwargs):\n        self.f = f\n        if not callable(f):\n            raise TypeError(\"the first argument must be callable\")\n        self.args = args\n        self.kwargs = kwargs\n\n    def __call__(self, *args, **kwargs):\n        kwargs.update(self.kwargs)\n        return self.f(*self.args, *args, **kwargs)\n\n";
-const char kPythonLibs_heapq[] = "# Heap queue algorithm (a.k.a. priority queue)\ndef heappush(heap, item):\n    \"\"\"Push item onto heap, maintaining the heap invariant.\"\"\"\n    heap.append(item)\n    _siftdown(heap, 0, len(heap)-1)\n\ndef heappop(heap):\n    \"\"\"Pop the smallest item off the heap, maintaining the heap invariant.\"\"\"\n    lastelt = heap.pop()    # raises appropriate IndexError if heap is empty\n    if heap:\n        returnitem = heap[0]\n        heap[0] = lastelt\n        _siftup(heap, 0)\n        return returnitem\n    return lastelt\n\ndef heapreplace(heap, item):\n    \"\"\"Pop and return the current smallest value, and add the new item.\n\n    This is more efficient than heappop() followed by heappush(), and can be\n    more appropriate when using a fixed-size heap.  Note that the value\n    returned may be larger than item!  That constrains reasonable uses of\n    this routine unless written as part of a conditional replacement:\n\n        if item > heap[0]:\n            item = heapreplace(heap, item)\n    \"\"\"\n    returnitem = heap[0]    # raises appropriate IndexError if heap is empty\n    heap[0] = item\n    _siftup(heap, 0)\n    return returnitem\n\ndef heappushpop(heap, item):\n    \"\"\"Fast version of a heappush followed by a heappop.\"\"\"\n    if heap and heap[0] < item:\n        item, heap[0] = heap[0], item\n        _siftup(heap, 0)\n    return item\n\ndef heapify(x):\n    \"\"\"Transform list into a heap, in-place, in O(len(x)) time.\"\"\"\n    n = len(x)\n    # Transform bottom-up.  The largest index there's any point to looking at\n    # is the largest with a child index in-range, so must have 2*i + 1 < n,\n    # or i < (n-1)/2.  If n is even = 2*j, this is (2*j-1)/2 = j-1/2 so\n    # j-1 is the largest, which is n//2 - 1.  If n is odd = 2*j+1, this is\n    # (2*j+1-1)/2 = j so j-1 is the largest, and that's again n//2-1.\n    for i in reversed(range(n//2)):\n        _siftup(x, i)\n\n# 'heap' is a heap at all indices >= startpos, except possibly for pos.  pos\n# is the index of a leaf with a possibly out-of-order value.  Restore the\n# heap invariant.\ndef _siftdown(heap, startpos, pos):\n    newitem = heap[pos]\n    # Follow the path to the root, moving parents down until finding a place\n    # newitem fits.\n    while pos > startpos:\n        parentpos = (pos - 1) >> 1\n        parent = heap[parentpos]\n        if newitem < parent:\n            heap[pos] = parent\n            pos = parentpos\n            continue\n        break\n    heap[pos] = newitem\n\ndef _siftup(heap, pos):\n    endpos = len(heap)\n    startpos = pos\n    newitem = heap[pos]\n    # Bubble up the smaller child until hitting a leaf.\n    childpos = 2*pos + 1    # leftmost child position\n    while childpos < endpos:\n        # Set childpos to index of smaller child.\n        rightpos = childpos + 1\n        if rightpos < endpos and not heap[childpos] < heap[rightpos]:\n            childpos = rightpos\n        # Move the smaller child up.\n        heap[pos] = heap[childpos]\n        pos = childpos\n        childpos = 2*pos + 1\n    # The leaf at pos is empty now.  Put newitem there, and bubble it up\n    # to its final resting place (by sifting its parents down).\n    heap[pos] = newitem\n    _siftdown(heap, startpos, pos)";
+const char kPythonLibs_functools[] = "from _functools import _lru_cache_wrapper, CacheInfo, partial, reduce\n\ndef lru_cache(maxsize=128, typed=False):\n    if callable(maxsize):\n        return _lru_cache_wrapper(maxsize, 128, typed)\n    def decorating_function(user_function):\n        return _lru_cache_wrapper(user_function, maxsize, typed)\n    return decorating_function\n\ndef cache(user_function):\n    return _lru_cache_wrapper(user_function, None)\n";
 const char kPythonLibs_linalg[] = "from vmath import *";
-const char kPythonLibs_operator[] = "# https://docs.python.org/3/library/operator.html#mapping-operators-to-functions\n\ndef le(a, b): return a <= b\ndef lt(a, b): return a < b\ndef ge(a, b): return a >= b\ndef gt(a, b): return a > b\ndef eq(a, b): return a == b\ndef ne(a, b): return a != b\n\ndef and_(a, b): return a & b\ndef or_(a, b): return a | b\ndef xor(a, b): return a ^ b\ndef invert(a): return ~a\ndef lshift(a, b): return a << b\ndef rshift(a, b): return a >> b\n\ndef is_(a, b): return a is b\ndef is_not(a, b): return a is not b\ndef not_(a): return not a\ndef truth(a): return bool(a)\ndef contains(a, b): return b in a\n\ndef add(a, b): return a + b\ndef sub(a, b): return a - b\ndef mul(a, b): return a * b\ndef truediv(a, b): return a / b\ndef floordiv(a, b): return a // b\ndef mod(a, b): return a % b\ndef pow(a, b): return a ** b\ndef neg(a): return -a\ndef matmul(a, b): return a @ b\n\ndef getitem(a, b): return a[b]\ndef setitem(a, b, c): a[b] = c\ndef delitem(a, b): del a[b]\n\ndef iadd(a, b): a += b; return a\ndef isub(a, b): a -= b; return a\ndef imul(a, b): a *= b; return a\ndef itruediv(a, b): a /= b; return a\ndef ifloordiv(a, b): a //= b; return a\ndef imod(a, b): a %= b; return a\n# def ipow(a, b): a **= b; return a\n# def imatmul(a, b): a @= b; return a\ndef iand(a, b): a &= b; return a\ndef ior(a, b): a |= b; return a\ndef ixor(a, b): a ^= b; return a\ndef ilshift(a, b): a <<= b; return a\ndef irshift(a, b): a >>= b; return a\n\nclass attrgetter:\n    def __init__(self, attr):\n        self.attr = attr\n    def __call__(self, obj):\n        return getattr(obj, self.attr)\n";
 const char kPythonLibs_typing[] = "class _Placeholder:\n    def __init__(self, *args, **kwargs):\n        pass\n    def __getitem__(self, *args):\n        return self\n    def __call__(self, *args, **kwargs):\n        return self\n    def __and__(self, other):\n        return self\n    def __or__(self, other):\n        return self\n    def __xor__(self, other):\n        return self\n\n\n_PLACEHOLDER = _Placeholder()\n\nSequence = _PLACEHOLDER\nList = _PLACEHOLDER\nDict = _PLACEHOLDER\nTuple = _PLACEHOLDER\nSet = _PLACEHOLDER\nAny = _PLACEHOLDER\nUnion = _PLACEHOLDER\nOptional = _PLACEHOLDER\nCallable = _PLACEHOLDER\nType = _PLACEHOLDER\nTypeAlias = _PLACEHOLDER\nNewType = _PLACEHOLDER\n\nClassVar = _PLACEHOLDER\n\nLiteral = _PLACEHOLDER\nLiteralString = _PLACEHOLDER\n\nIterable = _PLACEHOLDER\nGenerator = _PLACEHOLDER\nIterator = _PLACEHOLDER\n\nHashable = _PLACEHOLDER\n\nTypeVar = _PLACEHOLDER\nSelf = _PLACEHOLDER\n\nProtocol = object\nGeneric = object\nNever = object\n\nTYPE_CHECKING = False\n\n# decorators\noverload = lambda x: x\nfinal = lambda x: x\n\n# exhaustiveness checking\nassert_never = lambda x: x\n\nTypedDict = dict\nNotRequired = _PLACEHOLDER\n\ncast = lambda _, val: val\n";
 
 const char* load_kPythonLib(const char* name) {
     if (strchr(name, '.') != NULL) return NULL;
-    if (strcmp(name, "bisect") == 0) return kPythonLibs_bisect;
     if (strcmp(name, "builtins") == 0) return kPythonLibs_builtins;
     if (strcmp(name, "cmath") == 0) return kPythonLibs_cmath;
     if (strcmp(name, "collections") == 0) return kPythonLibs_collections;
     if (strcmp(name, "dataclasses") == 0) return kPythonLibs_dataclasses;
     if (strcmp(name, "datetime") == 0) return kPythonLibs_datetime;
     if (strcmp(name, "functools") == 0) return kPythonLibs_functools;
-    if (strcmp(name, "heapq") == 0) return kPythonLibs_heapq;
     if (strcmp(name, "linalg") == 0) return kPythonLibs_linalg;
-    if (strcmp(name, "operator") == 0) return kPythonLibs_operator;
     if (strcmp(name, "typing") == 0) return kPythonLibs_typing;
     return NULL;
 }
@@ -11465,6 +12369,17 @@ void c11_vector__reserve(c11_vector* self, int capacity) {
     self->capacity = capacity;
 }
 
+void c11_vector__shrink(c11_vector* self) {
+    if(self->length == 0) {
+        c11_vector__dtor(self);
+        return;
+    }
+    if(self->capacity == self->length) return;
+    self->data = PK_REALLOC(self->data, (size_t)self->elem_size * (size_t)self->length);
+    if(self->data == NULL) c11__abort("c11_vector__shrink(): out of memory");
+    self->capacity = self->length;
+}
+
 void c11_vector__clear(c11_vector* self) { self->length = 0; }
 
 void* c11_vector__emplace(c11_vector* self) {
@@ -11510,8 +12425,12 @@ void c11_vector__extend(c11_vector* self, const void* p, int size) {
     if (size <= 0) return;
     int min_capacity = self->length + size;
     if(self->capacity < min_capacity) {
+        // `p` may point into our own buffer (`a.extend(a)`), which the reserve moves
+        uintptr_t offset = (uintptr_t)p - (uintptr_t)self->data;
+        bool aliased = self->data != NULL && offset < (uintptr_t)self->length * self->elem_size;
         int nextcap = c11_vector__nextcap(self);
         c11_vector__reserve((self), c11__max(nextcap, min_capacity));
+        if(aliased) p = (char*)self->data + offset;
     }
     void* dst = (char*)self->data + self->length * self->elem_size;
     memcpy(dst, p, size * self->elem_size);
@@ -11599,6 +12518,14 @@ c11_string* c11_sv__replace2(c11_sv self, c11_sv old, c11_sv new_) {
 
 int c11_sv__u8_length(c11_sv sv) { return c11__byte_index_to_unicode(sv.data, sv.size); }
 
+bool c11_sv__is_ascii(c11_sv sv) {
+    unsigned char bits = 0;
+    for(int i = 0; i < sv.size; i++) {
+        bits |= (unsigned char)sv.data[i];
+    }
+    return bits < 0x80;
+}
+
 c11_sv c11_sv__u8_getitem(c11_sv sv, int i) {
     i = c11__unicode_index_to_byte(sv.data, i);
     int size = c11__u8_header(sv.data[i], false);
@@ -11627,34 +12554,53 @@ c11_sv c11_sv__slice2(c11_sv sv, int start, int stop) {
 }
 
 c11_sv c11_sv__strip(c11_sv sv, c11_sv chars, bool left, bool right) {
+    const unsigned char* p = (const unsigned char*)sv.data;
     int L = 0;
-    int R = c11_sv__u8_length(sv);
+    int R = sv.size;
+    bool ascii = true;
+    for(int i = 0; i < chars.size; i++) {
+        if((unsigned char)chars.data[i] >= 0x80) ascii = false;
+    }
+    if(ascii) {
+        // ASCII bytes never occur inside multi-byte sequences, so bytes can be tested directly
+        bool table[128] = {false};
+        for(int i = 0; i < chars.size; i++) {
+            table[(unsigned char)chars.data[i]] = true;
+        }
+        if(left) {
+            while(L < R && p[L] < 0x80 && table[p[L]])
+                L++;
+        }
+        if(right) {
+            while(L < R && p[R - 1] < 0x80 && table[p[R - 1]])
+                R--;
+        }
+        return c11_sv__slice2(sv, L, R);
+    }
     if(left) {
         while(L < R) {
-            c11_sv tmp = c11_sv__u8_getitem(sv, L);
-            bool found = c11_sv__index2(chars, tmp, 0) != -1;
-            if(!found) break;
-            L++;
+            int size = c11__u8_header(p[L], false);
+            if(size == 0) size = 1;
+            if(c11_sv__index2(chars, (c11_sv){sv.data + L, size}, 0) == -1) break;
+            L += size;
         }
     }
     if(right) {
         while(L < R) {
-            c11_sv tmp = c11_sv__u8_getitem(sv, R - 1);
-            bool found = c11_sv__index2(chars, tmp, 0) != -1;
-            if(!found) break;
-            R--;
+            int begin = R - 1;
+            while(begin > L && (p[begin] & 0xC0) == 0x80)
+                begin--;
+            if(c11_sv__index2(chars, (c11_sv){sv.data + begin, R - begin}, 0) == -1) break;
+            R = begin;
         }
     }
-    int start = c11__unicode_index_to_byte(sv.data, L);
-    int stop = c11__unicode_index_to_byte(sv.data, R);
-    return c11_sv__slice2(sv, start, stop);
+    return c11_sv__slice2(sv, L, R);
 }
 
 int c11_sv__index(c11_sv self, char c) {
-    for(int i = 0; i < self.size; i++) {
-        if(self.data[i] == c) return i;
-    }
-    return -1;
+    if(self.size <= 0) return -1;
+    const char* p = memchr(self.data, c, self.size);
+    return p ? (int)(p - self.data) : -1;
 }
 
 int c11_sv__rindex(c11_sv self, char c) {
@@ -11672,14 +12618,156 @@ c11_sv c11_sv__filename(c11_sv self) {
     return c11_sv__slice(self, sep_index + 1);
 }
 
+// Crochemore-Perrin critical factorization, returns the split point and sets the period
+static size_t c11__two_way_factorize(const unsigned char* needle, size_t n, size_t* period) {
+    size_t suffix[2];
+    size_t p[2];
+    for(int rev = 0; rev < 2; rev++) {
+        // maximal suffix for `<` and then for `>`, SIZE_MAX stands for -1
+        size_t max_suffix = SIZE_MAX, j = 0, k = 1;
+        p[rev] = 1;
+        while(j + k < n) {
+            unsigned char a = needle[j + k];
+            unsigned char b = needle[max_suffix + k];
+            if(rev ? b < a : a < b) {
+                j += k;
+                k = 1;
+                p[rev] = j - max_suffix;
+            } else if(a == b) {
+                if(k != p[rev]) {
+                    k++;
+                } else {
+                    j += p[rev];
+                    k = 1;
+                }
+            } else {
+                max_suffix = j++;
+                k = p[rev] = 1;
+            }
+        }
+        suffix[rev] = max_suffix + 1;
+    }
+    int i = suffix[1] < suffix[0] ? 0 : 1;
+    *period = p[i];
+    return suffix[i];
+}
+
+// Two-Way string matching, linear in the haystack size for any needle
+static const char* c11__two_way_search(const char* haystack, size_t n, const char* needle_, size_t m) {
+    const unsigned char* h = (const unsigned char*)haystack;
+    const unsigned char* needle = (const unsigned char*)needle_;
+    size_t period;
+    size_t suffix = c11__two_way_factorize(needle, m, &period);
+    size_t i, j = 0;
+    if(memcmp(needle, needle + period, suffix) == 0) {
+        // periodic needle, remember how much of the right half is already known to match
+        size_t memory = 0;
+        while(j + m <= n) {
+            i = c11__max(suffix, memory);
+            while(i < m && needle[i] == h[i + j])
+                i++;
+            if(i >= m) {
+                i = suffix - 1;
+                while(memory < i + 1 && needle[i] == h[i + j])
+                    i--;
+                if(i + 1 < memory + 1) return haystack + j;
+                j += period;
+                memory = m - period;
+            } else {
+                j += i - suffix + 1;
+                memory = 0;
+            }
+        }
+    } else {
+        period = c11__max(suffix, m - suffix) + 1;
+        while(j + m <= n) {
+            i = suffix;
+            while(i < m && needle[i] == h[i + j])
+                i++;
+            if(i >= m) {
+                i = suffix - 1;
+                while(i != SIZE_MAX && needle[i] == h[i + j])
+                    i--;
+                if(i == SIZE_MAX) return haystack + j;
+                j += period;
+            } else {
+                j += i - suffix + 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Candidates have to match both the first and the last byte of the needle, which is tested
+// 16 positions at a time. Verification work is budgeted, so pathological inputs switch to Two-Way.
+static const char* c11__memmem(const char* h, int n, const char* needle, int m) {
+    assert(m >= 2 && n >= m);
+    const char first = needle[0];
+    const char last = needle[m - 1];
+    int64_t budget = 4096;
+    int i = 0;
+#if PK_SIMD_SSE2
+    const __m128i v_first = _mm_set1_epi8(first);
+    const __m128i v_last = _mm_set1_epi8(last);
+    for(; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, v_first), _mm_cmpeq_epi8(b, v_last));
+        uint64_t mask = (uint64_t)_mm_movemask_epi8(eq);
+        while(mask != 0) {
+            int k = i + c11__ctz64(mask);
+            if(memcmp(h + k + 1, needle + 1, m - 2) == 0) return h + k;
+            budget -= m;
+            if(budget < 0) return c11__two_way_search(h + k + 1, n - k - 1, needle, m);
+            mask &= mask - 1;
+        }
+        budget += 16;
+    }
+#elif PK_SIMD_NEON
+    const uint8x16_t v_first = vdupq_n_u8((uint8_t)first);
+    const uint8x16_t v_last = vdupq_n_u8((uint8_t)last);
+    for(; i + m - 1 + 16 <= n; i += 16) {
+        uint8x16_t a = vld1q_u8((const uint8_t*)h + i);
+        uint8x16_t b = vld1q_u8((const uint8_t*)h + i + m - 1);
+        uint8x16_t eq = vandq_u8(vceqq_u8(a, v_first), vceqq_u8(b, v_last));
+        // there is no movemask on NEON, narrow every byte to 4 bits and keep one of them
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ull;
+        while(mask != 0) {
+            int k = i + (c11__ctz64(mask) >> 2);
+            if(memcmp(h + k + 1, needle + 1, m - 2) == 0) return h + k;
+            budget -= m;
+            if(budget < 0) return c11__two_way_search(h + k + 1, n - k - 1, needle, m);
+            mask &= mask - 1;
+        }
+        budget += 16;
+    }
+#endif
+    // portable path and tail: jump to the next first byte with memchr
+    while(i + m <= n) {
+        const char* p = memchr(h + i, first, n - m + 1 - i);
+        if(p == NULL) return NULL;
+        budget += p - (h + i);
+        i = (int)(p - h);
+        if(h[i + m - 1] == last && memcmp(h + i + 1, needle + 1, m - 2) == 0) return h + i;
+        budget -= m;
+        if(budget < 0) return c11__two_way_search(h + i + 1, n - i - 1, needle, m);
+        i++;
+    }
+    return NULL;
+}
+
 int c11_sv__index2(c11_sv self, c11_sv sub, int start) {
     if(sub.size == 0) return start;
-    int max_end = self.size - sub.size;
-    for(int i = start; i <= max_end; i++) {
-        int res = memcmp(self.data + i, sub.data, sub.size);
-        if(res == 0) return i;
+    if(self.size - start < sub.size) return -1;
+    const char* h = self.data + start;
+    const char* p;
+    if(sub.size == 1) {
+        p = memchr(h, sub.data[0], self.size - start);
+    } else {
+        p = c11__memmem(h, self.size - start, sub.data, sub.size);
     }
-    return -1;
+    return p ? (int)(p - self.data) : -1;
 }
 
 int c11_sv__count(c11_sv self, c11_sv sub) {
@@ -11705,12 +12793,32 @@ bool c11_sv__endswith(c11_sv self, c11_sv suffix) {
     return memcmp(self.data + self.size - suffix.size, suffix.data, suffix.size) == 0;
 }
 
+// word-at-a-time multiplicative hash, the tail is read with overlapping loads
 uint64_t c11_sv__hash(c11_sv self) {
-    uint64_t hash = 5381;
-    for(int i = 0; i < self.size; i++) {
-        // hash * 33 + c
-        hash = ((hash << 5) + hash) + (unsigned char)self.data[i];
-    }
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    const unsigned char* p = (const unsigned char*)self.data;
+    int n = self.size;
+    uint64_t hash = (uint64_t)n * k;
+    while(n >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        hash = (((hash << 5) | (hash >> 59)) ^ w) * k;
+        p += 8;
+        n -= 8;
+    }
+    if(n >= 4) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + n - 4, 4);
+        hash = (((hash << 5) | (hash >> 59)) ^ (lo | ((uint64_t)hi << 32))) * k;
+    } else if(n > 0) {
+        uint64_t w = p[0] | ((uint64_t)p[n >> 1] << 8) | ((uint64_t)p[n - 1] << 16);
+        hash = (((hash << 5) | (hash >> 59)) ^ w) * k;
+    }
+    // mix high bits down, callers may only use the low bits
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ull;
+    hash ^= hash >> 32;
     return hash;
 }
 
@@ -11738,19 +12846,16 @@ c11_vector /* T=c11_sv */ c11_sv__split(c11_sv self, char sep) {
     c11_vector retval;
     c11_vector__ctor(&retval, sizeof(c11_sv));
     const char* data = self.data;
-    int i = 0;
-    for(int j = 0; j < self.size; j++) {
-        if(data[j] == sep) {
-            assert(j >= i);
-            c11_sv tmp = {data + i, j - i};
-            c11_vector__push(c11_sv, &retval, tmp);
-            i = j + 1;
-        }
-    }
-    if(i <= self.size) {
-        c11_sv tmp = {data + i, self.size - i};
+    const char* end = self.data + self.size;
+    while(data < end) {
+        const char* p = memchr(data, sep, end - data);
+        if(p == NULL) break;
+        c11_sv tmp = {data, (int)(p - data)};
         c11_vector__push(c11_sv, &retval, tmp);
+        data = p + 1;
     }
+    c11_sv tmp = {data, (int)(end - data)};
+    c11_vector__push(c11_sv, &retval, tmp);
     return retval;
 }
 
@@ -11812,6 +12917,7 @@ bool c11__streq(const char* a, const char* b) { return strcmp(a, b) == 0; }
 
 bool c11__sveq(c11_sv a, c11_sv b) {
     if(a.size != b.size) return false;
+    if(a.data == b.data) return true;
     return memcmp(a.data, b.data, a.size) == 0;
 }
 
@@ -13508,59 +14614,462 @@ void pk_sprintf(c11_sbuf* ss, const char* fmt, ...) {
 // src/common/algorithm.c
 #include <string.h>
 
-static bool _stable_sort_merge(char* a,
-                  char* a_end,
-                  char* b,
-                  char* b_end,
-                  char* r,
-                  int elem_size,
-                  int (*f_lt)(const void* a, const void* b, void* extra),
-                  void* extra) {
-    while(a < a_end && b < b_end) {
-        int res = f_lt(b, a, extra);
-        // check error
+// Timsort: natural runs are extended to a minimum length by binary insertion and merged
+// with galloping, so partially sorted input costs close to n comparisons.
+// Every step keeps the array a permutation of the input, also when `f_lt` fails.
+#define kTimSortMinGallop 7
+#define kTimSortMaxRuns 85
+
+typedef struct TimSort {
+    char* base;
+    int elem_size;
+    int (*f_lt)(const void* a, const void* b, void* extra);
+    void* extra;
+    char* tmp;  // merge buffer, `tmp[0]` doubles as the pivot of insertion sort
+    int tmp_length;
+    int min_gallop;
+    int n_runs;
+    int run_base[kTimSortMaxRuns];
+    int run_len[kTimSortMaxRuns];
+} TimSort;
+
+static char* TimSort__at(TimSort* self, char* p, int i) { return p + (size_t)i * self->elem_size; }
+
+static void TimSort__copy(TimSort* self, char* dst, const char* src, int n) {
+    memmove(dst, src, (size_t)n * self->elem_size);
+}
+
+static void TimSort__reserve(TimSort* self, int n) {
+    if(self->tmp_length >= n) return;
+    PK_FREE(self->tmp);
+    self->tmp_length = c11__max(n, 64);
+    self->tmp = PK_MALLOC((size_t)self->tmp_length * self->elem_size);
+}
+
+static void TimSort__reverse(TimSort* self, char* lo, int n) {
+    char* hi = TimSort__at(self, lo, n - 1);
+    for(; lo < hi; lo += self->elem_size, hi -= self->elem_size) {
+        memcpy(self->tmp, lo, self->elem_size);
+        memcpy(lo, hi, self->elem_size);
+        memcpy(hi, self->tmp, self->elem_size);
+    }
+}
+
+static int TimSort__min_run(int n) {
+    int r = 0;
+    while(n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+// sort `lo[0:n]` where `lo[0:start]` is already sorted
+static bool TimSort__binary_insertion(TimSort* self, char* lo, int n, int start) {
+    char* pivot = self->tmp;
+    for(int i = start; i < n; i++) {
+        memcpy(pivot, TimSort__at(self, lo, i), self->elem_size);
+        // insert after equal items to keep the sort stable
+        int l = 0, r = i;
+        while(l < r) {
+            int m = (l + r) / 2;
+            int res = self->f_lt(pivot, TimSort__at(self, lo, m), self->extra);
+            if(res == -1) return false;
+            if(res) {
+                r = m;
+            } else {
+                l = m + 1;
+            }
+        }
+        TimSort__copy(self, TimSort__at(self, lo, l + 1), TimSort__at(self, lo, l), i - l);
+        memcpy(TimSort__at(self, lo, l), pivot, self->elem_size);
+    }
+    return true;
+}
+
+// length of the run at `lo`, a strictly descending run is reversed in place
+static int TimSort__count_run(TimSort* self, char* lo, int n) {
+    if(n == 1) return 1;
+    int res = self->f_lt(TimSort__at(self, lo, 1), lo, self->extra);
+    if(res == -1) return -1;
+    bool descending = res;
+    int i = 2;
+    for(; i < n; i++) {
+        res = self->f_lt(TimSort__at(self, lo, i), TimSort__at(self, lo, i - 1), self->extra);
+        if(res == -1) return -1;
+        if(res != descending) break;
+    }
+    if(descending) TimSort__reverse(self, lo, i);
+    return i;
+}
+
+// the index `k` such that `a[k-1] < key <= a[k]`, searching from `a[hint]`
+static bool TimSort__gallop_left(TimSort* self, char* key, char* a, int n, int hint, int* out) {
+    int lastofs = 0, ofs = 1;
+    int res = self->f_lt(TimSort__at(self, a, hint), key, self->extra);
+    if(res == -1) return false;
+    if(res) {
+        // a[hint] < key, gallop right until a[hint + lastofs] < key <= a[hint + ofs]
+        int maxofs = n - hint;
+        while(ofs < maxofs) {
+            res = self->f_lt(TimSort__at(self, a, hint + ofs), key, self->extra);
+            if(res == -1) return false;
+            if(!res) break;
+            lastofs = ofs;
+            ofs = ofs < maxofs / 2 ? (ofs << 1) + 1 : maxofs;
+        }
+        if(ofs > maxofs) ofs = maxofs;
+        lastofs += hint;
+        ofs += hint;
+    } else {
+        // key <= a[hint], gallop left until a[hint - ofs] < key <= a[hint - lastofs]
+        int maxofs = hint + 1;
+        while(ofs < maxofs) {
+            res = self->f_lt(TimSort__at(self, a, hint - ofs), key, self->extra);
+            if(res == -1) return false;
+            if(res) break;
+            lastofs = ofs;
+            ofs = ofs < maxofs / 2 ? (ofs << 1) + 1 : maxofs;
+        }
+        if(ofs > maxofs) ofs = maxofs;
+        int k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    }
+    // a[lastofs] < key <= a[ofs], binary search in between
+    lastofs++;
+    while(lastofs < ofs) {
+        int m = lastofs + ((ofs - lastofs) >> 1);
+        res = self->f_lt(TimSort__at(self, a, m), key, self->extra);
         if(res == -1) return false;
-        if(res == 0) {  // !(b<a) -> (b>=a) -> (a<=b)
-            memcpy(r, a, elem_size);
-            a += elem_size;
+        if(res) {
+            lastofs = m + 1;
         } else {
-            memcpy(r, b, elem_size);
-            b += elem_size;
+            ofs = m;
         }
-        r += elem_size;
     }
+    *out = ofs;
+    return true;
+}
 
-    // one of the arrays is empty
-    for(; a < a_end; a += elem_size, r += elem_size)
-        memcpy(r, a, elem_size);
-    for(; b < b_end; b += elem_size, r += elem_size)
-        memcpy(r, b, elem_size);
+// the index `k` such that `a[k-1] <= key < a[k]`, searching from `a[hint]`
+static bool TimSort__gallop_right(TimSort* self, char* key, char* a, int n, int hint, int* out) {
+    int lastofs = 0, ofs = 1;
+    int res = self->f_lt(key, TimSort__at(self, a, hint), self->extra);
+    if(res == -1) return false;
+    if(res) {
+        // key < a[hint], gallop left until a[hint - ofs] <= key < a[hint - lastofs]
+        int maxofs = hint + 1;
+        while(ofs < maxofs) {
+            res = self->f_lt(key, TimSort__at(self, a, hint - ofs), self->extra);
+            if(res == -1) return false;
+            if(!res) break;
+            lastofs = ofs;
+            ofs = ofs < maxofs / 2 ? (ofs << 1) + 1 : maxofs;
+        }
+        if(ofs > maxofs) ofs = maxofs;
+        int k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    } else {
+        // a[hint] <= key, gallop right until a[hint + lastofs] <= key < a[hint + ofs]
+        int maxofs = n - hint;
+        while(ofs < maxofs) {
+            res = self->f_lt(key, TimSort__at(self, a, hint + ofs), self->extra);
+            if(res == -1) return false;
+            if(res) break;
+            lastofs = ofs;
+            ofs = ofs < maxofs / 2 ? (ofs << 1) + 1 : maxofs;
+        }
+        if(ofs > maxofs) ofs = maxofs;
+        lastofs += hint;
+        ofs += hint;
+    }
+    // a[lastofs] <= key < a[ofs], binary search in between
+    lastofs++;
+    while(lastofs < ofs) {
+        int m = lastofs + ((ofs - lastofs) >> 1);
+        res = self->f_lt(key, TimSort__at(self, a, m), self->extra);
+        if(res == -1) return false;
+        if(res) {
+            ofs = m;
+        } else {
+            lastofs = m + 1;
+        }
+    }
+    *out = ofs;
     return true;
 }
 
-bool c11__stable_sort(void* ptr_,
-                      int length,
-                      int elem_size,
-                      int (*f_lt)(const void* a, const void* b, void* extra),
-                      void* extra) {
-    // merge sort
-    char *ptr = ptr_, *tmp = PK_MALLOC(length * elem_size);
-    for(int seg = 1; seg < length; seg *= 2) {
-        for(char* a = ptr; a < ptr + (length - seg) * elem_size; a += 2 * seg * elem_size) {
-            char *b = a + seg * elem_size, *a_end = b, *b_end = b + seg * elem_size;
-            if(b_end > ptr + length * elem_size) b_end = ptr + length * elem_size;
-            bool ok = _stable_sort_merge(a, a_end, b, b_end, tmp, elem_size, f_lt, extra);
-            if(!ok) {
-                PK_FREE(tmp);
-                return false;
+// merge the adjacent runs `a[0:na]` and `b[0:nb]` where `na <= nb`,
+// `b[0] < a[0]` and `a[na-1]` is greater than every item of b
+static bool TimSort__merge_lo(TimSort* self, char* a, int na, char* b, int nb) {
+    int size = self->elem_size;
+    TimSort__reserve(self, na);
+    memcpy(self->tmp, a, (size_t)na * size);
+    char* dest = a;
+    char* pa = self->tmp;
+    char* pb = b;
+    int min_gallop = self->min_gallop;
+    bool ok = true;
+
+    memcpy(dest, pb, size);
+    dest += size, pb += size, nb--;
+    if(nb == 0) goto __SUCCEED;
+    if(na == 1) goto __COPY_B;
+
+    while(true) {
+        int acount = 0, bcount = 0;
+        // one pair at a time until a run starts winning consistently
+        while(true) {
+            int res = self->f_lt(pb, pa, self->extra);
+            if(res == -1) goto __FAIL;
+            if(res) {
+                memcpy(dest, pb, size);
+                dest += size, pb += size, nb--;
+                if(nb == 0) goto __SUCCEED;
+                acount = 0;
+                if(++bcount >= min_gallop) break;
+            } else {
+                memcpy(dest, pa, size);
+                dest += size, pa += size, na--;
+                if(na == 1) goto __COPY_B;
+                bcount = 0;
+                if(++acount >= min_gallop) break;
+            }
+        }
+        // gallop while a run keeps winning by large chunks
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            self->min_gallop = min_gallop;
+            int k;
+            if(!TimSort__gallop_right(self, pb, pa, na, 0, &k)) goto __FAIL;
+            acount = k;
+            if(k) {
+                memcpy(dest, pa, (size_t)k * size);
+                dest += k * size, pa += k * size, na -= k;
+                if(na == 1) goto __COPY_B;
+                // only possible with an inconsistent comparison
+                if(na == 0) goto __SUCCEED;
+            }
+            memcpy(dest, pb, size);
+            dest += size, pb += size, nb--;
+            if(nb == 0) goto __SUCCEED;
+
+            if(!TimSort__gallop_left(self, pa, pb, nb, 0, &k)) goto __FAIL;
+            bcount = k;
+            if(k) {
+                memmove(dest, pb, (size_t)k * size);
+                dest += k * size, pb += k * size, nb -= k;
+                if(nb == 0) goto __SUCCEED;
+            }
+            memcpy(dest, pa, size);
+            dest += size, pa += size, na--;
+            if(na == 1) goto __COPY_B;
+        } while(acount >= kTimSortMinGallop || bcount >= kTimSortMinGallop);
+        self->min_gallop = ++min_gallop;
+    }
+
+__FAIL:
+    ok = false;
+__SUCCEED:
+    if(na) memcpy(dest, pa, (size_t)na * size);
+    return ok;
+__COPY_B:
+    // the last item of a belongs at the end of the merge
+    memmove(dest, pb, (size_t)nb * size);
+    memcpy(dest + nb * size, pa, size);
+    return true;
+}
+
+// merge the adjacent runs `a[0:na]` and `b[0:nb]` where `na >= nb`,
+// `b[0] < a[0]` and `a[na-1]` is greater than every item of b
+static bool TimSort__merge_hi(TimSort* self, char* a, int na, char* b, int nb) {
+    int size = self->elem_size;
+    TimSort__reserve(self, nb);
+    memcpy(self->tmp, b, (size_t)nb * size);
+    char* base_a = a;
+    char* base_b = self->tmp;
+    char* dest = b + (nb - 1) * size;
+    char* pa = a + (na - 1) * size;
+    char* pb = base_b + (nb - 1) * size;
+    int min_gallop = self->min_gallop;
+    bool ok = true;
+
+    memcpy(dest, pa, size);
+    dest -= size, pa -= size, na--;
+    if(na == 0) goto __SUCCEED;
+    if(nb == 1) goto __COPY_A;
+
+    while(true) {
+        int acount = 0, bcount = 0;
+        // one pair at a time until a run starts winning consistently
+        while(true) {
+            int res = self->f_lt(pb, pa, self->extra);
+            if(res == -1) goto __FAIL;
+            if(res) {
+                memcpy(dest, pa, size);
+                dest -= size, pa -= size, na--;
+                if(na == 0) goto __SUCCEED;
+                bcount = 0;
+                if(++acount >= min_gallop) break;
+            } else {
+                memcpy(dest, pb, size);
+                dest -= size, pb -= size, nb--;
+                if(nb == 1) goto __COPY_A;
+                acount = 0;
+                if(++bcount >= min_gallop) break;
             }
-            memcpy(a, tmp, b_end - a);
         }
+        // gallop while a run keeps winning by large chunks
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            self->min_gallop = min_gallop;
+            int k;
+            if(!TimSort__gallop_right(self, pb, base_a, na, na - 1, &k)) goto __FAIL;
+            k = na - k;
+            acount = k;
+            if(k) {
+                dest -= k * size, pa -= k * size, na -= k;
+                memmove(dest + size, pa + size, (size_t)k * size);
+                if(na == 0) goto __SUCCEED;
+            }
+            memcpy(dest, pb, size);
+            dest -= size, pb -= size, nb--;
+            if(nb == 1) goto __COPY_A;
+
+            if(!TimSort__gallop_left(self, pa, base_b, nb, nb - 1, &k)) goto __FAIL;
+            k = nb - k;
+            bcount = k;
+            if(k) {
+                dest -= k * size, pb -= k * size, nb -= k;
+                memcpy(dest + size, pb + size, (size_t)k * size);
+                if(nb == 1) goto __COPY_A;
+                // only possible with an inconsistent comparison
+                if(nb == 0) goto __SUCCEED;
+            }
+            memcpy(dest, pa, size);
+            dest -= size, pa -= size, na--;
+            if(na == 0) goto __SUCCEED;
+        } while(acount >= kTimSortMinGallop || bcount >= kTimSortMinGallop);
+        self->min_gallop = ++min_gallop;
+    }
+
+__FAIL:
+    ok = false;
+__SUCCEED:
+    if(nb) memcpy(dest - (nb - 1) * size, base_b, (size_t)nb * size);
+    return ok;
+__COPY_A:
+    // the first item of b belongs at the front of the merge
+    dest -= na * size, pa -= na * size;
+    memmove(dest + size, pa + size, (size_t)na * size);
+    memcpy(dest, pb, size);
+    return true;
+}
+
+// merge the runs at stack indices `i` and `i + 1`
+static bool TimSort__merge_at(TimSort* self, int i) {
+    char* a = TimSort__at(self, self->base, self->run_base[i]);
+    char* b = TimSort__at(self, self->base, self->run_base[i + 1]);
+    int na = self->run_len[i];
+    int nb = self->run_len[i + 1];
+    self->run_len[i] = na + nb;
+    if(i == self->n_runs - 3) {
+        self->run_base[i + 1] = self->run_base[i + 2];
+        self->run_len[i + 1] = self->run_len[i + 2];
+    }
+    self->n_runs--;
+    // items of a before b[0] are already in place
+    int k;
+    if(!TimSort__gallop_right(self, b, a, na, 0, &k)) return false;
+    a = TimSort__at(self, a, k);
+    na -= k;
+    if(na == 0) return true;
+    // items of b after a[na-1] are already in place
+    if(!TimSort__gallop_left(self, TimSort__at(self, a, na - 1), b, nb, nb - 1, &nb)) return false;
+    if(nb == 0) return true;
+    if(na <= nb) return TimSort__merge_lo(self, a, na, b, nb);
+    return TimSort__merge_hi(self, a, na, b, nb);
+}
+
+// keep run lengths decreasing faster than the Fibonacci numbers, which bounds the stack depth
+static bool TimSort__merge_collapse(TimSort* self) {
+    int* len = self->run_len;
+    while(self->n_runs > 1) {
+        int k = self->n_runs - 2;
+        if((k > 0 && len[k - 1] <= len[k] + len[k + 1]) ||
+           (k > 1 && len[k - 2] <= len[k - 1] + len[k])) {
+            if(len[k - 1] < len[k + 1]) k--;
+        } else if(len[k] > len[k + 1]) {
+            break;
+        }
+        if(!TimSort__merge_at(self, k)) return false;
     }
-    PK_FREE(tmp);
     return true;
 }
 
+static bool TimSort__merge_force_collapse(TimSort* self) {
+    int* len = self->run_len;
+    while(self->n_runs > 1) {
+        int k = self->n_runs - 2;
+        if(k > 0 && len[k - 1] < len[k + 1]) k--;
+        if(!TimSort__merge_at(self, k)) return false;
+    }
+    return true;
+}
+
+static bool TimSort__sort(TimSort* self, int length) {
+    int min_run = TimSort__min_run(length);
+    int lo = 0;
+    while(lo < length) {
+        int remaining = length - lo;
+        char* p = TimSort__at(self, self->base, lo);
+        int n = TimSort__count_run(self, p, remaining);
+        if(n == -1) return false;
+        if(n < min_run) {
+            // extend short runs with insertion sort
+            int force = c11__min(remaining, min_run);
+            if(!TimSort__binary_insertion(self, p, force, n)) return false;
+            n = force;
+        }
+        self->run_base[self->n_runs] = lo;
+        self->run_len[self->n_runs] = n;
+        self->n_runs++;
+        if(!TimSort__merge_collapse(self)) return false;
+        lo += n;
+    }
+    return TimSort__merge_force_collapse(self);
+}
+
+bool c11__stable_sort(void* ptr,
+                      int length,
+                      int elem_size,
+                      int (*f_lt)(const void* a, const void* b, void* extra),
+                      void* extra) {
+    if(length < 2) return true;
+    TimSort self = {
+        .base = ptr,
+        .elem_size = elem_size,
+        .f_lt = f_lt,
+        .extra = extra,
+        .tmp = NULL,
+        .tmp_length = 0,
+        .min_gallop = kTimSortMinGallop,
+        .n_runs = 0,
+    };
+    TimSort__reserve(&self, 1);
+    bool ok = TimSort__sort(&self, length);
+    PK_FREE(self.tmp);
+    return ok;
+}
+
+
+#undef kTimSortMinGallop
+#undef kTimSortMaxRuns
+
 // src/common/name.c
 #if PK_ENABLE_CUSTOM_SNAME == 0
 
@@ -13936,6 +15445,24 @@ PK_INLINE int c11__bit_length(unsigned long x) {
 #endif
 }
 
+PK_INLINE int c11__ctz64(uint64_t x) {
+    assert(x != 0);
+#if(defined(__clang__) || defined(__GNUC__))
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+#else
+    int n = 0;
+    while((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
 void c11_chunkedvector__ctor(c11_chunkedvector* self, int elem_size, int initial_chunks) {
     if(initial_chunks < 5) initial_chunks = 5;
     c11_vector__ctor(&self->chunks, sizeof(c11_chunkedvector_chunk));
@@ -15140,7 +16667,7 @@ void py_newint(py_OutRef out, py_i64 val) {
 void py_newtrivial(py_OutRef out, py_Type type, void* data, int size) {
     out->type = type;
     out->is_ptr = false;
-    assert(size <= 16);
+    assert(size <= sizeof(out->_chars));
     memcpy(&out->_chars, data, size);
 }
 
@@ -15158,18 +16685,26 @@ void py_newbool(py_OutRef out, bool val) {
 
 void py_newstr(py_OutRef out, const char* data) { py_newstrv(out, (c11_sv){data, strlen(data)}); }
 
-char* py_newstrn(py_OutRef out, int size) {
-    if(size < 16) {
+char* py_newstrn(py_OutRef out, int size) { return pk_newstrn(out, size, false); }
+
+// `ascii` promises that the caller only writes ASCII bytes, so no code point index is reserved
+char* pk_newstrn(py_OutRef out, int size, bool ascii) {
+    // inline strings live in `extra` and `_chars`: int size | char[] | '\0'
+    if(size < (int)sizeof(out->_chars)) {
         out->type = tp_str;
         out->is_ptr = false;
         c11_string* ud = (c11_string*)(&out->extra);
         c11_string__ctor3(ud, size);
         return ud->data;
     }
+    // heap strings start with a `StrHeader`, whose fields are computed on first use
+    // substring views and ropes (see `pk_newsubstr` and `pk_newconcat`) carry slots instead
     ManagedHeap* heap = &pk_current_vm->heap;
-    int total_size = sizeof(c11_string) + size + 1;
-    PyObject* obj = ManagedHeap__gcnew(heap, tp_str, 0, total_size);
-    c11_string* ud = PyObject__userdata(obj);
+    PyObject* obj = ManagedHeap__gcnew(heap, tp_str, 0, StrHeader__alloc_size(size, ascii));
+    StrHeader* header = PyObject__userdata(obj);
+    header->hash = 0;
+    header->u8_length = ascii ? size : -1;
+    c11_string* ud = StrHeader__str(header);
     c11_string__ctor3(ud, size);
     out->type = tp_str;
     out->is_ptr = true;
@@ -15178,7 +16713,8 @@ char* py_newstrn(py_OutRef out, int size) {
 }
 
 void py_newstrv(py_OutRef out, c11_sv sv) {
-    char* data = py_newstrn(out, sv.size);
+    bool ascii = sv.size >= PK_STR_INDEX_MIN_SIZE && c11_sv__is_ascii(sv);
+    char* data = pk_newstrn(out, sv.size, ascii);
     memcpy(data, sv.data, sv.size);
 }
 
@@ -15501,6 +17037,15 @@ int py_equal(py_Ref lhs, py_Ref rhs) {
 }
 
 int py_less(py_Ref lhs, py_Ref rhs) {
+    // builtin scalars of the same type are compared without dispatching `__lt__`
+    if(lhs->type == rhs->type) {
+        switch(lhs->type) {
+            case tp_int: return lhs->_i64 < rhs->_i64;
+            case tp_float: return lhs->_f64 < rhs->_f64;
+            case tp_str: return c11_sv__cmp(py_tosv(lhs), py_tosv(rhs)) < 0;
+            default: break;
+        }
+    }
     if(!py_lt(lhs, rhs)) return -1;
     return py_bool(py_retval());
 }
@@ -15543,6 +17088,10 @@ bool py_iter(py_Ref val) {
 
 int py_next(py_Ref val) {
     VM* vm = pk_current_vm;
+    // native loops over iterables are safe points for the memory limit, like `for` loops
+    if(vm->heap.memory_exceeded) {
+        if(!ManagedHeap__check_memory_limit(&vm->heap)) return -1;
+    }
 
     switch(val->type) {
         case tp_generator:
@@ -15566,6 +17115,24 @@ int py_next(py_Ref val) {
         case tp_str_iterator:
             if(str_iterator__next__(1, val)) return 1;
             break;
+        case tp_map:
+            if(map__next__(1, val)) return 1;
+            break;
+        case tp_filter:
+            if(filter__next__(1, val)) return 1;
+            break;
+        case tp_zip:
+            if(zip__next__(1, val)) return 1;
+            break;
+        case tp_enumerate:
+            if(enumerate__next__(1, val)) return 1;
+            break;
+        case tp_reversed:
+            if(reversed__next__(1, val)) return 1;
+            break;
+        case tp_deque_iterator:
+            if(deque_iterator__next__(1, val)) return 1;
+            break;
         default: {
             py_Ref tmp = py_tpfindmagic(val->type, __next__);
             if(!tmp) {
@@ -15610,6 +17177,15 @@ bool py_getattr(py_Ref self, py_Name name) {
             py_Ref getter = py_getslot(cls_var, 0);
             return py_call(getter, 1, self);
         }
+        if(py_istype(cls_var, tp_member_descriptor)) {
+            MemberDescriptor* md = py_touserdata(cls_var);
+            if(self->is_ptr && md->index < self->_obj->slots) {
+                py_Ref res = PyObject__slots(self->_obj) + md->index;
+                if(py_isnil(res)) return AttributeError(self, name);
+                py_assign(py_retval(), res);
+                return true;
+            }
+        }
     }
     // handle instance __dict__
     if(self->is_ptr && self->_obj->slots == -1) {
@@ -15650,6 +17226,10 @@ bool py_getattr(py_Ref self, py_Name name) {
                 py_newboundmethod(py_retval(), self, cls_var);
                 return true;
             }
+            case tp_lru_cache_wrapper: {
+                py_newboundmethod(py_retval(), self, cls_var);
+                return true;
+            }
             case tp_staticmethod: {
                 py_assign(py_retval(), py_getslot(cls_var, 0));
                 return true;
@@ -15710,6 +17290,13 @@ bool py_setattr(py_Ref self, py_Name name, py_Ref val) {
                 return TypeError("readonly attribute: '%n'", name);
             }
         }
+        if(py_istype(cls_var, tp_member_descriptor)) {
+            MemberDescriptor* md = py_touserdata(cls_var);
+            if(self->is_ptr && md->index < self->_obj->slots) {
+                PyObject__slots(self->_obj)[md->index] = *val;
+                return true;
+            }
+        }
     }
 
     // handle instance __dict__
@@ -15718,6 +17305,7 @@ bool py_setattr(py_Ref self, py_Name name, py_Ref val) {
         return true;
     }
 
+    if(ti->is_python) return AttributeError(self, name);
     return TypeError("cannot set attribute");
 }
 
@@ -15725,6 +17313,17 @@ bool py_delattr(py_Ref self, py_Name name) {
     py_TypeInfo* ti = pk_typeinfo(self->type);
     if(ti->delattribute) return ti->delattribute(self, name);
 
+    py_Ref cls_var = pk_tpfindname(ti, name);
+    if(cls_var && py_istype(cls_var, tp_member_descriptor)) {
+        MemberDescriptor* md = py_touserdata(cls_var);
+        if(self->is_ptr && md->index < self->_obj->slots) {
+            py_Ref slot = PyObject__slots(self->_obj) + md->index;
+            if(py_isnil(slot)) return AttributeError(self, name);
+            py_newnil(slot);
+            return true;
+        }
+    }
+
     if(self->is_ptr && self->_obj->slots == -1) {
         if(py_deldict(self, name)) return true;
         return AttributeError(self, name);
@@ -15787,10 +17386,11 @@ py_ItemRef py_emplacedict(py_Ref self, py_Name name) {
 bool py_applydict(py_Ref self, bool (*f)(py_Name, py_Ref, void*), void* ctx) {
     assert(self && self->is_ptr);
     NameDict* dict = PyObject__dict(self->_obj);
-    for(int i = 0; i < dict->capacity; i++) {
-        NameDict_KV* kv = &dict->items[i];
-        if(kv->key == NULL) continue;
-        bool ok = f(kv->key, &kv->value, ctx);
+    int i = 0;
+    py_Name key;
+    py_TValue* value;
+    while(NameDict__next(dict, &i, &key, &value)) {
+        bool ok = f(key, value, ctx);
         if(!ok) return false;
     }
     return true;
@@ -15834,6 +17434,9 @@ void py_BaseException__stpush(py_Frame* frame,
     frame_dump->src = src;
     frame_dump->lineno = lineno;
     frame_dump->name = func_name ? c11_string__new(func_name) : NULL;
+    // the gc marks every frame dump, so they must be valid even without the debugger
+    py_newnil(&frame_dump->locals);
+    py_newnil(&frame_dump->globals);
 
     if(py_debugger_status() == 1) {
         if(frame != NULL) {
@@ -16148,7 +17751,11 @@ void py_initialize() {
     bool is_little_endian = *(char*)&x == 1;
     if(!is_little_endian) c11__abort("is_little_endian != true");
 
+#if PK_ENABLE_COMPACT_TVALUE
+    _Static_assert(sizeof(py_TValue) == 16, "sizeof(py_TValue) != 16");
+#else
     _Static_assert(sizeof(py_TValue) == 24, "sizeof(py_TValue) != 24");
+#endif
     _Static_assert(offsetof(py_TValue, extra) == 4, "offsetof(py_TValue, extra) != 4");
 
     // check sizes
@@ -16261,6 +17868,54 @@ int py_gc_collect() {
     return ManagedHeap__collect(heap);
 }
 
+size_t py_gc_shrink() {
+    ManagedHeap* heap = &pk_current_vm->heap;
+    return ManagedHeap__shrink(heap);
+}
+
+void py_gc_stats(py_GCStats* out) {
+    ManagedHeap* heap = &pk_current_vm->heap;
+    ManagedHeapStats* stats = &heap->stats;
+    out->collections = stats->collections;
+    out->auto_collections = stats->auto_collections;
+    out->small_freed = stats->small_freed;
+    out->large_freed = stats->large_freed;
+    out->mark_ns_total = stats->mark_ns_total;
+    out->mark_ns_p50 = ManagedHeapStats__percentile(stats->mark_ns_hist,
+                                                    stats->collections,
+                                                    stats->mark_ns_max,
+                                                    0.50f);
+    out->mark_ns_p99 = ManagedHeapStats__percentile(stats->mark_ns_hist,
+                                                    stats->collections,
+                                                    stats->mark_ns_max,
+                                                    0.99f);
+    out->mark_ns_max = stats->mark_ns_max;
+    out->sweep_ns_total = stats->sweep_ns_total;
+    out->sweep_ns_p50 = ManagedHeapStats__percentile(stats->sweep_ns_hist,
+                                                     stats->collections,
+                                                     stats->sweep_ns_max,
+                                                     0.50f);
+    out->sweep_ns_p99 = ManagedHeapStats__percentile(stats->sweep_ns_hist,
+                                                     stats->collections,
+                                                     stats->sweep_ns_max,
+                                                     0.99f);
+    out->sweep_ns_max = stats->sweep_ns_max;
+    out->threshold_raised = stats->threshold_raised;
+    out->threshold_lowered = stats->threshold_lowered;
+    out->gc_threshold = heap->gc_threshold;
+}
+
+int64_t py_gc_freedcount(py_Type type) {
+    ManagedHeapStats* stats = &pk_current_vm->heap.stats;
+    if(type <= 0 || type >= stats->freed_types.length) return 0;
+    return c11__getitem(int64_t, &stats->freed_types, type);
+}
+
+void py_setmemorylimit(size_t bytes) {
+    ManagedHeap* heap = &pk_current_vm->heap;
+    ManagedHeap__set_memory_limit(heap, bytes);
+}
+
 /////////////////////////////
 
 void* py_malloc(size_t size) { return PK_MALLOC(size); }
@@ -16627,6 +18282,7 @@ __SUCCESS:
         ok = py_exec(data, filename->data, EXEC_MODE, mod);
     }
     py_assign(py_retval(), mod);
+    if(ok) NameDict__freeze(PyObject__dict(mod->_obj));
 
     c11_string__delete(filename);
     c11_string__delete(slashed_path);
@@ -16828,7 +18484,8 @@ bool pk_loadmethod(py_StackRef self, py_Name name) {
     if(cls_var != NULL) {
         switch(cls_var->type) {
             case tp_function:
-            case tp_nativefunc: {
+            case tp_nativefunc:
+            case tp_lru_cache_wrapper: {
                 self[0] = *cls_var;
                 self[1] = self_bak;
                 break;
@@ -17091,14 +18748,21 @@ void* py_touserdata(py_Ref self) {
 const char* py_tostr(py_Ref self) { return pk_tostr(self)->data; }
 
 const char* py_tostrn(py_Ref self, int* size) {
-    c11_string* ud = pk_tostr(self);
-    *size = ud->size;
-    return ud->data;
+    c11_sv sv = py_tosv(self);
+    *size = sv.size;
+    return sv.data;
 }
 
 c11_sv py_tosv(py_Ref self) {
-    c11_string* ud = pk_tostr(self);
-    return c11_string__sv(ud);
+    assert(self->type == tp_str);
+    if(self->is_ptr && self->_obj->slots > 0) {
+        // substring view or rope: | hash | int offset | int size |, slot 0 is the parent
+        int* view = (int*)((uint64_t*)PyObject__userdata(self->_obj) + 1);
+        if(view[0] < 0) pk_flattenstr(self->_obj);
+        c11_string* parent = pk_tostr(PyObject__slots(self->_obj));
+        return (c11_sv){parent->data + view[0], view[1]};
+    }
+    return c11_string__sv(pk_tostr(self));
 }
 
 unsigned char* py_tobytes(py_Ref self, int* size) {
@@ -17118,12 +18782,381 @@ void py_bytes_resize(py_Ref self, int size) {
 // src/public/PyDict.c
 typedef struct {
     Dict* dict;  // weakref for slot 0
-    Dict dict_backup;
+    uint32_t state;  // `dict->state` when the iteration started
     DictEntry* curr;
     DictEntry* end;
     int mode;  // 0: keys, 1: values, 2: items
 } DictIterator;
 
+static uint64_t Dict__hash_2nd(uint64_t key) {
+    // https://gist.github.com/badboy/6267743
+    key = (~key) + (key << 21);  // key = (key << 21) - key - 1
+    key = key ^ (key >> 24);
+    key = (key + (key << 3)) + (key << 8);  // key * 265
+    key = key ^ (key >> 14);
+    key = (key + (key << 2)) + (key << 4);  // key * 21
+    key = key ^ (key >> 28);
+    key = key + (key << 31);
+    return key;
+}
+
+// Dict__hash_key won't raise exception for string keys
+static bool Dict__hash_key(py_Ref key, uint64_t* p_hash) {
+    if(py_isstr(key)) {
+        *p_hash = pk_strhash(key);
+        return true;
+    }
+    py_i64 h_user;
+    if(!py_hash(key, &h_user)) return false;
+    *p_hash = Dict__hash_2nd((uint64_t)h_user);
+    return true;
+}
+
+/// 1: same key, 0: different key, -1: error, 2: `__eq__` changed the dict, probe again
+static int Dict__match_key(Dict* self, DictEntry* entry, py_Ref key, uint64_t hash) {
+    if(entry->hash != hash) return 0;
+    if(py_isstr(&entry->key) && py_isstr(key)) {
+        if(key->is_ptr && entry->key.is_ptr && key->_obj == entry->key._obj) return 1;
+        return c11__sveq(py_tosv(&entry->key), py_tosv(key));
+    }
+    uint32_t state = self->state;
+    int res = py_equal(&entry->key, key);
+    if(res != -1 && self->state != state) return 2;
+    return res;
+}
+
+// dicts with at most this many keys have no index table and are scanned linearly
+#define kDictSmallMaxLength 8
+
+static bool Dict__is_small(Dict* self) { return self->capacity == 0; }
+
+// small dicts never keep deleted entries, so the scan only visits live keys
+/// same results as Dict__match_key(), 0 if the key is absent
+static int Dict__probe_small(Dict* self, py_Ref key, uint64_t hash, DictEntry** p_entry) {
+    *p_entry = NULL;
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        int res = Dict__match_key(self, entry, key, hash);
+        if(res == 1) *p_entry = entry;
+        if(res != 0) return res;
+    }
+    return 0;
+}
+
+static void Dict__pop_small(Dict* self, DictEntry* entry) {
+    int index = (int)(entry - (DictEntry*)self->entries.data);
+    c11_vector__erase(DictEntry, &self->entries, index);
+    self->length--;
+}
+
+#if PK_ENABLE_SWISS_DICT
+// Swiss table: `capacity` control bytes in groups of 16, followed by the entry index of each
+// slot. A control byte is empty, deleted, or the low 7 bits of the hash of a full slot, so a
+// whole group is matched with one vector compare and entries are only touched on a hit.
+#define kDictGroupWidth 16
+#define kDictMinCapacity 16
+#define kDictCtrlEmpty 0x80
+#define kDictCtrlDeleted 0xFE
+
+#if PK_SIMD_NEON
+#define kDictMaskShift 2  // one nibble per slot
+#else
+#define kDictMaskShift 0  // one bit per slot
+#endif
+
+static uint64_t DictGroup__match(const uint8_t* group, uint8_t c) {
+#if PK_SIMD_SSE2
+    __m128i g = _mm_loadu_si128((const __m128i*)group);
+    return (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+#elif PK_SIMD_NEON
+    uint8x16_t eq = vceqq_u8(vld1q_u8(group), vdupq_n_u8(c));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ull;
+#else
+    uint64_t mask = 0;
+    for(int i = 0; i < kDictGroupWidth; i++) {
+        if(group[i] == c) mask |= (uint64_t)1 << i;
+    }
+    return mask;
+#endif
+}
+
+// empty and deleted slots are the ones with the high bit set
+static uint64_t DictGroup__match_free(const uint8_t* group) {
+#if PK_SIMD_SSE2
+    return (uint64_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#elif PK_SIMD_NEON
+    uint8x16_t free = vcgeq_u8(vld1q_u8(group), vdupq_n_u8(0x80));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(free), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ull;
+#else
+    uint64_t mask = 0;
+    for(int i = 0; i < kDictGroupWidth; i++) {
+        if(group[i] & 0x80) mask |= (uint64_t)1 << i;
+    }
+    return mask;
+#endif
+}
+
+static uint32_t Dict__growth_limit(uint32_t capacity) { return capacity - capacity / 8; }
+
+static size_t Dict__ctrl_size(Dict* self) {
+    size_t index_size = self->index_is_short ? sizeof(uint16_t) : sizeof(uint32_t);
+    return (size_t)self->capacity * (1 + index_size);
+}
+
+// a zero `capacity` creates a small dict
+static void Dict__ctor(Dict* self, uint32_t capacity, int entries_capacity) {
+    assert(capacity % kDictGroupWidth == 0 && (capacity & (capacity - 1)) == 0);
+    self->length = 0;
+    self->state = 0;
+    self->capacity = capacity;
+    self->growth_left = Dict__growth_limit(capacity);
+    // deleted entries stay in `entries` until compaction, which keeps it below 2x capacity
+    self->index_is_short = capacity <= 16384;
+    self->ctrl = NULL;
+    if(capacity > 0) {
+        self->ctrl = PK_MALLOC(Dict__ctrl_size(self));
+        memset(self->ctrl, kDictCtrlEmpty, capacity);
+    }
+
+    c11_vector__ctor(&self->entries, sizeof(DictEntry));
+    c11_vector__reserve(&self->entries, entries_capacity);
+}
+
+size_t Dict__buffer_size(Dict* self) {
+    return Dict__ctrl_size(self) + (size_t)self->entries.capacity * sizeof(DictEntry);
+}
+
+static void Dict__dtor(Dict* self) {
+    self->length = 0;
+    self->capacity = 0;
+    PK_FREE(self->ctrl);
+    c11_vector__dtor(&self->entries);
+}
+
+static uint32_t Dict__get_index(Dict* self, uint32_t slot) {
+    void* indices = self->ctrl + self->capacity;
+    if(self->index_is_short) return ((uint16_t*)indices)[slot];
+    return ((uint32_t*)indices)[slot];
+}
+
+static void Dict__set_index(Dict* self, uint32_t slot, uint32_t index) {
+    void* indices = self->ctrl + self->capacity;
+    if(self->index_is_short) {
+        ((uint16_t*)indices)[slot] = (uint16_t)index;
+    } else {
+        ((uint32_t*)indices)[slot] = index;
+    }
+}
+
+static void Dict__set_slot(Dict* self, uint32_t slot, uint64_t hash, uint32_t index) {
+    if(self->ctrl[slot] == kDictCtrlEmpty) self->growth_left--;
+    self->ctrl[slot] = hash & 0x7F;
+    Dict__set_index(self, slot, index);
+}
+
+// groups are visited in triangular order, which covers all of them for a power of two count
+static uint32_t Dict__find_free(Dict* self, uint64_t hash) {
+    uint32_t group_mask = self->capacity / kDictGroupWidth - 1;
+    uint32_t g = (uint32_t)(hash >> 7) & group_mask;
+    for(uint32_t step = 1;; step++) {
+        uint64_t mask = DictGroup__match_free(self->ctrl + g * kDictGroupWidth);
+        if(mask) return g * kDictGroupWidth + (c11__ctz64(mask) >> kDictMaskShift);
+        g = (g + step) & group_mask;
+    }
+}
+
+// if the key is absent, `*p_idx` is the first free slot on its probe sequence
+static bool Dict__probe(Dict* self,
+                        py_TValue* key,
+                        uint64_t hash,
+                        uint32_t* p_idx,
+                        DictEntry** p_entry) {
+    *p_idx = 0;
+__RESTART:
+    if(Dict__is_small(self)) {
+        int res = Dict__probe_small(self, key, hash, p_entry);
+        if(res == 2) goto __RESTART;
+        return res != -1;
+    }
+    uint32_t group_mask = self->capacity / kDictGroupWidth - 1;
+    uint32_t g = (uint32_t)(hash >> 7) & group_mask;
+    uint32_t free_slot = UINT32_MAX;
+    for(uint32_t step = 1;; step++) {
+        const uint8_t* group = self->ctrl + g * kDictGroupWidth;
+        uint64_t mask = DictGroup__match(group, hash & 0x7F);
+        while(mask) {
+            uint32_t slot = g * kDictGroupWidth + (c11__ctz64(mask) >> kDictMaskShift);
+            DictEntry* entry = c11__at(DictEntry, &self->entries, Dict__get_index(self, slot));
+            int res = Dict__match_key(self, entry, key, hash);
+            if(res == 1) {
+                *p_idx = slot;
+                *p_entry = entry;
+                return true;
+            }
+            if(res == -1) return false;  // error
+            if(res == 2) goto __RESTART;  // the table may have been rebuilt or freed
+            mask &= mask - 1;
+        }
+        if(free_slot == UINT32_MAX) {
+            uint64_t free_mask = DictGroup__match_free(group);
+            if(free_mask) free_slot = g * kDictGroupWidth + (c11__ctz64(free_mask) >> kDictMaskShift);
+        }
+        // a key is never placed beyond a group that still has an empty slot
+        if(DictGroup__match(group, kDictCtrlEmpty)) break;
+        g = (g + step) & group_mask;
+    }
+    // not found
+    *p_idx = free_slot;
+    *p_entry = NULL;
+    return true;
+}
+
+static void Dict__rehash(Dict* self, uint32_t new_capacity) {
+    Dict old_dict = *self;
+    // create a new dict with new capacity
+    bool shrink = new_capacity < old_dict.capacity;
+    Dict__ctor(self, new_capacity, shrink ? old_dict.length : old_dict.entries.capacity);
+    self->state = old_dict.state + 1;
+    // move entries from old dict to new dict
+    for(int i = 0; i < old_dict.entries.length; i++) {
+        DictEntry* old_entry = c11__at(DictEntry, &old_dict.entries, i);
+        if(py_isnil(&old_entry->key)) continue;  // skip deleted
+        if(!Dict__is_small(self)) {
+            uint32_t slot = Dict__find_free(self, old_entry->hash);
+            Dict__set_slot(self, slot, old_entry->hash, self->entries.length);
+        }
+        c11_vector__push(DictEntry, &self->entries, *old_entry);
+        self->length++;
+    }
+    Dict__dtor(&old_dict);
+}
+
+static void Dict__compact_entries(Dict* self) {
+    uint32_t* mappings = PK_MALLOC(self->entries.length * sizeof(uint32_t));
+
+    int n = 0;
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        mappings[i] = n;
+        if(i != n) {
+            DictEntry* new_entry = c11__at(DictEntry, &self->entries, n);
+            *new_entry = *entry;
+        }
+        n++;
+    }
+    self->entries.length = n;
+    // update indices of full slots
+    for(uint32_t slot = 0; slot < self->capacity; slot++) {
+        if(self->ctrl[slot] & 0x80) continue;
+        Dict__set_index(self, slot, mappings[Dict__get_index(self, slot)]);
+    }
+    PK_FREE(mappings);
+}
+
+// drop deleted entries, and rebuild a smaller table if it is mostly unused
+static void Dict__compact(Dict* self) {
+    if(self->length <= kDictSmallMaxLength / 2) {
+        Dict__rehash(self, 0);
+        return;
+    }
+    uint32_t new_capacity = kDictMinCapacity;
+    while(Dict__growth_limit(new_capacity) < (uint32_t)self->length * 4) {
+        new_capacity *= 2;
+    }
+    if(new_capacity < self->capacity) {
+        Dict__rehash(self, new_capacity);
+    } else {
+        Dict__compact_entries(self);
+    }
+}
+
+// find the entry of `key`, inserting it with `val` if absent
+static bool Dict__emplace(Dict* self,
+                          py_TValue* key,
+                          uint64_t hash,
+                          py_TValue* val,
+                          DictEntry** p_entry) {
+    uint32_t idx;
+    if(!Dict__probe(self, key, hash, &idx, p_entry)) return false;
+    if(*p_entry) return true;
+    // insert new entry
+    size_t buffer_size = Dict__buffer_size(self);
+    if(Dict__is_small(self)) {
+        if(self->length == kDictSmallMaxLength) {
+            Dict__rehash(self, kDictMinCapacity);
+            idx = Dict__find_free(self, hash);
+        }
+    } else if(self->ctrl[idx] == kDictCtrlEmpty && self->growth_left == 0) {
+        // purge deleted slots in place if at most half of the limit is in use, otherwise grow
+        uint32_t new_capacity = self->capacity;
+        if((uint32_t)self->length * 2 >= Dict__growth_limit(new_capacity)) new_capacity *= 2;
+        Dict__rehash(self, new_capacity);
+        idx = Dict__find_free(self, hash);
+    }
+    if(!Dict__is_small(self)) Dict__set_slot(self, idx, hash, self->entries.length);
+    DictEntry* new_entry = c11_vector__emplace(&self->entries);
+    new_entry->hash = hash;
+    new_entry->key = *key;
+    new_entry->val = *val;
+    self->length++;
+    self->state++;
+    size_t new_buffer_size = Dict__buffer_size(self);
+    if(new_buffer_size > buffer_size) {
+        ManagedHeap__account_buffer(&pk_current_vm->heap, new_buffer_size - buffer_size);
+    }
+    *p_entry = new_entry;
+    return true;
+}
+
+/// Delete an entry from the dict.
+/// -1: error, 0: not found, 1: found and deleted
+static int Dict__remove(Dict* self, py_Ref key, uint64_t hash) {
+    uint32_t idx;
+    DictEntry* entry;
+    if(!Dict__probe(self, key, hash, &idx, &entry)) return -1;
+    if(!entry) return 0;  // not found
+
+    // found the entry, delete and return it
+    py_assign(py_retval(), &entry->val);
+    self->state++;
+    if(Dict__is_small(self)) {
+        Dict__pop_small(self, entry);
+        return 1;
+    }
+    // no probe sequence went past a group with an empty slot, so it can stay empty
+    const uint8_t* group = self->ctrl + (idx & ~(uint32_t)(kDictGroupWidth - 1));
+    if(DictGroup__match(group, kDictCtrlEmpty)) {
+        self->ctrl[idx] = kDictCtrlEmpty;
+        self->growth_left++;
+    } else {
+        self->ctrl[idx] = kDictCtrlDeleted;
+    }
+    py_newnil(&entry->key);
+    py_newnil(&entry->val);
+    self->length--;
+    // compact entries if necessary
+    if(self->length <= kDictSmallMaxLength / 2 ||
+       (self->entries.length > 16 && (self->length < self->entries.length >> 1))) {
+        Dict__compact(self);
+    }
+    return 1;
+}
+
+static void Dict__copy(Dict* self, Dict* other) {
+    *self = *other;
+    self->entries = c11_vector__copy(&other->entries);
+    if(Dict__is_small(other)) return;
+    size_t ctrl_size = Dict__ctrl_size(other);
+    self->ctrl = PK_MALLOC(ctrl_size);
+    memcpy(self->ctrl, other->ctrl, ctrl_size);
+}
+
+#else
+#define kDictMinCapacity 37
+
 #define Dict__step(x) ((x) < mask ? (x) + 1 : 0)
 
 static uint32_t Dict__next_cap(uint32_t cap) {
@@ -17172,20 +19205,10 @@ static uint32_t Dict__next_cap(uint32_t cap) {
     }
 }
 
-static uint64_t Dict__hash_2nd(uint64_t key) {
-    // https://gist.github.com/badboy/6267743
-    key = (~key) + (key << 21);  // key = (key << 21) - key - 1
-    key = key ^ (key >> 24);
-    key = (key + (key << 3)) + (key << 8);  // key * 265
-    key = key ^ (key >> 14);
-    key = (key + (key << 2)) + (key << 4);  // key * 21
-    key = key ^ (key >> 28);
-    key = key + (key << 31);
-    return key;
-}
-
+// a zero `capacity` creates a small dict
 static void Dict__ctor(Dict* self, uint32_t capacity, int entries_capacity) {
     self->length = 0;
+    self->state = 0;
     self->capacity = capacity;
 
     size_t indices_size;
@@ -17199,13 +19222,21 @@ static void Dict__ctor(Dict* self, uint32_t capacity, int entries_capacity) {
         self->null_index_value = UINT32_MAX;
     }
 
-    self->indices = PK_MALLOC(indices_size);
-    memset(self->indices, -1, indices_size);
+    self->indices = NULL;
+    if(capacity > 0) {
+        self->indices = PK_MALLOC(indices_size);
+        memset(self->indices, -1, indices_size);
+    }
 
     c11_vector__ctor(&self->entries, sizeof(DictEntry));
     c11_vector__reserve(&self->entries, entries_capacity);
 }
 
+size_t Dict__buffer_size(Dict* self) {
+    size_t index_size = self->index_is_short ? sizeof(uint16_t) : sizeof(uint32_t);
+    return (size_t)self->capacity * index_size + (size_t)self->entries.capacity * sizeof(DictEntry);
+}
+
 static void Dict__dtor(Dict* self) {
     self->length = 0;
     self->capacity = 0;
@@ -17247,44 +19278,32 @@ static void Dict__set_index(Dict* self, uint32_t index, uint32_t value) {
     }
 }
 
-// Dict__probe won't raise exception for string keys
 static bool Dict__probe(Dict* self,
                         py_TValue* key,
-                        uint64_t* p_hash,
+                        uint64_t hash,
                         uint32_t* p_idx,
                         DictEntry** p_entry) {
-    if(py_isstr(key)) {
-        *p_hash = c11_sv__hash(py_tosv(key));
-    } else {
-        py_i64 h_user;
-        if(!py_hash(key, &h_user)) return false;
-        *p_hash = Dict__hash_2nd((uint64_t)h_user);
+    *p_idx = 0;
+__RESTART:
+    if(Dict__is_small(self)) {
+        int res = Dict__probe_small(self, key, hash, p_entry);
+        if(res == 2) goto __RESTART;
+        return res != -1;
     }
     uint32_t mask = self->capacity - 1;
-    uint32_t idx = (*p_hash) % self->capacity;
+    uint32_t idx = hash % self->capacity;
     while(true) {
         uint32_t idx2 = Dict__get_index(self, idx);
         if(idx2 == self->null_index_value) break;
         DictEntry* entry = c11__at(DictEntry, &self->entries, idx2);
-        if(entry->hash == (*p_hash)) {
-            if(py_isstr(&entry->key) && py_isstr(key)) {
-                c11_sv lhs = py_tosv(&entry->key);
-                c11_sv rhs = py_tosv(key);
-                if(c11__sveq(lhs, rhs)) {
-                    *p_idx = idx;
-                    *p_entry = entry;
-                    return true;
-                }
-            } else {
-                int res = py_equal(&entry->key, key);
-                if(res == 1) {
-                    *p_idx = idx;
-                    *p_entry = entry;
-                    return true;
-                }
-                if(res == -1) return false;  // error
-            }
+        int res = Dict__match_key(self, entry, key, hash);
+        if(res == 1) {
+            *p_idx = idx;
+            *p_entry = entry;
+            return true;
         }
+        if(res == -1) return false;  // error
+        if(res == 2) goto __RESTART;  // the table may have been rebuilt or freed
         // try next index
         idx = Dict__step(idx);
     }
@@ -17294,46 +19313,37 @@ static bool Dict__probe(Dict* self,
     return true;
 }
 
-static bool Dict__try_get(Dict* self, py_TValue* key, DictEntry** out) {
-    uint64_t hash;
-    uint32_t idx;
-    return Dict__probe(self, key, &hash, &idx, out);
-}
-
-static void Dict__clear(Dict* self) {
-    size_t indices_size = self->index_is_short ? self->capacity * sizeof(uint16_t)
-                                               : self->capacity * sizeof(uint32_t);
-    memset(self->indices, -1, indices_size);
-    c11_vector__clear(&self->entries);
-    self->length = 0;
+static uint32_t Dict__find_free(Dict* self, uint64_t hash) {
+    uint32_t mask = self->capacity - 1;
+    uint32_t idx = hash % self->capacity;
+    while(Dict__get_index(self, idx) != self->null_index_value) {
+        idx = Dict__step(idx);
+    }
+    return idx;
 }
 
-static void Dict__rehash_2x(Dict* self) {
+static void Dict__rehash(Dict* self, uint32_t new_capacity) {
     Dict old_dict = *self;
-    uint32_t new_capacity = Dict__next_cap(old_dict.capacity);
-    uint32_t mask = new_capacity - 1;
     // create a new dict with new capacity
-    Dict__ctor(self, new_capacity, old_dict.entries.capacity);
+    bool shrink = new_capacity < old_dict.capacity;
+    Dict__ctor(self, new_capacity, shrink ? old_dict.length : old_dict.entries.capacity);
+    self->state = old_dict.state + 1;
     // move entries from old dict to new dict
     for(int i = 0; i < old_dict.entries.length; i++) {
         DictEntry* old_entry = c11__at(DictEntry, &old_dict.entries, i);
         if(py_isnil(&old_entry->key)) continue;  // skip deleted
-        uint32_t idx = old_entry->hash % new_capacity;
-        while(true) {
-            uint32_t idx2 = Dict__get_index(self, idx);
-            if(idx2 == self->null_index_value) {
-                c11_vector__push(DictEntry, &self->entries, *old_entry);
-                Dict__set_index(self, idx, self->entries.length - 1);
-                self->length++;
-                break;
-            }
-            // try next index
-            idx = Dict__step(idx);
+        if(!Dict__is_small(self)) {
+            uint32_t idx = Dict__find_free(self, old_entry->hash);
+            Dict__set_index(self, idx, self->entries.length);
         }
+        c11_vector__push(DictEntry, &self->entries, *old_entry);
+        self->length++;
     }
     Dict__dtor(&old_dict);
 }
 
+static void Dict__rehash_2x(Dict* self) { Dict__rehash(self, Dict__next_cap(self->capacity)); }
+
 static void Dict__compact_entries(Dict* self) {
     uint32_t* mappings = PK_MALLOC(self->entries.length * sizeof(uint32_t));
 
@@ -17358,41 +19368,58 @@ static void Dict__compact_entries(Dict* self) {
     PK_FREE(mappings);
 }
 
-static bool Dict__set(Dict* self, py_TValue* key, py_TValue* val) {
-    uint64_t hash;
+// find the entry of `key`, inserting it with `val` if absent
+static bool Dict__emplace(Dict* self,
+                          py_TValue* key,
+                          uint64_t hash,
+                          py_TValue* val,
+                          DictEntry** p_entry) {
     uint32_t idx;
-    DictEntry* entry;
-    if(!Dict__probe(self, key, &hash, &idx, &entry)) return false;
-    if(entry) {
-        // update existing entry
-        entry->val = *val;
-        return true;
-    }
+    if(!Dict__probe(self, key, hash, &idx, p_entry)) return false;
+    if(*p_entry) return true;
     // insert new entry
+    size_t buffer_size = Dict__buffer_size(self);
+    if(Dict__is_small(self) && self->length == kDictSmallMaxLength) {
+        Dict__rehash(self, kDictMinCapacity);
+        idx = Dict__find_free(self, hash);
+    }
     DictEntry* new_entry = c11_vector__emplace(&self->entries);
     new_entry->hash = hash;
     new_entry->key = *key;
     new_entry->val = *val;
-    Dict__set_index(self, idx, self->entries.length - 1);
     self->length++;
-    // check if we need to rehash
-    float load_factor = (float)self->length / self->capacity;
-    if(load_factor > (self->index_is_short ? 0.3f : 0.4f)) Dict__rehash_2x(self);
+    self->state++;
+    if(!Dict__is_small(self)) {
+        Dict__set_index(self, idx, self->entries.length - 1);
+        // check if we need to rehash
+        float load_factor = (float)self->length / self->capacity;
+        if(load_factor > (self->index_is_short ? 0.3f : 0.4f)) Dict__rehash_2x(self);
+    }
+    size_t new_buffer_size = Dict__buffer_size(self);
+    if(new_buffer_size > buffer_size) {
+        ManagedHeap__account_buffer(&pk_current_vm->heap, new_buffer_size - buffer_size);
+    }
+    // rehashing may have moved the entries
+    *p_entry = &c11_vector__back(DictEntry, &self->entries);
     return true;
 }
 
 /// Delete an entry from the dict.
 /// -1: error, 0: not found, 1: found and deleted
-static int Dict__pop(Dict* self, py_Ref key) {
+static int Dict__remove(Dict* self, py_Ref key, uint64_t hash) {
     // Dict__log_index(self, "before pop");
-    uint64_t hash;
     uint32_t idx;
     DictEntry* entry;
-    if(!Dict__probe(self, key, &hash, &idx, &entry)) return -1;
+    if(!Dict__probe(self, key, hash, &idx, &entry)) return -1;
     if(!entry) return 0;  // not found
 
     // found the entry, delete and return it
     py_assign(py_retval(), &entry->val);
+    self->state++;
+    if(Dict__is_small(self)) {
+        Dict__pop_small(self, entry);
+        return 1;
+    }
     Dict__set_index(self, idx, self->null_index_value);
     py_newnil(&entry->key);
     py_newnil(&entry->val);
@@ -17429,18 +19456,75 @@ static int Dict__pop(Dict* self, py_Ref key) {
         // probe_count++;
     }
     // printf("Dict__pop: probe_count=%d, swap_count=%d\n", probe_count, swap_count);
-    // compact entries if necessary
-    if(self->entries.length > 16 && (self->length < self->entries.length >> 1)) {
+    if(self->length <= kDictSmallMaxLength / 2) {
+        Dict__rehash(self, 0);  // back to a small dict
+    } else if(self->entries.length > 16 && (self->length < self->entries.length >> 1)) {
         Dict__compact_entries(self);  // compact entries
     }
     // Dict__log_index(self, "after pop");
     return 1;
 }
 
+static void Dict__copy(Dict* self, Dict* other) {
+    self->length = other->length;
+    self->state = other->state;
+    self->capacity = other->capacity;
+    self->null_index_value = other->null_index_value;
+    self->index_is_short = other->index_is_short;
+    // copy entries
+    self->entries = c11_vector__copy(&other->entries);
+    self->indices = NULL;
+    if(Dict__is_small(other)) return;
+    // copy indices
+    size_t indices_size = other->index_is_short ? other->capacity * sizeof(uint16_t)
+                                                : other->capacity * sizeof(uint32_t);
+    self->indices = PK_MALLOC(indices_size);
+    memcpy(self->indices, other->indices, indices_size);
+}
+#endif
+
+static void Dict__clear(Dict* self) {
+    uint32_t state = self->state;
+    Dict__dtor(self);
+    Dict__ctor(self, 0, 4);
+    self->state = state + 1;
+}
+
+static bool Dict__insert(Dict* self, py_TValue* key, uint64_t hash, py_TValue* val) {
+    DictEntry* entry;
+    if(!Dict__emplace(self, key, hash, val, &entry)) return false;
+    entry->val = *val;
+    return true;
+}
+
+static bool Dict__set(Dict* self, py_TValue* key, py_TValue* val) {
+    uint64_t hash;
+    if(!Dict__hash_key(key, &hash)) return false;
+    return Dict__insert(self, key, hash, val);
+}
+
+/// -1: error, 0: not found, 1: found and deleted
+static int Dict__pop(Dict* self, py_Ref key) {
+    uint64_t hash;
+    if(!Dict__hash_key(key, &hash)) return -1;
+    return Dict__remove(self, key, hash);
+}
+
+static bool Dict__try_get_hashed(Dict* self, py_TValue* key, uint64_t hash, DictEntry** out) {
+    uint32_t idx;
+    return Dict__probe(self, key, hash, &idx, out);
+}
+
+static bool Dict__try_get(Dict* self, py_TValue* key, DictEntry** out) {
+    uint64_t hash;
+    if(!Dict__hash_key(key, &hash)) return false;
+    return Dict__try_get_hashed(self, key, hash, out);
+}
+
 static void DictIterator__ctor(DictIterator* self, Dict* dict, int mode) {
     assert(mode >= 0 && mode <= 2);
     self->dict = dict;
-    self->dict_backup = *dict;  // backup the dict
+    self->state = dict->state;
     self->curr = dict->entries.data;
     self->end = self->curr + dict->entries.length;
     self->mode = mode;
@@ -17456,7 +19540,7 @@ static DictEntry* DictIterator__next(DictIterator* self) {
 }
 
 static bool DictIterator__modified(DictIterator* self) {
-    return memcmp(self->dict, &self->dict_backup, sizeof(Dict)) != 0;
+    return self->dict->state != self->state;
 }
 
 ///////////////////////////////
@@ -17464,13 +19548,13 @@ static bool dict__new__(int argc, py_Ref argv) {
     py_Type cls = py_totype(argv);
     int slots = cls == tp_dict ? 0 : -1;
     Dict* ud = py_newobject(py_retval(), cls, slots, sizeof(Dict));
-    Dict__ctor(ud, 17, 4);
+    Dict__ctor(ud, 0, 4);
     return true;
 }
 
 void py_newdict(py_OutRef out) {
     Dict* ud = py_newobject(out, tp_dict, 0, sizeof(Dict));
-    Dict__ctor(ud, 17, 4);
+    Dict__ctor(ud, 0, 4);
 }
 
 static bool dict__init__(int argc, py_Ref argv) {
@@ -17498,15 +19582,25 @@ static bool dict__init__(int argc, py_Ref argv) {
     return true;
 }
 
+static bool defaultdict__insert_default(py_Ref self, py_Ref key, uint64_t hash);
+
 static bool dict__getitem__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
     Dict* self = py_touserdata(argv);
+    uint64_t hash;
+    if(!Dict__hash_key(py_arg(1), &hash)) return false;
     DictEntry* entry;
-    if(!Dict__try_get(self, py_arg(1), &entry)) return false;
+    if(!Dict__try_get_hashed(self, py_arg(1), hash, &entry)) return false;
     if(entry) {
         *py_retval() = entry->val;
         return true;
     }
+    // Counter and defaultdict handle missing keys without dispatching `__missing__`
+    if(argv->type == tp_Counter) {
+        py_newint(py_retval(), 0);
+        return true;
+    }
+    if(argv->type == tp_defaultdict) return defaultdict__insert_default(argv, py_arg(1), hash);
     // try __missing__
     py_Ref missing = py_tpfindmagic(argv->type, __missing__);
     if(missing) return py_call(missing, argc, argv);
@@ -17575,7 +19669,7 @@ static bool dict__repr__(int argc, py_Ref argv) {
 static bool dict__eq__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
     Dict* self = py_touserdata(py_arg(0));
-    if(!py_isdict(py_arg(1))) {
+    if(!py_isinstance(py_arg(1), tp_dict)) {
         py_newnotimplemented(py_retval());
         return true;
     }
@@ -17606,6 +19700,9 @@ static bool dict__eq__(int argc, py_Ref argv) {
             return true;
         }
         if(res == -1) return false;  // error
+        if(DictIterator__modified(&iter)) {
+            return RuntimeError("dictionary modified during iteration");
+        }
     }
     py_newbool(py_retval(), true);
     return true;
@@ -17632,23 +19729,13 @@ static bool dict_copy(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
     Dict* self = py_touserdata(argv);
     Dict* new_dict = py_newobject(py_retval(), tp_dict, 0, sizeof(Dict));
-    new_dict->length = self->length;
-    new_dict->capacity = self->capacity;
-    new_dict->null_index_value = self->null_index_value;
-    new_dict->index_is_short = self->index_is_short;
-    // copy entries
-    new_dict->entries = c11_vector__copy(&self->entries);
-    // copy indices
-    size_t indices_size = self->index_is_short ? self->capacity * sizeof(uint16_t)
-                                               : self->capacity * sizeof(uint32_t);
-    new_dict->indices = PK_MALLOC(indices_size);
-    memcpy(new_dict->indices, self->indices, indices_size);
+    Dict__copy(new_dict, self);
     return true;
 }
 
 static bool dict_update(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    PY_CHECK_ARG_TYPE(1, tp_dict);
+    if(!py_checkinstance(py_arg(1), tp_dict)) return false;
     Dict* self = py_touserdata(argv);
     Dict* other = py_touserdata(py_arg(1));
     for(int i = 0; i < other->entries.length; i++) {
@@ -17758,7 +19845,14 @@ py_Type pk_dict__register() {
 bool dict_items__next__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
     DictIterator* iter = py_touserdata(py_arg(0));
-    if(DictIterator__modified(iter)) return RuntimeError("dictionary modified during iteration");
+    if(DictIterator__modified(iter)) {
+        // sets iterate with `dict_keys` too, see `pk_set__register()`
+        py_Type type = py_getslot(argv, 0)->type;
+        if(type != tp_dict && !py_issubclass(type, tp_dict)) {
+            return RuntimeError("Set changed size during iteration");
+        }
+        return RuntimeError("dictionary modified during iteration");
+    }
     DictEntry* entry = (DictIterator__next(iter));
     if(entry) {
         switch(iter->mode) {
@@ -17880,107 +19974,335 @@ bool py_dict_apply(py_Ref self, bool (*f)(py_Ref, py_Ref, void*), void* ctx) {
     return true;
 }
 
-#undef Dict__step
-// src/public/PyTuple.c
-py_ObjectRef py_newtuple(py_OutRef out, int n) {
-    VM* vm = pk_current_vm;
-    PyObject* obj = ManagedHeap__gcnew(&vm->heap, tp_tuple, n, 0);
-    out->type = tp_tuple;
-    out->is_ptr = true;
-    out->_obj = obj;
-    return PyObject__slots(obj);
+//////////////////////////
+// set and frozenset are a Dict whose values are all None, so bulk operations
+// can move entries between tables with their stored hashes instead of rehashing keys
+
+static bool Set__check(py_Type type) {
+    if(type == tp_set || type == tp_frozenset) return true;
+    return py_issubclass(type, tp_set) || py_issubclass(type, tp_frozenset);
 }
 
-py_Ref py_tuple_getitem(py_Ref self, int i) { return py_getslot(self, i); }
+// results of set algebra are plain sets or frozensets, following the left operand
+static py_Type Set__result_type(py_Ref self) {
+    return py_issubclass(self->type, tp_frozenset) ? tp_frozenset : tp_set;
+}
 
-py_Ref py_tuple_data(py_Ref self) { return PyObject__slots(self->_obj); }
+static Dict* Set__new(py_OutRef out, py_Type type) {
+    int slots = (type == tp_set || type == tp_frozenset) ? 0 : -1;
+    Dict* ud = py_newobject(out, type, slots, sizeof(Dict));
+    Dict__ctor(ud, 0, 4);
+    return ud;
+}
 
-void py_tuple_setitem(py_Ref self, int i, py_Ref val) { py_setslot(self, i, val); }
+static Dict* Set__copy(py_OutRef out, py_Type type, Dict* other) {
+    Dict* ud = py_newobject(out, type, 0, sizeof(Dict));
+    Dict__copy(ud, other);
+    return ud;
+}
 
-int py_tuple_len(py_Ref self) { return self->_obj->slots; }
+// take over the table of `other`, leaving it empty
+static void Set__assign(Dict* self, Dict* other) {
+    uint32_t state = self->state;
+    Dict__dtor(self);
+    *self = *other;
+    self->state = state + 1;
+    Dict__ctor(other, 0, 4);
+}
 
-//////////////
-static bool tuple__len__(int argc, py_Ref argv) {
-    py_newint(py_retval(), py_tuple_len(argv));
-    return true;
+static bool Set__insert_entry(Dict* self, DictEntry* entry) {
+    return Dict__insert(self, &entry->key, entry->hash, py_None());
 }
 
-static bool tuple__repr__(int argc, py_Ref argv) {
-    c11_sbuf buf;
-    c11_sbuf__ctor(&buf);
-    c11_sbuf__write_char(&buf, '(');
-    int length = py_tuple_len(argv);
-    for(int i = 0; i < length; i++) {
-        py_TValue* val = py_getslot(argv, i);
-        bool ok = py_repr(val);
-        if(!ok) {
-            c11_sbuf__dtor(&buf);
+static bool Set__update(Dict* self, py_Ref iterable) {
+    if(Set__check(iterable->type) || py_isdict(iterable)) {
+        Dict* other = py_touserdata(iterable);
+        for(int i = 0; i < other->entries.length; i++) {
+            DictEntry* entry = c11__at(DictEntry, &other->entries, i);
+            if(py_isnil(&entry->key)) continue;
+            if(!Set__insert_entry(self, entry)) return false;
+        }
+        return true;
+    }
+    // py_hash() and py_equal() overwrite py_retval(), so keys are read from the stack
+    py_Ref item = py_pushtmp();
+    py_TValue* p;
+    int length = pk_arrayview(iterable, &p);
+    if(length != -1) {
+        for(int i = 0; i < length; i++) {
+            *item = p[i];
+            if(!Dict__set(self, item, py_None())) {
+                py_pop();
+                return false;
+            }
+        }
+        py_pop();
+        return true;
+    }
+    if(!py_iter(iterable)) {
+        py_pop();
+        return false;
+    }
+    py_Ref iter = py_pushtmp();
+    *iter = *py_retval();
+    while(true) {
+        int res = py_next(iter);
+        if(res == -1) {
+            py_shrink(2);
+            return false;
+        }
+        if(!res) break;
+        *item = *py_retval();
+        if(!Dict__set(self, item, py_None())) {
+            py_shrink(2);
             return false;
         }
-        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
-        if(i != length - 1) c11_sbuf__write_cstr(&buf, ", ");
     }
-    if(length == 1) c11_sbuf__write_char(&buf, ',');
-    c11_sbuf__write_char(&buf, ')');
-    c11_sbuf__py_submit(&buf, py_retval());
+    py_shrink(2);
     return true;
 }
 
-static bool tuple__new__(int argc, py_Ref argv) {
-    if(argc == 1 + 0) {
-        py_newtuple(py_retval(), 0);
-        return true;
+// the table of a set or frozenset, or of a temporary set built from `other` into `tmp`
+static Dict* Set__view(py_Ref other, py_OutRef tmp) {
+    if(Set__check(other->type)) return py_touserdata(other);
+    Dict* ud = Set__new(tmp, tp_set);
+    if(!Set__update(ud, other)) return NULL;
+    return ud;
+}
+
+static bool Set__contains_all(Dict* self, Dict* other, bool* out) {
+    *out = false;
+    if(self->length > other->length) return true;
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        DictEntry* found;
+        if(!Dict__try_get_hashed(other, &entry->key, entry->hash, &found)) return false;
+        if(!found) return true;
     }
-    if(argc == 1 + 1) {
-        bool ok = py_tpcall(tp_list, 1, py_arg(1));
-        if(!ok) return false;
-        py_Ref tmp = py_pushtmp();
-        *tmp = *py_retval();  // backup the list
-        int length = py_list_len(tmp);
-        py_Ref p = py_newtuple(py_retval(), length);
-        for(int i = 0; i < py_tuple_len(py_retval()); i++) {
-            p[i] = *py_list_getitem(tmp, i);
+    *out = true;
+    return true;
+}
+
+static bool Set__isdisjoint(Dict* a, Dict* b, bool* out) {
+    if(a->length > b->length) {
+        Dict* t = a;
+        a = b;
+        b = t;
+    }
+    *out = false;
+    for(int i = 0; i < a->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &a->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        DictEntry* found;
+        if(!Dict__try_get_hashed(b, &entry->key, entry->hash, &found)) return false;
+        if(found) return true;
+    }
+    *out = true;
+    return true;
+}
+
+// `out` must not be py_retval(), which the key comparisons may overwrite
+static bool Set__union(py_OutRef out, py_Type type, Dict* a, Dict* b) {
+    // copy the larger table and insert the smaller one
+    if(a->length < b->length) {
+        Dict* t = a;
+        a = b;
+        b = t;
+    }
+    Dict* res = Set__copy(out, type, a);
+    for(int i = 0; i < b->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &b->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        if(!Set__insert_entry(res, entry)) return false;
+    }
+    return true;
+}
+
+static bool Set__intersection(py_OutRef out, py_Type type, Dict* a, Dict* b) {
+    // walk the smaller table and probe the larger one
+    if(a->length > b->length) {
+        Dict* t = a;
+        a = b;
+        b = t;
+    }
+    Dict* res = Set__new(out, type);
+    for(int i = 0; i < a->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &a->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        DictEntry* found;
+        if(!Dict__try_get_hashed(b, &entry->key, entry->hash, &found)) return false;
+        if(found && !Set__insert_entry(res, entry)) return false;
+    }
+    return true;
+}
+
+static bool Set__difference(py_OutRef out, py_Type type, Dict* a, Dict* b) {
+    if(b->length < a->length) {
+        // copy `a` and remove the few keys of `b`
+        Dict* res = Set__copy(out, type, a);
+        for(int i = 0; i < b->entries.length; i++) {
+            DictEntry* entry = c11__at(DictEntry, &b->entries, i);
+            if(py_isnil(&entry->key)) continue;
+            if(Dict__remove(res, &entry->key, entry->hash) == -1) return false;
         }
-        py_pop();
         return true;
     }
-    return TypeError("tuple() takes at most 1 argument");
+    Dict* res = Set__new(out, type);
+    for(int i = 0; i < a->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &a->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        DictEntry* found;
+        if(!Dict__try_get_hashed(b, &entry->key, entry->hash, &found)) return false;
+        if(!found && !Set__insert_entry(res, entry)) return false;
+    }
+    return true;
 }
 
-static bool tuple__getitem__(int argc, py_Ref argv) {
+// toggle each key of `other` in `self`
+static bool Set__toggle(Dict* self, Dict* other) {
+    for(int i = 0; i < other->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &other->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        int res = Dict__remove(self, &entry->key, entry->hash);
+        if(res == -1) return false;
+        if(res == 0 && !Set__insert_entry(self, entry)) return false;
+    }
+    return true;
+}
+
+static bool Set__symmetric_difference(py_OutRef out, py_Type type, Dict* a, Dict* b) {
+    if(a->length < b->length) {
+        Dict* t = a;
+        a = b;
+        b = t;
+    }
+    Dict* res = Set__copy(out, type, a);
+    return Set__toggle(res, b);
+}
+
+typedef bool (*SetBinaryOp)(py_OutRef out, py_Type type, Dict* a, Dict* b);
+
+// shared body of `union`, `intersection`, `difference` and `symmetric_difference`
+static bool Set__apply_method(SetBinaryOp op, int argc, py_Ref argv) {
+    py_Type type = Set__result_type(argv);
+    py_Ref res = py_pushtmp();
+    py_Ref tmp = py_pushtmp();
+    py_Ref view = py_pushtmp();
+    Set__copy(res, type, py_touserdata(argv));
+    for(int i = 1; i < argc; i++) {
+        Dict* other = Set__view(py_arg(i), view);
+        if(!other || !op(tmp, type, py_touserdata(res), other)) {
+            py_shrink(3);
+            return false;
+        }
+        *res = *tmp;
+    }
+    py_assign(py_retval(), res);
+    py_shrink(3);
+    return true;
+}
+
+static bool Set__apply_operator(SetBinaryOp op, int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    int length = py_tuple_len(argv);
-    py_Ref _1 = py_arg(1);
-    if(_1->type == tp_int) {
-        int index = py_toint(py_arg(1));
-        if(!pk__normalize_index(&index, length)) return false;
-        *py_retval() = *py_getslot(argv, index);
+    if(!Set__check(py_arg(1)->type)) {
+        py_newnotimplemented(py_retval());
         return true;
-    } else if(_1->type == tp_slice) {
-        int start, stop, step;
-        bool ok = pk__parse_int_slice(_1, length, &start, &stop, &step);
-        if(!ok) return false;
-        py_Ref tmp = py_pushtmp();
-        py_newlist(tmp);
-        PK_SLICE_LOOP(i, start, stop, step) py_list_append(tmp, py_getslot(argv, i));
-        // convert list to tuple
-        py_Ref p = py_newtuple(py_retval(), py_list_len(tmp));
-        for(int i = 0; i < py_tuple_len(py_retval()); i++) {
-            p[i] = *py_list_getitem(tmp, i);
-        }
+    }
+    py_Ref res = py_pushtmp();
+    bool ok = op(res, Set__result_type(argv), py_touserdata(argv), py_touserdata(py_arg(1)));
+    if(ok) py_assign(py_retval(), res);
+    py_pop();
+    return ok;
+}
+
+///////////////////////////////
+static bool set__new__(int argc, py_Ref argv) {
+    Set__new(py_retval(), py_totype(argv));
+    return true;
+}
+
+static bool set__init__(int argc, py_Ref argv) {
+    if(argc > 2) return TypeError("set() takes at most 1 argument (%d given)", argc - 1);
+    Dict* self = py_touserdata(argv);
+    if(self->length > 0) Dict__clear(self);
+    if(argc == 2 && !Set__update(self, py_arg(1))) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool frozenset__new__(int argc, py_Ref argv) {
+    if(argc > 2) return TypeError("frozenset() takes at most 1 argument (%d given)", argc - 1);
+    py_Type cls = py_totype(argv);
+    if(argc == 2 && cls == tp_frozenset && py_istype(py_arg(1), tp_frozenset)) {
+        py_assign(py_retval(), py_arg(1));
+        return true;
+    }
+    py_Ref res = py_pushtmp();
+    Dict* self = Set__new(res, cls);
+    if(argc == 2 && !Set__update(self, py_arg(1))) {
         py_pop();
+        return false;
+    }
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+void pk_newset(py_OutRef out) { Set__new(out, tp_set); }
+
+bool pk_set_add(py_Ref self, py_Ref key) {
+    assert(py_istype(self, tp_set));
+    return Dict__set(py_touserdata(self), key, py_None());
+}
+
+static bool set__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Dict* self = py_touserdata(argv);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    bool is_set = argv->type == tp_set;
+    if(self->length == 0) {
+        pk_sprintf(&buf, "%t()", argv->type);
+        c11_sbuf__py_submit(&buf, py_retval());
         return true;
-    } else {
-        return TypeError("tuple indices must be integers");
     }
+    if(!is_set) pk_sprintf(&buf, "%t(", argv->type);
+    c11_sbuf__write_char(&buf, '{');
+    bool is_first = true;
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        if(!is_first) c11_sbuf__write_cstr(&buf, ", ");
+        if(!py_repr(&entry->key)) {
+            c11_sbuf__dtor(&buf);
+            return false;
+        }
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
+        is_first = false;
+    }
+    c11_sbuf__write_char(&buf, '}');
+    if(!is_set) c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
 }
 
-static bool tuple__eq__(int argc, py_Ref argv) {
-    return pk_wrapper__arrayequal(tp_tuple, argc, argv);
+static bool set__eq__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!Set__check(py_arg(1)->type)) {
+        py_newnotimplemented(py_retval());
+        return true;
+    }
+    Dict* self = py_touserdata(argv);
+    Dict* other = py_touserdata(py_arg(1));
+    bool res = false;
+    if(self->length == other->length && !Set__contains_all(self, other, &res)) return false;
+    py_newbool(py_retval(), res);
+    return true;
 }
 
-static bool tuple__ne__(int argc, py_Ref argv) {
-    if(!tuple__eq__(argc, argv)) return false;
+static bool set__ne__(int argc, py_Ref argv) {
+    if(!set__eq__(argc, argv)) return false;
     if(py_isbool(py_retval())) {
         bool res = py_tobool(py_retval());
         py_newbool(py_retval(), !res);
@@ -17988,176 +20310,896 @@ static bool tuple__ne__(int argc, py_Ref argv) {
     return true;
 }
 
-static bool tuple__lt__(int argc, py_Ref argv) {
+// a <= b, a < b, a >= b, a > b
+static bool Set__compare(int argc, py_Ref argv, bool superset, bool strict) {
     PY_CHECK_ARGC(2);
-    if(!py_istype(py_arg(1), tp_tuple)) {
+    if(!Set__check(py_arg(1)->type)) {
         py_newnotimplemented(py_retval());
         return true;
     }
-    py_TValue *p0, *p1;
-    int lhs_length = py_tuple_len(py_arg(0));
-    int rhs_length = py_tuple_len(py_arg(1));
-    p0 = py_tuple_data(py_arg(0));
-    p1 = py_tuple_data(py_arg(1));
-    int length = lhs_length < rhs_length ? lhs_length : rhs_length;
-    for(int i = 0; i < length; i++) {
-        int res_lt = py_less(p0 + i, p1 + i);
-        if(res_lt == -1) return false;
-        if(res_lt) {
-            py_newbool(py_retval(), true);
-            return true;
-        } else {
-            int res_eq = py_equal(p0 + i, p1 + i);
-            if(res_eq == -1) return false;
-            if(!res_eq) {
-                py_newbool(py_retval(), false);
-                return true;
-            }
-        }
+    Dict* a = py_touserdata(argv);
+    Dict* b = py_touserdata(py_arg(1));
+    if(superset) {
+        Dict* t = a;
+        a = b;
+        b = t;
     }
-    py_newbool(py_retval(), lhs_length < rhs_length);
+    bool res = false;
+    if(!strict || a->length < b->length) {
+        if(!Set__contains_all(a, b, &res)) return false;
+    }
+    py_newbool(py_retval(), res);
     return true;
 }
 
-static bool tuple__iter__(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(1);
-    tuple_iterator* ud = py_newobject(py_retval(), tp_tuple_iterator, 1, sizeof(tuple_iterator));
-    ud->p = py_tuple_data(argv);
-    ud->length = py_tuple_len(argv);
-    ud->index = 0;
-    py_setslot(py_retval(), 0, argv);  // keep a reference to the object
-    return true;
+static bool set__le__(int argc, py_Ref argv) { return Set__compare(argc, argv, false, false); }
+
+static bool set__lt__(int argc, py_Ref argv) { return Set__compare(argc, argv, false, true); }
+
+static bool set__ge__(int argc, py_Ref argv) { return Set__compare(argc, argv, true, false); }
+
+static bool set__gt__(int argc, py_Ref argv) { return Set__compare(argc, argv, true, true); }
+
+static bool set__or__(int argc, py_Ref argv) {
+    return Set__apply_operator(Set__union, argc, argv);
 }
 
-static bool tuple__contains__(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(2);
-    return pk_arraycontains(py_arg(0), py_arg(1));
+static bool set__and__(int argc, py_Ref argv) {
+    return Set__apply_operator(Set__intersection, argc, argv);
 }
 
-static bool tuple__hash__(int argc, py_Ref argv) {
+static bool set__sub__(int argc, py_Ref argv) {
+    return Set__apply_operator(Set__difference, argc, argv);
+}
+
+static bool set__xor__(int argc, py_Ref argv) {
+    return Set__apply_operator(Set__symmetric_difference, argc, argv);
+}
+
+static bool frozenset__hash__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
-    int length = py_tuple_len(argv);
-    py_TValue* data = py_tuple_data(argv);
-    uint64_t x = 1000003;
-    for(int i = 0; i < length; i++) {
-        py_i64 y;
-        if(!py_hash(&data[i], &y)) return false;
-        // recommended by Github Copilot
-        x = x ^ (y + 0x9e3779b9 + (x << 6) + (x >> 2));
+    Dict* self = py_touserdata(argv);
+    // same mixing as CPython, so the result does not depend on the iteration order
+    uint64_t hash = 0;
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        uint64_t h = entry->hash;
+        hash ^= ((h ^ 89869747ull) ^ (h << 16)) * 3644798167ull;
     }
-    py_newint(py_retval(), x);
+    hash ^= ((uint64_t)self->length + 1) * 1927868237ull;
+    hash ^= (hash >> 11) ^ (hash >> 25);
+    hash = hash * 69069ull + 907133923ull;
+    py_newint(py_retval(), (py_i64)hash);
     return true;
 }
 
-py_Type pk_tuple__register() {
-    py_Type type = pk_newtype("tuple", tp_object, NULL, NULL, false, true);
-
-    py_bindmagic(type, __len__, tuple__len__);
-    py_bindmagic(type, __repr__, tuple__repr__);
-    py_bindmagic(type, __new__, tuple__new__);
-    py_bindmagic(type, __getitem__, tuple__getitem__);
-    py_bindmagic(type, __eq__, tuple__eq__);
-    py_bindmagic(type, __ne__, tuple__ne__);
-    py_bindmagic(type, __lt__, tuple__lt__);
-    py_bindmagic(type, __iter__, tuple__iter__);
-    py_bindmagic(type, __contains__, tuple__contains__);
-    py_bindmagic(type, __hash__, tuple__hash__);
-    return type;
+static bool set__reduce__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Dict* self = py_touserdata(argv);
+    py_Ref args = py_pushtmp();
+    py_Ref elems = py_newtuple(args, 1);
+    py_newlistn(elems, self->length);
+    int n = 0;
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        py_list_setitem(elems, n++, &entry->key);
+    }
+    py_Ref p = py_newtuple(py_retval(), 2);
+    p[0] = *py_tpobject(argv->type);
+    p[1] = *args;
+    py_pop();
+    return true;
 }
 
-// src/public/PyList.c
-void py_newlist(py_OutRef out) {
-    List* ud = py_newobject(out, tp_list, 0, sizeof(List));
-    c11_vector__ctor(ud, sizeof(py_TValue));
+static bool set_copy(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    if(py_istype(argv, tp_frozenset)) {
+        py_assign(py_retval(), argv);
+        return true;
+    }
+    py_Ref res = py_pushtmp();
+    Set__copy(res, Set__result_type(argv), py_touserdata(argv));
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
 }
 
-void py_newlistn(py_OutRef out, int n) {
-    py_newlist(out);
-    List* ud = py_touserdata(out);
-    c11_vector__reserve(ud, n);
-    ud->length = n;
+static bool set_union(int argc, py_Ref argv) {
+    return Set__apply_method(Set__union, argc, argv);
 }
 
-py_Ref py_list_data(py_Ref self) {
-    List* ud = py_touserdata(self);
-    return ud->data;
+static bool set_intersection(int argc, py_Ref argv) {
+    return Set__apply_method(Set__intersection, argc, argv);
 }
 
-py_Ref py_list_getitem(py_Ref self, int i) {
-    List* ud = py_touserdata(self);
-    return c11__at(py_TValue, ud, i);
+static bool set_difference(int argc, py_Ref argv) {
+    return Set__apply_method(Set__difference, argc, argv);
 }
 
-void py_list_setitem(py_Ref self, int i, py_Ref val) {
-    List* ud = py_touserdata(self);
-    c11__setitem(py_TValue, ud, i, *val);
+static bool set_symmetric_difference(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    return Set__apply_method(Set__symmetric_difference, argc, argv);
 }
 
-void py_list_delitem(py_Ref self, int i) {
-    List* ud = py_touserdata(self);
-    c11_vector__erase(py_TValue, ud, i);
+static bool set_isdisjoint(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Dict* other = Set__view(py_arg(1), py_pushtmp());
+    bool res;
+    bool ok = other && Set__isdisjoint(py_touserdata(argv), other, &res);
+    py_pop();
+    if(ok) py_newbool(py_retval(), res);
+    return ok;
 }
 
-int py_list_len(py_Ref self) {
-    List* ud = py_touserdata(self);
-    return ud->length;
+static bool set_issubset(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Dict* other = Set__view(py_arg(1), py_pushtmp());
+    bool res;
+    bool ok = other && Set__contains_all(py_touserdata(argv), other, &res);
+    py_pop();
+    if(ok) py_newbool(py_retval(), res);
+    return ok;
 }
 
-void py_list_swap(py_Ref self, int i, int j) {
-    py_TValue* data = py_list_data(self);
-    py_TValue tmp = data[i];
-    data[i] = data[j];
-    data[j] = tmp;
+static bool set_issuperset(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Dict* other = Set__view(py_arg(1), py_pushtmp());
+    bool res;
+    bool ok = other && Set__contains_all(other, py_touserdata(argv), &res);
+    py_pop();
+    if(ok) py_newbool(py_retval(), res);
+    return ok;
 }
 
-void py_list_append(py_Ref self, py_Ref val) {
-    List* ud = py_touserdata(self);
-    c11_vector__push(py_TValue, ud, *val);
+static bool set_add(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!Dict__set(py_touserdata(argv), py_arg(1), py_None())) return false;
+    py_newnone(py_retval());
+    return true;
 }
 
-py_ItemRef py_list_emplace(py_Ref self) {
-    List* ud = py_touserdata(self);
-    c11_vector__emplace(ud);
-    return &c11_vector__back(py_TValue, ud);
+static bool set_remove(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    int res = Dict__pop(py_touserdata(argv), py_arg(1));
+    if(res == -1) return false;
+    if(res == 0) return KeyError(py_arg(1));
+    py_newnone(py_retval());
+    return true;
 }
 
-void py_list_clear(py_Ref self) {
-    List* ud = py_touserdata(self);
-    c11_vector__clear(ud);
+static bool set_discard(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(Dict__pop(py_touserdata(argv), py_arg(1)) == -1) return false;
+    py_newnone(py_retval());
+    return true;
 }
 
-void py_list_insert(py_Ref self, int i, py_Ref val) {
-    List* ud = py_touserdata(self);
-    c11_vector__insert(py_TValue, ud, i, *val);
+static bool set_pop(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Dict* self = py_touserdata(argv);
+    for(int i = self->entries.length - 1; i >= 0; i--) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        py_Ref key = py_pushtmp();
+        *key = entry->key;
+        int res = Dict__remove(self, key, entry->hash);
+        c11__rtassert(res == 1);
+        // deleted entries are not referenced by the index, so the tail can be dropped,
+        // which keeps draining a set with pop() linear
+        while(self->entries.length > 0 &&
+              py_isnil(&c11_vector__back(DictEntry, &self->entries).key)) {
+            self->entries.length--;
+        }
+        py_assign(py_retval(), key);
+        py_pop();
+        return true;
+    }
+    py_Ref msg = py_pushtmp();
+    py_newstr(msg, "pop from an empty set");
+    bool ok = KeyError(msg);
+    py_pop();
+    return ok;
 }
 
-////////////////////////////////
-static bool list__len__(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(1);
-    py_i64 res = py_list_len(py_arg(0));
-    py_newint(py_retval(), res);
+static bool set_update(int argc, py_Ref argv) {
+    Dict* self = py_touserdata(argv);
+    for(int i = 1; i < argc; i++) {
+        if(!Set__update(self, py_arg(i))) return false;
+    }
+    py_newnone(py_retval());
     return true;
 }
 
-static bool list__eq__(int argc, py_Ref argv) {
-    return pk_wrapper__arrayequal(tp_list, argc, argv);
+static bool set_intersection_update(int argc, py_Ref argv) {
+    Dict* self = py_touserdata(argv);
+    py_Ref tmp = py_pushtmp();
+    py_Ref view = py_pushtmp();
+    for(int i = 1; i < argc; i++) {
+        Dict* other = Set__view(py_arg(i), view);
+        if(!other || !Set__intersection(tmp, tp_set, self, other)) {
+            py_shrink(2);
+            return false;
+        }
+        Set__assign(self, py_touserdata(tmp));
+    }
+    py_shrink(2);
+    py_newnone(py_retval());
+    return true;
 }
 
-static bool list__ne__(int argc, py_Ref argv) {
-    if(!list__eq__(argc, argv)) return false;
-    if(py_isbool(py_retval())) {
-        bool res = py_tobool(py_retval());
-        py_newbool(py_retval(), !res);
+static bool set_difference_update(int argc, py_Ref argv) {
+    Dict* self = py_touserdata(argv);
+    py_Ref view = py_pushtmp();
+    for(int i = 1; i < argc; i++) {
+        if(py_arg(i)->_obj == argv->_obj) {
+            Dict__clear(self);
+            continue;
+        }
+        Dict* other = Set__view(py_arg(i), view);
+        if(!other) {
+            py_pop();
+            return false;
+        }
+        for(int j = 0; j < other->entries.length; j++) {
+            DictEntry* entry = c11__at(DictEntry, &other->entries, j);
+            if(py_isnil(&entry->key)) continue;
+            if(Dict__remove(self, &entry->key, entry->hash) == -1) {
+                py_pop();
+                return false;
+            }
+        }
     }
+    py_pop();
+    py_newnone(py_retval());
     return true;
 }
 
-static bool list__new__(int argc, py_Ref argv) {
-    if(argc == 1) {
-        py_newlist(py_retval());
+static bool set_symmetric_difference_update(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Dict* self = py_touserdata(argv);
+    if(py_arg(1)->_obj == argv->_obj) {
+        Dict__clear(self);
+        py_newnone(py_retval());
         return true;
     }
-    if(argc == 2) {
+    Dict* other = Set__view(py_arg(1), py_pushtmp());
+    bool ok = other && Set__toggle(self, other);
+    py_pop();
+    if(ok) py_newnone(py_retval());
+    return ok;
+}
+
+static void Set__bind_common(py_Type type) {
+    py_bindmagic(type, __contains__, dict__contains__);
+    py_bindmagic(type, __len__, dict__len__);
+    py_bindmagic(type, __iter__, dict_keys);
+    py_bindmagic(type, __repr__, set__repr__);
+    py_bindmagic(type, __eq__, set__eq__);
+    py_bindmagic(type, __ne__, set__ne__);
+    py_bindmagic(type, __le__, set__le__);
+    py_bindmagic(type, __lt__, set__lt__);
+    py_bindmagic(type, __ge__, set__ge__);
+    py_bindmagic(type, __gt__, set__gt__);
+    py_bindmagic(type, __or__, set__or__);
+    py_bindmagic(type, __and__, set__and__);
+    py_bindmagic(type, __sub__, set__sub__);
+    py_bindmagic(type, __xor__, set__xor__);
+    py_bindmagic(type, __reduce__, set__reduce__);
+
+    py_bindmethod(type, "copy", set_copy);
+    py_bindmethod(type, "union", set_union);
+    py_bindmethod(type, "intersection", set_intersection);
+    py_bindmethod(type, "difference", set_difference);
+    py_bindmethod(type, "symmetric_difference", set_symmetric_difference);
+    py_bindmethod(type, "isdisjoint", set_isdisjoint);
+    py_bindmethod(type, "issubset", set_issubset);
+    py_bindmethod(type, "issuperset", set_issuperset);
+}
+
+py_Type pk_set__register() {
+    py_Type type = pk_newtype("set", tp_object, NULL, (void (*)(void*))Dict__dtor, false, false);
+    Set__bind_common(type);
+    py_bindmagic(type, __new__, set__new__);
+    py_bindmagic(type, __init__, set__init__);
+
+    py_bindmethod(type, "add", set_add);
+    py_bindmethod(type, "remove", set_remove);
+    py_bindmethod(type, "discard", set_discard);
+    py_bindmethod(type, "pop", set_pop);
+    py_bindmethod(type, "clear", dict_clear);
+    py_bindmethod(type, "update", set_update);
+    py_bindmethod(type, "intersection_update", set_intersection_update);
+    py_bindmethod(type, "difference_update", set_difference_update);
+    py_bindmethod(type, "symmetric_difference_update", set_symmetric_difference_update);
+
+    py_setdict(py_tpobject(type), __hash__, py_None());
+    return type;
+}
+
+py_Type pk_frozenset__register() {
+    py_Type type =
+        pk_newtype("frozenset", tp_object, NULL, (void (*)(void*))Dict__dtor, false, false);
+    Set__bind_common(type);
+    py_bindmagic(type, __new__, frozenset__new__);
+    py_bindmagic(type, __hash__, frozenset__hash__);
+    return type;
+}
+
+///////////////////////////////
+// collections.Counter and collections.defaultdict are dicts whose missing keys are handled in
+// dict.__getitem__ directly
+
+typedef struct {
+    Dict* dict;
+    bool subtract;
+} CounterContext;
+
+// `self[key] += delta`, with a single probe when the count is an int
+static bool Counter__add(Dict* self, py_Ref key, py_Ref delta, bool subtract) {
+    uint64_t hash;
+    if(!Dict__hash_key(key, &hash)) return false;
+    py_TValue zero;
+    py_newint(&zero, 0);
+    DictEntry* entry;
+    if(!Dict__emplace(self, key, hash, &zero, &entry)) return false;
+    if(py_isint(&entry->val) && py_isint(delta)) {
+        py_i64 count = py_toint(&entry->val);
+        py_newint(&entry->val, subtract ? count - py_toint(delta) : count + py_toint(delta));
+        return true;
+    }
+    bool ok = subtract ? py_binarysub(&entry->val, delta) : py_binaryadd(&entry->val, delta);
+    if(!ok) return false;
+    return Dict__insert(self, key, hash, py_retval());
+}
+
+static int Counter__update_visit(py_Ref item, void* ctx) {
+    CounterContext* p = ctx;
+    py_TValue one;
+    py_newint(&one, 1);
+    return Counter__add(p->dict, item, &one, p->subtract) ? 1 : -1;
+}
+
+static bool Counter__update(py_Ref self, py_Ref iterable, bool subtract) {
+    if(py_isnone(iterable)) return true;
+    Dict* dict = py_touserdata(self);
+    if(!py_isinstance(iterable, tp_dict)) {
+        CounterContext ctx = {dict, subtract};
+        return pk_foreach(iterable, Counter__update_visit, &ctx) != -1;
+    }
+    // add the counts of a mapping, re-reading its entries since they may move
+    Dict* other = py_touserdata(iterable);
+    py_Ref key = py_pushtmp();
+    py_Ref val = py_pushtmp();
+    for(int i = 0; i < other->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &other->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        *key = entry->key;
+        *val = entry->val;
+        if(!Counter__add(dict, key, val, subtract)) return false;
+    }
+    py_shrink(2);
+    return true;
+}
+
+static bool Counter__init__(int argc, py_Ref argv) {
+    // __init__(self, iterable=None)
+    if(!Counter__update(argv, py_arg(1), false)) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool Counter_update(int argc, py_Ref argv) {
+    // update(self, iterable=None)
+    if(!Counter__update(argv, py_arg(1), false)) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool Counter_subtract(int argc, py_Ref argv) {
+    // subtract(self, iterable=None)
+    if(!Counter__update(argv, py_arg(1), true)) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool Counter_most_common(int argc, py_Ref argv) {
+    // most_common(self, n=None)
+    Dict* self = py_touserdata(argv);
+    int length = self->length;
+    int n = length;
+    if(!py_isnone(py_arg(1))) {
+        PY_CHECK_ARG_TYPE(1, tp_int);
+        py_i64 limit = py_toint(py_arg(1));
+        if(limit < n) n = limit < 0 ? 0 : (int)limit;
+    }
+    // snapshot the items, then rank them by count
+    py_Ref items = py_pushtmp();
+    py_Ref counts = py_pushtmp();
+    py_newlistn(items, length);
+    py_newlistn(counts, length);
+    for(int i = 0, j = 0; j < length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        py_Ref p = py_newtuple(py_list_getitem(items, j), 2);
+        p[0] = entry->key;
+        p[1] = entry->val;
+        py_list_setitem(counts, j, &entry->val);
+        j++;
+    }
+    int* indices = PK_MALLOC(sizeof(int) * c11__max(n, 1));
+    bool ok = pk_nselect(py_list_data(counts), length, n, true, indices);
+    if(ok) {
+        py_newlistn(py_retval(), n);
+        for(int i = 0; i < n; i++) {
+            py_list_setitem(py_retval(), i, py_list_getitem(items, indices[i]));
+        }
+        py_shrink(2);
+    }
+    PK_FREE(indices);
+    return ok;
+}
+
+static bool Counter_total(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Dict* self = py_touserdata(argv);
+    py_Ref total = py_pushtmp();
+    py_newint(total, 0);
+    for(int i = 0; i < self->entries.length; i++) {
+        DictEntry* entry = c11__at(DictEntry, &self->entries, i);
+        if(py_isnil(&entry->key)) continue;
+        if(py_isint(total) && py_isint(&entry->val)) {
+            py_newint(total, py_toint(total) + py_toint(&entry->val));
+        } else {
+            if(!py_binaryadd(total, &entry->val)) return false;
+            *total = *py_retval();
+        }
+    }
+    py_assign(py_retval(), total);
+    py_pop();
+    return true;
+}
+
+static bool Counter_copy(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Dict* ud = py_newobject(py_retval(), argv->type, -1, sizeof(Dict));
+    Dict__copy(ud, py_touserdata(argv));
+    return true;
+}
+
+static bool Counter__missing__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_newint(py_retval(), 0);
+    return true;
+}
+
+static bool Counter__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    // ordered like most_common()
+    py_Ref args = py_pushtmp();
+    py_pushtmp();
+    args[0] = *argv;
+    py_newnone(&args[1]);
+    if(!Counter_most_common(2, args)) return false;
+    args[1] = *py_retval();
+    int length = py_list_len(&args[1]);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    pk_sprintf(&buf, "%t(", argv->type);
+    if(length > 0) c11_sbuf__write_char(&buf, '{');
+    for(int i = 0; i < length; i++) {
+        py_Ref item = py_list_getitem(&args[1], i);
+        if(i > 0) c11_sbuf__write_cstr(&buf, ", ");
+        if(!py_repr(py_tuple_getitem(item, 0))) goto __ERROR;
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
+        c11_sbuf__write_cstr(&buf, ": ");
+        if(!py_repr(py_tuple_getitem(item, 1))) goto __ERROR;
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
+    }
+    if(length > 0) c11_sbuf__write_char(&buf, '}');
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    py_shrink(2);
+    return true;
+__ERROR:
+    c11_sbuf__dtor(&buf);
+    return false;
+}
+
+py_Type pk_Counter__register(py_GlobalRef mod) {
+    py_Type type = py_newtype("Counter", tp_dict, mod, NULL);
+    py_bind(py_tpobject(type), "__init__(self, iterable=None)", Counter__init__);
+    py_bindmagic(type, __missing__, Counter__missing__);
+    py_bindmagic(type, __repr__, Counter__repr__);
+    py_bind(py_tpobject(type), "update(self, iterable=None)", Counter_update);
+    py_bind(py_tpobject(type), "subtract(self, iterable=None)", Counter_subtract);
+    py_bind(py_tpobject(type), "most_common(self, n=None)", Counter_most_common);
+    py_bindmethod(type, "total", Counter_total);
+    py_bindmethod(type, "copy", Counter_copy);
+    return type;
+}
+
+static bool defaultdict__insert_default(py_Ref self, py_Ref key, uint64_t hash) {
+    py_Ref factory = py_getdict(self, py_name("default_factory"));
+    if(!factory || py_isnone(factory)) return KeyError(key);
+    if(!py_call(factory, 0, NULL)) return false;
+    py_Ref val = py_pushtmp();
+    *val = *py_retval();
+    if(!Dict__insert(py_touserdata(self), key, hash, val)) return false;
+    py_assign(py_retval(), val);
+    py_pop();
+    return true;
+}
+
+static bool defaultdict__init__(int argc, py_Ref argv) {
+    // __init__(self, *args)
+    int length = py_tuple_len(py_arg(1));
+    if(length > 2) return TypeError("defaultdict expected at most 2 arguments, got %d", length);
+    py_Ref factory = length > 0 ? py_tuple_getitem(py_arg(1), 0) : py_None();
+    if(!py_isnone(factory) && !py_callable(factory)) {
+        return TypeError("first argument must be callable or None");
+    }
+    py_setdict(argv, py_name("default_factory"), factory);
+    if(length == 2) {
+        py_Ref other = py_tuple_getitem(py_arg(1), 1);
+        if(py_isinstance(other, tp_dict)) {
+            Dict* self = py_touserdata(argv);
+            Dict* ud = py_touserdata(other);
+            for(int i = 0; i < ud->entries.length; i++) {
+                DictEntry* entry = c11__at(DictEntry, &ud->entries, i);
+                if(py_isnil(&entry->key)) continue;
+                if(!Dict__set(self, &entry->key, &entry->val)) return false;
+            }
+        } else {
+            py_Ref args = py_pushtmp();
+            py_pushtmp();
+            args[0] = *argv;
+            args[1] = *other;
+            if(!dict__init__(2, args)) return false;
+            py_shrink(2);
+        }
+    }
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool defaultdict__missing__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    uint64_t hash;
+    if(!Dict__hash_key(py_arg(1), &hash)) return false;
+    return defaultdict__insert_default(argv, py_arg(1), hash);
+}
+
+static bool defaultdict__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref factory = py_getdict(argv, py_name("default_factory"));
+    if(!py_repr(factory ? factory : py_None())) return false;
+    py_Ref factory_repr = py_pushtmp();
+    *factory_repr = *py_retval();
+    if(!dict__repr__(1, argv)) return false;
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    pk_sprintf(&buf, "%t(%v, %v)", argv->type, py_tosv(factory_repr), py_tosv(py_retval()));
+    c11_sbuf__py_submit(&buf, py_retval());
+    py_pop();
+    return true;
+}
+
+static bool defaultdict_copy(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref factory = py_getdict(argv, py_name("default_factory"));
+    Dict* ud = py_newobject(py_retval(), argv->type, -1, sizeof(Dict));
+    Dict__copy(ud, py_touserdata(argv));
+    py_setdict(py_retval(), py_name("default_factory"), factory ? factory : py_None());
+    return true;
+}
+
+py_Type pk_defaultdict__register(py_GlobalRef mod) {
+    py_Type type = py_newtype("defaultdict", tp_dict, mod, NULL);
+    py_bind(py_tpobject(type), "__init__(self, *args)", defaultdict__init__);
+    py_bindmagic(type, __missing__, defaultdict__missing__);
+    py_bindmagic(type, __repr__, defaultdict__repr__);
+    py_bindmethod(type, "copy", defaultdict_copy);
+    return type;
+}
+
+#undef Dict__step
+// src/public/PyTuple.c
+py_ObjectRef py_newtuple(py_OutRef out, int n) {
+    VM* vm = pk_current_vm;
+    PyObject* obj = ManagedHeap__gcnew(&vm->heap, tp_tuple, n, 0);
+    out->type = tp_tuple;
+    out->is_ptr = true;
+    out->_obj = obj;
+    return PyObject__slots(obj);
+}
+
+py_Ref py_tuple_getitem(py_Ref self, int i) { return py_getslot(self, i); }
+
+py_Ref py_tuple_data(py_Ref self) { return PyObject__slots(self->_obj); }
+
+void py_tuple_setitem(py_Ref self, int i, py_Ref val) { py_setslot(self, i, val); }
+
+int py_tuple_len(py_Ref self) { return self->_obj->slots; }
+
+//////////////
+static bool tuple__len__(int argc, py_Ref argv) {
+    py_newint(py_retval(), py_tuple_len(argv));
+    return true;
+}
+
+static bool tuple__repr__(int argc, py_Ref argv) {
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    c11_sbuf__write_char(&buf, '(');
+    int length = py_tuple_len(argv);
+    for(int i = 0; i < length; i++) {
+        py_TValue* val = py_getslot(argv, i);
+        bool ok = py_repr(val);
+        if(!ok) {
+            c11_sbuf__dtor(&buf);
+            return false;
+        }
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
+        if(i != length - 1) c11_sbuf__write_cstr(&buf, ", ");
+    }
+    if(length == 1) c11_sbuf__write_char(&buf, ',');
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+static bool tuple__new__(int argc, py_Ref argv) {
+    if(argc == 1 + 0) {
+        py_newtuple(py_retval(), 0);
+        return true;
+    }
+    if(argc == 1 + 1) {
+        bool ok = py_tpcall(tp_list, 1, py_arg(1));
+        if(!ok) return false;
+        py_Ref tmp = py_pushtmp();
+        *tmp = *py_retval();  // backup the list
+        int length = py_list_len(tmp);
+        py_Ref p = py_newtuple(py_retval(), length);
+        for(int i = 0; i < py_tuple_len(py_retval()); i++) {
+            p[i] = *py_list_getitem(tmp, i);
+        }
+        py_pop();
+        return true;
+    }
+    return TypeError("tuple() takes at most 1 argument");
+}
+
+static bool tuple__getitem__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    int length = py_tuple_len(argv);
+    py_Ref _1 = py_arg(1);
+    if(_1->type == tp_int) {
+        int index = py_toint(py_arg(1));
+        if(!pk__normalize_index(&index, length)) return false;
+        *py_retval() = *py_getslot(argv, index);
+        return true;
+    } else if(_1->type == tp_slice) {
+        int start, stop, step;
+        bool ok = pk__parse_int_slice(_1, length, &start, &stop, &step);
+        if(!ok) return false;
+        py_Ref tmp = py_pushtmp();
+        py_newlist(tmp);
+        PK_SLICE_LOOP(i, start, stop, step) py_list_append(tmp, py_getslot(argv, i));
+        // convert list to tuple
+        py_Ref p = py_newtuple(py_retval(), py_list_len(tmp));
+        for(int i = 0; i < py_tuple_len(py_retval()); i++) {
+            p[i] = *py_list_getitem(tmp, i);
+        }
+        py_pop();
+        return true;
+    } else {
+        return TypeError("tuple indices must be integers");
+    }
+}
+
+static bool tuple__eq__(int argc, py_Ref argv) {
+    return pk_wrapper__arrayequal(tp_tuple, argc, argv);
+}
+
+static bool tuple__ne__(int argc, py_Ref argv) {
+    if(!tuple__eq__(argc, argv)) return false;
+    if(py_isbool(py_retval())) {
+        bool res = py_tobool(py_retval());
+        py_newbool(py_retval(), !res);
+    }
+    return true;
+}
+
+static bool tuple__lt__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!py_istype(py_arg(1), tp_tuple)) {
+        py_newnotimplemented(py_retval());
+        return true;
+    }
+    py_TValue *p0, *p1;
+    int lhs_length = py_tuple_len(py_arg(0));
+    int rhs_length = py_tuple_len(py_arg(1));
+    p0 = py_tuple_data(py_arg(0));
+    p1 = py_tuple_data(py_arg(1));
+    int length = lhs_length < rhs_length ? lhs_length : rhs_length;
+    for(int i = 0; i < length; i++) {
+        int res_lt = py_less(p0 + i, p1 + i);
+        if(res_lt == -1) return false;
+        if(res_lt) {
+            py_newbool(py_retval(), true);
+            return true;
+        } else {
+            int res_eq = py_equal(p0 + i, p1 + i);
+            if(res_eq == -1) return false;
+            if(!res_eq) {
+                py_newbool(py_retval(), false);
+                return true;
+            }
+        }
+    }
+    py_newbool(py_retval(), lhs_length < rhs_length);
+    return true;
+}
+
+static bool tuple__iter__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    tuple_iterator* ud = py_newobject(py_retval(), tp_tuple_iterator, 1, sizeof(tuple_iterator));
+    ud->p = py_tuple_data(argv);
+    ud->length = py_tuple_len(argv);
+    ud->index = 0;
+    py_setslot(py_retval(), 0, argv);  // keep a reference to the object
+    return true;
+}
+
+static bool tuple__contains__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    return pk_arraycontains(py_arg(0), py_arg(1));
+}
+
+static bool tuple__hash__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int length = py_tuple_len(argv);
+    py_TValue* data = py_tuple_data(argv);
+    uint64_t x = 1000003;
+    for(int i = 0; i < length; i++) {
+        py_i64 y;
+        if(!py_hash(&data[i], &y)) return false;
+        // recommended by Github Copilot
+        x = x ^ (y + 0x9e3779b9 + (x << 6) + (x >> 2));
+    }
+    py_newint(py_retval(), x);
+    return true;
+}
+
+py_Type pk_tuple__register() {
+    py_Type type = pk_newtype("tuple", tp_object, NULL, NULL, false, true);
+
+    py_bindmagic(type, __len__, tuple__len__);
+    py_bindmagic(type, __repr__, tuple__repr__);
+    py_bindmagic(type, __new__, tuple__new__);
+    py_bindmagic(type, __getitem__, tuple__getitem__);
+    py_bindmagic(type, __eq__, tuple__eq__);
+    py_bindmagic(type, __ne__, tuple__ne__);
+    py_bindmagic(type, __lt__, tuple__lt__);
+    py_bindmagic(type, __iter__, tuple__iter__);
+    py_bindmagic(type, __contains__, tuple__contains__);
+    py_bindmagic(type, __hash__, tuple__hash__);
+    return type;
+}
+
+// src/public/PyList.c
+#include <limits.h>
+
+void py_newlist(py_OutRef out) {
+    List* ud = py_newobject(out, tp_list, 0, sizeof(List));
+    c11_vector__ctor(ud, sizeof(py_TValue));
+}
+
+static void List__account_growth(List* self, int old_capacity) {
+    if(self->capacity == old_capacity) return;
+    size_t bytes = (size_t)(self->capacity - old_capacity) * sizeof(py_TValue);
+    ManagedHeap__account_buffer(&pk_current_vm->heap, bytes);
+}
+
+void py_newlistn(py_OutRef out, int n) {
+    py_newlist(out);
+    List* ud = py_touserdata(out);
+    c11_vector__reserve(ud, n);
+    List__account_growth(ud, 0);
+    ud->length = n;
+}
+
+py_Ref py_list_data(py_Ref self) {
+    List* ud = py_touserdata(self);
+    return ud->data;
+}
+
+py_Ref py_list_getitem(py_Ref self, int i) {
+    List* ud = py_touserdata(self);
+    return c11__at(py_TValue, ud, i);
+}
+
+void py_list_setitem(py_Ref self, int i, py_Ref val) {
+    List* ud = py_touserdata(self);
+    c11__setitem(py_TValue, ud, i, *val);
+}
+
+void py_list_delitem(py_Ref self, int i) {
+    List* ud = py_touserdata(self);
+    c11_vector__erase(py_TValue, ud, i);
+}
+
+int py_list_len(py_Ref self) {
+    List* ud = py_touserdata(self);
+    return ud->length;
+}
+
+void py_list_swap(py_Ref self, int i, int j) {
+    py_TValue* data = py_list_data(self);
+    py_TValue tmp = data[i];
+    data[i] = data[j];
+    data[j] = tmp;
+}
+
+void py_list_append(py_Ref self, py_Ref val) {
+    List* ud = py_touserdata(self);
+    if(ud->length == ud->capacity) {
+        int old_capacity = ud->capacity;
+        c11_vector__reserve(ud, c11_vector__nextcap(ud));
+        List__account_growth(ud, old_capacity);
+    }
+    c11_vector__push(py_TValue, ud, *val);
+}
+
+py_ItemRef py_list_emplace(py_Ref self) {
+    List* ud = py_touserdata(self);
+    int old_capacity = ud->capacity;
+    c11_vector__emplace(ud);
+    List__account_growth(ud, old_capacity);
+    return &c11_vector__back(py_TValue, ud);
+}
+
+void py_list_clear(py_Ref self) {
+    List* ud = py_touserdata(self);
+    c11_vector__clear(ud);
+}
+
+void py_list_insert(py_Ref self, int i, py_Ref val) {
+    List* ud = py_touserdata(self);
+    int old_capacity = ud->capacity;
+    c11_vector__insert(py_TValue, ud, i, *val);
+    List__account_growth(ud, old_capacity);
+}
+
+////////////////////////////////
+static bool list__len__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_i64 res = py_list_len(py_arg(0));
+    py_newint(py_retval(), res);
+    return true;
+}
+
+static bool list__eq__(int argc, py_Ref argv) {
+    return pk_wrapper__arrayequal(tp_list, argc, argv);
+}
+
+static bool list__ne__(int argc, py_Ref argv) {
+    if(!list__eq__(argc, argv)) return false;
+    if(py_isbool(py_retval())) {
+        bool res = py_tobool(py_retval());
+        py_newbool(py_retval(), !res);
+    }
+    return true;
+}
+
+static bool list__new__(int argc, py_Ref argv) {
+    if(argc == 1) {
+        py_newlist(py_retval());
+        return true;
+    }
+    if(argc == 2) {
         py_TValue* p;
         int length = pk_arrayview(py_arg(1), &p);
         if(length != -1) {
@@ -18261,10 +21303,13 @@ static bool list__add__(int argc, py_Ref argv) {
     if(py_istype(_1, tp_list)) {
         List* list_0 = py_touserdata(_0);
         List* list_1 = py_touserdata(_1);
+        size_t bytes = ((size_t)list_0->length + list_1->length) * sizeof(py_TValue);
+        if(!ManagedHeap__reserve(&pk_current_vm->heap, bytes)) return false;
         py_newlist(py_retval());
         List* list = py_touserdata(py_retval());
         c11_vector__extend(list, list_0->data, list_0->length);
         c11_vector__extend(list, list_1->data, list_1->length);
+        List__account_growth(list, 0);
     } else {
         py_newnotimplemented(py_retval());
     }
@@ -18276,13 +21321,21 @@ static bool list__mul__(int argc, py_Ref argv) {
     py_Ref _0 = py_arg(0);
     py_Ref _1 = py_arg(1);
     if(py_istype(_1, tp_int)) {
-        int n = py_toint(_1);
+        py_i64 n = c11__max(py_toint(_1), 0);
+        List* list_0 = py_touserdata(_0);
+        int length = list_0->length;
+        if(length > 0 && n > INT_MAX / length) return MemoryError("repeated list is too long");
+        int new_length = (int)n * length;
+        size_t bytes = (size_t)new_length * sizeof(py_TValue);
+        if(!ManagedHeap__reserve(&pk_current_vm->heap, bytes)) return false;
         py_newlist(py_retval());
         List* list = py_touserdata(py_retval());
-        List* list_0 = py_touserdata(_0);
-        for(int i = 0; i < n; i++) {
-            c11_vector__extend(list, list_0->data, list_0->length);
+        c11_vector__reserve(list, new_length);
+        for(int i = 0; i < new_length; i += length) {
+            memcpy((py_TValue*)list->data + i, list_0->data, (size_t)length * sizeof(py_TValue));
         }
+        list->length = new_length;
+        List__account_growth(list, 0);
     } else {
         py_newnotimplemented(py_retval());
     }
@@ -18324,7 +21377,11 @@ static bool list_extend(int argc, py_Ref argv) {
     py_TValue* p;
     int length = pk_arrayview(py_arg(1), &p);
     if(length >= 0) {
+        size_t bytes = (size_t)length * sizeof(py_TValue);
+        if(!ManagedHeap__reserve(&pk_current_vm->heap, bytes)) return false;
+        int old_capacity = self->capacity;
         c11_vector__extend(self, p, length);
+        List__account_growth(self, old_capacity);
     } else {
         // get iterator
         if (!py_iter(py_arg(1))) return false;
@@ -18335,7 +21392,7 @@ static bool list_extend(int argc, py_Ref argv) {
             if (res == 0) break;
             if (res == -1) return false;
             assert(res == 1);
-            c11_vector__push(py_TValue, self, *py_retval());
+            py_list_append(py_arg(0), py_retval());
         }
         py_pop();
     }
@@ -18444,26 +21501,48 @@ static bool list_insert(int argc, py_Ref argv) {
     return true;
 }
 
-static int lt_with_key(py_TValue* a, py_TValue* b, py_TValue* key) {
-    if(!key) return py_less(a, b);
-    VM* vm = pk_current_vm;
-    // project a
-    py_push(key);
-    py_pushnil();
-    py_push(a);
-    if(!py_vectorcall(1, 0)) return -1;
-    py_push(py_retval());
-    // project b
-    py_push(key);
-    py_pushnil();
-    py_push(b);
-    if(!py_vectorcall(1, 0)) return -1;
-    py_push(py_retval());
-    // binary op
-    bool ok = pk_stack_binaryop(vm, __lt__, __gt__);
-    if(!ok) return -1;
-    py_shrink(2);
-    return py_bool(py_retval());
+typedef int (*list_sort_lt)(const void* a, const void* b, void* extra);
+
+// items are compared by their leading `py_TValue`, which is either the item itself or its key
+static int lt_int(const void* a, const void* b, void* extra) {
+    return ((const py_TValue*)a)->_i64 < ((const py_TValue*)b)->_i64;
+}
+
+static int lt_float(const void* a, const void* b, void* extra) {
+    return ((const py_TValue*)a)->_f64 < ((const py_TValue*)b)->_f64;
+}
+
+static int lt_str(const void* a, const void* b, void* extra) {
+    return c11_sv__cmp(py_tosv((py_Ref)a), py_tosv((py_Ref)b)) < 0;
+}
+
+static int lt_object(const void* a, const void* b, void* extra) {
+    return py_less((py_Ref)a, (py_Ref)b);
+}
+
+// keys of a single builtin scalar type are compared directly instead of through `py_less`
+static list_sort_lt list_sort__select_lt(py_TValue* p, int n, int stride) {
+    if(n == 0) return lt_object;
+    py_Type type = p->type;
+    if(type != tp_int && type != tp_float && type != tp_str) return lt_object;
+    for(int i = 1; i < n; i++) {
+        if(p[i * stride].type != type) return lt_object;
+    }
+    switch(type) {
+        case tp_int: return lt_int;
+        case tp_float: return lt_float;
+        default: return lt_str;
+    }
+}
+
+static void list_sort__reverse(py_TValue* p, int n, int stride) {
+    for(int i = 0, j = n - 1; i < j; i++, j--) {
+        for(int k = 0; k < stride; k++) {
+            py_TValue tmp = p[i * stride + k];
+            p[i * stride + k] = p[j * stride + k];
+            p[j * stride + k] = tmp;
+        }
+    }
 }
 
 // sort(self, key=None, reverse=False)
@@ -18473,18 +21552,71 @@ static bool list_sort(int argc, py_Ref argv) {
     py_Ref key = py_arg(1);
     if(py_isnone(key)) key = NULL;
 
-    bool ok = c11__stable_sort(self->data,
-                               self->length,
-                               sizeof(py_TValue),
-                               (int (*)(const void*, const void*, void*))lt_with_key,
-                               key);
-    if(!ok) return false;
-
     PY_CHECK_ARG_TYPE(2, tp_bool);
     bool reverse = py_tobool(py_arg(2));
-    if(reverse) c11__reverse(py_TValue, self);
-    py_newnone(py_retval());
-    return true;
+
+    // reversing before and after a stable sort keeps equal items in their original order
+    int n = self->length;
+    if(!key) {
+        list_sort_lt f_lt = list_sort__select_lt(self->data, n, 1);
+        if(f_lt != lt_object) {
+            // comparing scalars never runs python code, so the list is sorted in place
+            if(reverse) c11__reverse(py_TValue, self);
+            c11__stable_sort(self->data, n, sizeof(py_TValue), f_lt, NULL);
+            if(reverse) c11__reverse(py_TValue, self);
+            py_newnone(py_retval());
+            return true;
+        }
+    }
+
+    // `__lt__` and `key` may modify the list or trigger a gc, so a copy is sorted while the
+    // items are kept alive by a tuple of `[key0, item0, key1, item1, ...]` or `[item0, ...]`
+    int stride = key ? 2 : 1;
+    py_Ref tmp = py_pushtmp();
+    py_TValue* p = py_newtuple(tmp, n * stride);
+    for(int i = 0; i < n; i++) {
+        p[i * stride + stride - 1] = c11__getitem(py_TValue, self, i);
+    }
+    if(key) {
+        // call `key` once per item
+        for(int i = 0; i < n; i++) {
+            py_push(key);
+            py_pushnil();
+            py_push(&p[i * 2 + 1]);
+            if(!py_vectorcall(1, 0)) {
+                py_pop();
+                return false;
+            }
+            p[i * 2] = *py_retval();
+        }
+    }
+
+    py_TValue* buf = PK_MALLOC(sizeof(py_TValue) * n * stride);
+    memcpy(buf, p, sizeof(py_TValue) * n * stride);
+    if(reverse) list_sort__reverse(buf, n, stride);
+    list_sort_lt f_lt = list_sort__select_lt(buf, n, stride);
+    bool ok = c11__stable_sort(buf, n, sizeof(py_TValue) * stride, f_lt, NULL);
+    if(ok && reverse) list_sort__reverse(buf, n, stride);
+    // like CPython, items added or removed by `__lt__` or `key` are discarded, so the list
+    // gets back its `n` items, sorted, or in their original order if the sort failed
+    bool resized = self->length != n;
+    if(resized) {
+        int old_capacity = self->capacity;
+        c11_vector__reserve(self, n);
+        List__account_growth(self, old_capacity);
+        self->length = n;
+    }
+    if(ok || resized) {
+        py_TValue* items = ok ? buf : p;
+        for(int i = 0; i < n; i++) {
+            c11__setitem(py_TValue, self, i, items[i * stride + stride - 1]);
+        }
+    }
+    if(ok && resized) ok = ValueError("list modified during sort");
+    if(ok) py_newnone(py_retval());
+    PK_FREE(buf);
+    py_pop();
+    return ok;
 }
 
 static bool list__iter__(int argc, py_Ref argv) {
@@ -19860,13 +22992,14 @@ static bool namedict_items(int argc, py_Ref argv) {
     py_Ref object = py_getslot(argv, 0);
     NameDict* dict = PyObject__dict(object->_obj);
     py_newlist(py_retval());
-    for(int i = 0; i < dict->capacity; i++) {
-        NameDict_KV* kv = &dict->items[i];
-        if(kv->key == NULL) continue;
+    int i = 0;
+    py_Name key;
+    py_TValue* value;
+    while(NameDict__next(dict, &i, &key, &value)) {
         py_Ref slot = py_list_emplace(py_retval());
         py_Ref p = py_newtuple(slot, 2);
-        p[0] = *py_name2ref(kv->key);
-        p[1] = kv->value;
+        p[0] = *py_name2ref(key);
+        p[1] = *value;
     }
     return true;
 }
@@ -19941,6 +23074,91 @@ py_Type pk_property__register() {
     return type;
 }
 
+// src/bindings/py_member.c
+static bool pk_member__add(py_TypeInfo* ti, py_Ref name, int index) {
+    if(!py_checkstr(name)) return false;
+    py_Name n = py_namev(py_tosv(name));
+    py_ItemRef existing = py_getdict(&ti->self, n);
+    if(existing && !py_istype(existing, tp_member_descriptor)) {
+        return ValueError("'%n' in __slots__ conflicts with class variable", n);
+    }
+    MemberDescriptor* md =
+        py_newobject(py_emplacedict(&ti->self, n), tp_member_descriptor, 0, sizeof(MemberDescriptor));
+    md->name = n;
+    md->index = index;
+    return true;
+}
+
+bool pk_member__init_slots(py_TypeInfo* ti) {
+    ti->instance_slots = -1;
+    if(!ti->is_python) return true;
+    py_Ref slots = py_getdict(&ti->self, py_name("__slots__"));
+    if(!slots) return true;
+    // instances of a class without __slots__ have a __dict__ anyway
+    int offset = ti->base == tp_object ? 0 : ti->base_ti->instance_slots;
+    if(offset < 0) return true;
+
+    py_TValue* p;
+    int length;
+    if(py_isstr(slots)) {
+        p = slots;
+        length = 1;
+    } else {
+        length = pk_arrayview(slots, &p);
+        if(length == -1) {
+            return TypeError("__slots__ must be a str, list or tuple, got '%t'", slots->type);
+        }
+    }
+    for(int i = 0; i < length; i++) {
+        // '__dict__' in __slots__ asks for a dict-based layout
+        if(py_isstr(&p[i]) && strcmp(py_tostr(&p[i]), "__dict__") == 0) return true;
+    }
+    for(int i = 0; i < length; i++) {
+        if(!pk_member__add(ti, &p[i], offset + i)) return false;
+    }
+    ti->instance_slots = offset + length;
+    return true;
+}
+
+int pk_member__index(py_TypeInfo* ti, py_Name name) {
+    py_Ref cls_var = pk_tpfindname(ti, name);
+    if(cls_var == NULL || !py_istype(cls_var, tp_member_descriptor)) return -1;
+    MemberDescriptor* md = py_touserdata(cls_var);
+    return md->index;
+}
+
+static bool pk_member__names_apply(py_Name name, py_Ref val, void* ctx) {
+    if(py_istype(val, tp_member_descriptor)) {
+        MemberDescriptor* md = py_touserdata(val);
+        py_Name* out = ctx;
+        if(out[md->index] == NULL) out[md->index] = md->name;
+    }
+    return true;
+}
+
+void pk_member__names(py_TypeInfo* ti, py_Name* out) {
+    memset(out, 0, sizeof(py_Name) * c11__max(ti->instance_slots, 0));
+    for(; ti; ti = ti->base_ti) {
+        py_applydict(&ti->self, pk_member__names_apply, out);
+    }
+}
+
+static bool member_descriptor__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    MemberDescriptor* md = py_touserdata(argv);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    pk_sprintf(&buf, "<member '%n'>", md->name);
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+py_Type pk_member_descriptor__register() {
+    py_Type type = pk_newtype("member_descriptor", tp_object, NULL, NULL, false, true);
+    py_bindmagic(type, __repr__, member_descriptor__repr__);
+    return type;
+}
+
 // src/bindings/py_array.c
 int pk_arrayview(py_Ref self, py_TValue** p) {
     if(self->type == tp_list) {
@@ -19996,6 +23214,58 @@ bool pk_arraycontains(py_Ref self, py_Ref val) {
     return true;
 }
 
+int pk_foreach(py_Ref iterable, int (*f)(py_Ref item, void* ctx), void* ctx) {
+    // `f` receives a stack copy of each item, so it may freely overwrite py_retval()
+    py_Ref item = py_pushtmp();
+    int res = 1;
+    switch(iterable->type) {
+        case tp_list: {
+            // re-read the length since `f` may resize the list
+            for(int i = 0; res == 1 && i < py_list_len(iterable); i++) {
+                *item = *py_list_getitem(iterable, i);
+                res = f(item, ctx);
+            }
+            break;
+        }
+        case tp_tuple: {
+            int length = py_tuple_len(iterable);
+            for(int i = 0; res == 1 && i < length; i++) {
+                *item = *py_tuple_getitem(iterable, i);
+                res = f(item, ctx);
+            }
+            break;
+        }
+        case tp_range: {
+            Range r = *(Range*)py_touserdata(iterable);
+            for(py_i64 i = r.start; res == 1 && (r.step > 0 ? i < r.stop : i > r.stop);
+                i += r.step) {
+                py_newint(item, i);
+                res = f(item, ctx);
+            }
+            break;
+        }
+        default: {
+            if(!py_iter(iterable)) {
+                res = -1;
+                break;
+            }
+            py_Ref iter = py_pushtmp();
+            *iter = *py_retval();
+            while(res == 1) {
+                int next = py_next(iter);
+                if(next == -1) res = -1;
+                if(next != 1) break;
+                *item = *py_retval();
+                res = f(item, ctx);
+            }
+            py_pop();
+            break;
+        }
+    }
+    py_pop();
+    return res;
+}
+
 bool list_iterator__next__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
     list_iterator* ud = py_touserdata(argv);
@@ -20760,7 +24030,7 @@ bool pk__object_new(int argc, py_Ref argv) {
     if(!ti->is_python) {
         return TypeError("object.__new__(%t) is not safe, use %t.__new__() instead", cls, cls);
     }
-    py_newobject(py_retval(), cls, -1, 0);
+    py_newobject(py_retval(), cls, ti->instance_slots, 0);
     return true;
 }
 
@@ -20893,14 +24163,250 @@ void pk_object__register() {
 }
 // src/bindings/py_str.c
 #include <stdbool.h>
+#include <limits.h>
+
+int StrHeader__alloc_size(int size, bool ascii) {
+    int total_size = offsetof(StrHeader, u8_length) + sizeof(int) + sizeof(c11_string) + size + 1;
+    if(size >= PK_STR_INDEX_MIN_SIZE && !ascii) {
+        total_size = (total_size + 3) & ~3;
+        total_size += sizeof(int) * (size / kStrIndexStride + 1);
+    }
+    return total_size;
+}
+
+c11_string* StrHeader__str(StrHeader* self) { return (c11_string*)(&self->u8_length + 1); }
+
+// only valid for strings whose `u8_length` differs from their size, see `pk_newstrn`
+static int* StrHeader__u8_index(StrHeader* self) {
+    c11_string* s = StrHeader__str(self);
+    if(s->size < PK_STR_INDEX_MIN_SIZE) return NULL;
+    uintptr_t p = (uintptr_t)(s->data + s->size + 1);
+    return (int*)((p + 3) & ~(uintptr_t)3);
+}
+
+static int StrHeader__u8_length(StrHeader* self) {
+    if(self->u8_length >= 0) return self->u8_length;
+    c11_string* s = StrHeader__str(self);
+    int* index = StrHeader__u8_index(self);
+    if(index == NULL) {
+        self->u8_length = c11_sv__u8_length(c11_string__sv(s));
+        return self->u8_length;
+    }
+    int n = 0;
+    for(int i = 0; i < s->size; i++) {
+        if((s->data[i] & 0xC0) == 0x80) continue;
+        if(n % kStrIndexStride == 0) index[n / kStrIndexStride] = i;
+        n++;
+    }
+    self->u8_length = n;
+    return n;
+}
 
 c11_string* pk_tostr(py_Ref self) {
     assert(self->type == tp_str);
-    if(!self->is_ptr) {
-        return (c11_string*)(&self->extra);
+    if(!self->is_ptr) return (c11_string*)(&self->extra);
+    uint64_t* hash = PyObject__userdata(self->_obj);
+    if(self->_obj->slots == 0) return StrHeader__str((StrHeader*)hash);
+    // a substring view is flattened on first use as `c11_string`, which must be null-terminated
+    int* view = (int*)(hash + 1);
+    if(view[0] < 0) pk_flattenstr(self->_obj);
+    py_Ref parent = PyObject__slots(self->_obj);
+    c11_string* res = pk_tostr(parent);
+    if(view[0] != 0 || view[1] != res->size) {
+        py_TValue tmp;
+        py_newstrv(&tmp, (c11_sv){res->data + view[0], view[1]});
+        *parent = tmp;
+        view[0] = 0;
+        res = pk_tostr(parent);
+    }
+    return res;
+}
+
+uint64_t pk_strhash(py_Ref self) {
+    assert(self->type == tp_str);
+    if(!self->is_ptr) return c11_sv__hash(c11_string__sv((c11_string*)(&self->extra)));
+    uint64_t* hash = PyObject__userdata(self->_obj);
+    if(*hash == 0) *hash = c11_sv__hash(py_tosv(self));
+    return *hash;
+}
+
+void pk_newsubstr(py_OutRef out, py_Ref parent, c11_sv sv) {
+    assert(parent->type == tp_str);
+    if(sv.size < PK_STR_VIEW_MIN_SIZE || PK_STR_VIEW_MIN_SIZE <= 0 || !parent->is_ptr) {
+        py_newstrv(out, sv);
+        return;
+    }
+    // always reference the root string, so views never form chains
+    py_TValue root = *parent;
+    if(root._obj->slots > 0) {
+        // `sv` came from `py_tosv(parent)`, so a rope has already been flattened
+        assert(((int*)((uint64_t*)PyObject__userdata(root._obj) + 1))[0] >= 0);
+        root = *PyObject__slots(root._obj);
+    }
+    c11_sv whole = py_tosv(&root);
+    if(whole.size == sv.size) {
+        *out = root;
+        return;
+    }
+    // a view keeps its whole root alive, so only share when the slice is a large part of it
+    if(sv.size < whole.size / 8) {
+        py_newstrv(out, sv);
+        return;
+    }
+    int offset = (int)(sv.data - whole.data);
+    assert(offset >= 0 && offset + sv.size <= whole.size);
+    PyObject* obj = ManagedHeap__gcnew(&pk_current_vm->heap,
+                                       tp_str,
+                                       1,
+                                       sizeof(uint64_t) + sizeof(int) * 2);
+    uint64_t* hash = PyObject__userdata(obj);
+    *hash = 0;
+    int* view = (int*)(hash + 1);
+    view[0] = offset;
+    view[1] = sv.size;
+    *PyObject__slots(obj) = root;
+    out->type = tp_str;
+    out->is_ptr = true;
+    out->_obj = obj;
+}
+
+void pk_newconcat(py_OutRef out, py_Ref lhs, py_Ref rhs) {
+    assert(lhs->type == tp_str && rhs->type == tp_str);
+    c11_sv b = py_tosv(rhs);
+    int a_size;
+    if(lhs->is_ptr && lhs->_obj->slots > 0) {
+        a_size = ((int*)((uint64_t*)PyObject__userdata(lhs->_obj) + 1))[1];
     } else {
-        return PyObject__userdata(self->_obj);
+        a_size = py_tosv(lhs).size;
+    }
+    if(PK_STR_ROPE_MIN_SIZE <= 0 || a_size + b.size < PK_STR_ROPE_MIN_SIZE || b.size == 0) {
+        c11_sv a = py_tosv(lhs);
+        bool ascii = a.size + b.size >= PK_STR_INDEX_MIN_SIZE && c11_sv__is_ascii(a) &&
+                     c11_sv__is_ascii(b);
+        char* p = pk_newstrn(out, a.size + b.size, ascii);
+        memcpy(p, a.data, a.size);
+        memcpy(p + a.size, b.data, b.size);
+        return;
+    }
+    // rope: | hash | int -1 | int size |, slot 0 is `lhs` and slot 1 is `rhs`
+    // `rhs` is always flat, so ropes only grow along slot 0 and flattening needs no recursion
+    py_TValue left = *lhs;
+    py_TValue right = *rhs;
+    if(lhs->is_ptr && lhs->_obj->slots == 2 &&
+       ((int*)((uint64_t*)PyObject__userdata(lhs->_obj) + 1))[0] < 0) {
+        // merge small pieces into the previous one so each node holds a sizable chunk
+        py_TValue* lhs_slots = PyObject__slots(lhs->_obj);
+        c11_sv last = py_tosv(&lhs_slots[1]);
+        if(last.size + b.size < PK_STR_ROPE_MIN_SIZE) {
+            left = lhs_slots[0];
+            char* p = py_newstrn(&right, last.size + b.size);
+            memcpy(p, last.data, last.size);
+            memcpy(p + last.size, b.data, b.size);
+        }
+    }
+    PyObject* obj = ManagedHeap__gcnew(&pk_current_vm->heap,
+                                       tp_str,
+                                       2,
+                                       sizeof(uint64_t) + sizeof(int) * 2);
+    uint64_t* hash = PyObject__userdata(obj);
+    *hash = 0;
+    int* view = (int*)(hash + 1);
+    view[0] = -1;
+    view[1] = a_size + b.size;
+    py_TValue* slots = PyObject__slots(obj);
+    slots[0] = left;
+    slots[1] = right;
+    out->type = tp_str;
+    out->is_ptr = true;
+    out->_obj = obj;
+}
+
+static bool pk_ropeisascii(PyObject* obj) {
+    while(true) {
+        py_TValue* slots = PyObject__slots(obj);
+        if(!c11_sv__is_ascii(py_tosv(&slots[1]))) return false;
+        py_Ref left = &slots[0];
+        if(left->is_ptr && left->_obj->slots > 0 &&
+           ((int*)((uint64_t*)PyObject__userdata(left->_obj) + 1))[0] < 0) {
+            obj = left->_obj;
+            continue;
+        }
+        return c11_sv__is_ascii(py_tosv(left));
+    }
+}
+
+void pk_flattenstr(PyObject* obj) {
+    int* view = (int*)((uint64_t*)PyObject__userdata(obj) + 1);
+    assert(view[0] < 0);
+    py_TValue res;
+    char* buf = pk_newstrn(&res, view[1], pk_ropeisascii(obj));
+    char* p = buf + view[1];
+    PyObject* node = obj;
+    while(true) {
+        py_TValue* slots = PyObject__slots(node);
+        c11_sv right = py_tosv(&slots[1]);
+        p -= right.size;
+        memcpy(p, right.data, right.size);
+        py_Ref left = &slots[0];
+        if(left->is_ptr && left->_obj->slots > 0) {
+            int* left_view = (int*)((uint64_t*)PyObject__userdata(left->_obj) + 1);
+            if(left_view[0] < 0) {
+                node = left->_obj;
+                continue;
+            }
+        }
+        c11_sv rest = py_tosv(left);
+        p -= rest.size;
+        memcpy(p, rest.data, rest.size);
+        break;
+    }
+    assert(p == buf);
+    // the rope becomes a view of the whole flattened string
+    py_TValue* slots = PyObject__slots(obj);
+    slots[0] = res;
+    py_newnil(&slots[1]);
+    view[0] = 0;
+}
+
+// Returns the header of the heap string holding exactly the code points of `self`, or NULL.
+// Large partial views of non-ASCII strings are flattened, so call this before `py_tosv`.
+static StrHeader* str__header(py_Ref self, bool* ascii) {
+    *ascii = false;
+    if(!self->is_ptr) return NULL;
+    PyObject* obj = self->_obj;
+    if(obj->slots == 0) return PyObject__userdata(obj);
+    c11_sv sv = py_tosv(self);
+    py_Ref parent = PyObject__slots(obj);
+    if(!parent->is_ptr) return NULL;
+    StrHeader* header = PyObject__userdata(parent->_obj);
+    c11_string* s = StrHeader__str(header);
+    if(sv.size == s->size) return header;
+    if(StrHeader__u8_length(header) == s->size) {
+        *ascii = true;
+        return NULL;
     }
+    if(sv.size < PK_STR_INDEX_MIN_SIZE) return NULL;
+    pk_tostr(self);
+    return PyObject__userdata(parent->_obj);
+}
+
+static int str__u8_length(StrHeader* header, bool ascii, c11_sv sv) {
+    if(ascii) return sv.size;
+    if(header) return StrHeader__u8_length(header);
+    return c11_sv__u8_length(sv);
+}
+
+// byte offset of the `i`-th code point, where `0 <= i <= str__u8_length(...)`
+static int str__u8_offset(StrHeader* header, bool ascii, c11_sv sv, int i) {
+    if(ascii) return i;
+    if(header == NULL) return c11__unicode_index_to_byte(sv.data, i);
+    int length = StrHeader__u8_length(header);
+    if(length == sv.size) return i;
+    if(i == length) return sv.size;
+    int* index = StrHeader__u8_index(header);
+    if(index == NULL) return c11__unicode_index_to_byte(sv.data, i);
+    int base = index[i / kStrIndexStride];
+    return base + c11__unicode_index_to_byte(sv.data + base, i % kStrIndexStride);
 }
 
 ////////////////////////////////
@@ -20916,21 +24422,23 @@ static bool str__new__(int argc, py_Ref argv) {
 
 static bool str__hash__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
-    uint64_t res = c11_sv__hash(py_tosv(argv));
+    uint64_t res = pk_strhash(argv);
     py_newint(py_retval(), (py_i64)res);
     return true;
 }
 
 static bool str__len__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
-    c11_string* self = pk_tostr(&argv[0]);
-    py_newint(py_retval(), c11_sv__u8_length((c11_sv){self->data, self->size}));
+    bool ascii;
+    StrHeader* header = str__header(&argv[0], &ascii);
+    c11_sv self = py_tosv(&argv[0]);
+    py_newint(py_retval(), str__u8_length(header, ascii, self));
     return true;
 }
 
 static bool str__mod__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     // %s
     // %d %i
     // %f
@@ -20947,8 +24455,8 @@ static bool str__mod__(int argc, py_Ref argv) {
     }
 
     int arg_index = 0;
-    const char* p = self->data;
-    const char* p_end = self->data + self->size;
+    const char* p = self.data;
+    const char* p_end = self.data + self.size;
 
     c11_sbuf buf;
     c11_sbuf__ctor(&buf);
@@ -21040,21 +24548,17 @@ static bool str__mod__(int argc, py_Ref argv) {
 
 static bool str__add__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
     if(py_arg(1)->type != tp_str) {
         py_newnotimplemented(py_retval());
     } else {
-        c11_string* other = pk_tostr(&argv[1]);
-        char* p = py_newstrn(py_retval(), self->size + other->size);
-        memcpy(p, self->data, self->size);
-        memcpy(p + self->size, other->data, other->size);
+        pk_newconcat(py_retval(), &argv[0], &argv[1]);
     }
     return true;
 }
 
 static bool str__mul__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     if(py_arg(1)->type != tp_int) {
         py_newnotimplemented(py_retval());
     } else {
@@ -21062,9 +24566,14 @@ static bool str__mul__(int argc, py_Ref argv) {
         if(n <= 0) {
             py_newstr(py_retval(), "");
         } else {
-            char* p = py_newstrn(py_retval(), self->size * n);
+            if(self.size > 0 && n > INT_MAX / self.size) {
+                return MemoryError("repeated string is too long");
+            }
+            if(!ManagedHeap__reserve(&pk_current_vm->heap, (size_t)self.size * n)) return false;
+            bool ascii = c11_sv__is_ascii(self);
+            char* p = pk_newstrn(py_retval(), self.size * n, ascii);
             for(int i = 0; i < n; i++) {
-                memcpy(p + i * self->size, self->data, self->size);
+                memcpy(p + i * self.size, self.data, self.size);
             }
         }
     }
@@ -21075,13 +24584,12 @@ static bool str__rmul__(int argc, py_Ref argv) { return str__mul__(argc, argv);
 
 static bool str__contains__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     if(py_arg(1)->type != tp_str) {
         py_newnotimplemented(py_retval());
     } else {
-        c11_string* other = pk_tostr(&argv[1]);
-        const char* p = strstr(self->data, other->data);
-        py_newbool(py_retval(), p != NULL);
+        c11_sv other = py_tosv(&argv[1]);
+        py_newbool(py_retval(), c11_sv__index2(self, other, 0) != -1);
     }
     return true;
 }
@@ -21111,21 +24619,35 @@ static bool str__iter__(int argc, py_Ref argv) {
 
 static bool str__getitem__(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_sv self = c11_string__sv(pk_tostr(&argv[0]));
+    bool ascii;
+    StrHeader* header = str__header(&argv[0], &ascii);
+    c11_sv self = py_tosv(&argv[0]);
+    int length = str__u8_length(header, ascii, self);
     py_Ref _1 = py_arg(1);
     if(_1->type == tp_int) {
         int index = py_toint(py_arg(1));
-        if(!pk__normalize_index(&index, self.size)) return false;
-        c11_sv res = c11_sv__u8_getitem(self, index);
-        py_newstrv(py_retval(), res);
+        if(!pk__normalize_index(&index, length)) return false;
+        int begin = str__u8_offset(header, ascii, self, index);
+        py_newstrv(py_retval(), (c11_sv){self.data + begin, c11__u8_header(self.data[begin], false)});
         return true;
     } else if(_1->type == tp_slice) {
         int start, stop, step;
-        bool ok = pk__parse_int_slice(_1, c11_sv__u8_length(self), &start, &stop, &step);
+        bool ok = pk__parse_int_slice(_1, length, &start, &stop, &step);
         if(!ok) return false;
-        c11_string* res = c11_sv__u8_slice(self, start, stop, step);
-        py_newstrv(py_retval(), (c11_sv){res->data, res->size});
-        c11_string__delete(res);
+        if(step == 1) {
+            // contiguous slices may share the parent's buffer
+            int begin = str__u8_offset(header, ascii, self, start);
+            int end = stop > start ? str__u8_offset(header, ascii, self, stop) : begin;
+            pk_newsubstr(py_retval(), &argv[0], (c11_sv){self.data + begin, end - begin});
+            return true;
+        }
+        c11_sbuf buf;
+        c11_sbuf__ctor(&buf);
+        for(int i = start; step > 0 ? i < stop : i > stop; i += step) {
+            int begin = str__u8_offset(header, ascii, self, i);
+            c11_sbuf__write_cstrn(&buf, self.data + begin, c11__u8_header(self.data[begin], false));
+        }
+        c11_sbuf__py_submit(&buf, py_retval());
         return true;
     } else {
         return TypeError("string indices must be integers");
@@ -21135,12 +24657,12 @@ static bool str__getitem__(int argc, py_Ref argv) {
 #define DEF_STR_CMP_OP(op, __f, __cond)                                                            \
     static bool str##op(int argc, py_Ref argv) {                                                   \
         PY_CHECK_ARGC(2);                                                                          \
-        c11_string* self = pk_tostr(&argv[0]);                                                     \
+        c11_sv self = py_tosv(&argv[0]);                                                           \
         if(py_arg(1)->type != tp_str) {                                                            \
             py_newnotimplemented(py_retval());                                                     \
         } else {                                                                                   \
-            c11_string* other = pk_tostr(&argv[1]);                                                \
-            int res = __f(c11_string__sv(self), c11_string__sv(other));                            \
+            c11_sv other = py_tosv(&argv[1]);                                                      \
+            int res = __f(self, other);                                                            \
             py_newbool(py_retval(), __cond);                                                       \
         }                                                                                          \
         return true;                                                                               \
@@ -21157,10 +24679,10 @@ DEF_STR_CMP_OP(__ge__, c11_sv__cmp, res >= 0)
 
 static bool str_lower(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
-    c11_string* self = pk_tostr(&argv[0]);
-    char* p = py_newstrn(py_retval(), self->size);
-    for(int i = 0; i < self->size; i++) {
-        char c = self->data[i];
+    c11_sv self = py_tosv(&argv[0]);
+    char* p = pk_newstrn(py_retval(), self.size, c11_sv__is_ascii(self));
+    for(int i = 0; i < self.size; i++) {
+        char c = self.data[i];
         p[i] = c >= 'A' && c <= 'Z' ? c + 32 : c;
     }
     return true;
@@ -21168,10 +24690,10 @@ static bool str_lower(int argc, py_Ref argv) {
 
 static bool str_upper(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
-    c11_string* self = pk_tostr(&argv[0]);
-    char* p = py_newstrn(py_retval(), self->size);
-    for(int i = 0; i < self->size; i++) {
-        char c = self->data[i];
+    c11_sv self = py_tosv(&argv[0]);
+    char* p = pk_newstrn(py_retval(), self.size, c11_sv__is_ascii(self));
+    for(int i = 0; i < self.size; i++) {
+        char c = self.data[i];
         p[i] = c >= 'a' && c <= 'z' ? c - 32 : c;
     }
     return true;
@@ -21179,25 +24701,25 @@ static bool str_upper(int argc, py_Ref argv) {
 
 static bool str_startswith(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     PY_CHECK_ARG_TYPE(1, tp_str);
-    c11_string* other = pk_tostr(&argv[1]);
-    py_newbool(py_retval(), c11_sv__startswith(c11_string__sv(self), c11_string__sv(other)));
+    c11_sv other = py_tosv(&argv[1]);
+    py_newbool(py_retval(), c11_sv__startswith(self, other));
     return true;
 }
 
 static bool str_endswith(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     PY_CHECK_ARG_TYPE(1, tp_str);
-    c11_string* other = pk_tostr(&argv[1]);
-    py_newbool(py_retval(), c11_sv__endswith(c11_string__sv(self), c11_string__sv(other)));
+    c11_sv other = py_tosv(&argv[1]);
+    py_newbool(py_retval(), c11_sv__endswith(self, other));
     return true;
 }
 
 static bool str_join(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_sv self = c11_string__sv(pk_tostr(argv));
+    c11_sv self = py_tosv(argv);
 
     if(!py_iter(py_arg(1))) return false;
     py_push(py_retval());  // iter
@@ -21219,8 +24741,7 @@ static bool str_join(int argc, py_Ref argv) {
             c11_sbuf__dtor(&buf);
             return false;
         }
-        c11_string* item = pk_tostr(py_retval());
-        c11_sbuf__write_cstrn(&buf, item->data, item->size);
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
         first = false;
     }
 
@@ -21231,20 +24752,23 @@ static bool str_join(int argc, py_Ref argv) {
 
 static bool str_replace(int argc, py_Ref argv) {
     PY_CHECK_ARGC(3);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     PY_CHECK_ARG_TYPE(1, tp_str);
     PY_CHECK_ARG_TYPE(2, tp_str);
-    c11_string* old = pk_tostr(&argv[1]);
-    c11_string* new_ = pk_tostr(&argv[2]);
-    c11_string* res =
-        c11_sv__replace2(c11_string__sv(self), c11_string__sv(old), c11_string__sv(new_));
+    c11_sv old = py_tosv(&argv[1]);
+    c11_sv new_ = py_tosv(&argv[2]);
+    if(old.size > 0 && c11_sv__index2(self, old, 0) == -1) {
+        *py_retval() = argv[0];
+        return true;
+    }
+    c11_string* res = c11_sv__replace2(self, old, new_);
     py_newstrv(py_retval(), (c11_sv){res->data, res->size});
     c11_string__delete(res);
     return true;
 }
 
 static bool str_split(int argc, py_Ref argv) {
-    c11_sv self = c11_string__sv(pk_tostr(&argv[0]));
+    c11_sv self = py_tosv(&argv[0]);
     c11_vector res;
     bool discard_empty = false;
     if(argc > 2) return TypeError("split() takes at most 2 arguments");
@@ -21256,7 +24780,7 @@ static bool str_split(int argc, py_Ref argv) {
     if(argc == 2) {
         // sep = argv[1]
         if(!py_checkstr(&argv[1])) return false;
-        c11_sv sep = c11_string__sv(pk_tostr(&argv[1]));
+        c11_sv sep = py_tosv(&argv[1]);
         if(sep.size == 0) return ValueError("empty separator");
         res = c11_sv__split2(self, sep);
     }
@@ -21264,7 +24788,7 @@ static bool str_split(int argc, py_Ref argv) {
     for(int i = 0; i < res.length; i++) {
         c11_sv part = c11__getitem(c11_sv, &res, i);
         if(discard_empty && part.size == 0) continue;
-        py_newstrv(py_list_emplace(py_retval()), part);
+        pk_newsubstr(py_list_emplace(py_retval()), &argv[0], part);
     }
     c11_vector__dtor(&res);
     return true;
@@ -21272,27 +24796,27 @@ static bool str_split(int argc, py_Ref argv) {
 
 static bool str_count(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     PY_CHECK_ARG_TYPE(1, tp_str);
-    c11_string* sub = pk_tostr(&argv[1]);
-    int res = c11_sv__count(c11_string__sv(self), c11_string__sv(sub));
+    c11_sv sub = py_tosv(&argv[1]);
+    int res = c11_sv__count(self, sub);
     py_newint(py_retval(), res);
     return true;
 }
 
 static bool str__strip_impl(bool left, bool right, int argc, py_Ref argv) {
-    c11_sv self = c11_string__sv(pk_tostr(&argv[0]));
+    c11_sv self = py_tosv(&argv[0]);
     c11_sv chars;
     if(argc == 1) {
         chars = (c11_sv){" \t\n\r", 4};
     } else if(argc == 2) {
         if(!py_checkstr(&argv[1])) return false;
-        chars = c11_string__sv(pk_tostr(&argv[1]));
+        chars = py_tosv(&argv[1]);
     } else {
         return TypeError("strip() takes at most 2 arguments");
     }
     c11_sv res = c11_sv__strip(self, chars, left, right);
-    py_newstrv(py_retval(), res);
+    pk_newsubstr(py_retval(), &argv[0], res);
     return true;
 }
 
@@ -21304,7 +24828,7 @@ static bool str_rstrip(int argc, py_Ref argv) { return str__strip_impl(false, tr
 
 static bool str_zfill(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    c11_sv self = c11_string__sv(pk_tostr(&argv[0]));
+    c11_sv self = py_tosv(&argv[0]);
     PY_CHECK_ARG_TYPE(1, tp_int);
     int width = py_toint(py_arg(1));
     int delta = width - c11_sv__u8_length(self);
@@ -21329,12 +24853,12 @@ static bool str__widthjust_impl(bool left, int argc, py_Ref argv) {
         pad = ' ';
     } else {
         if(!py_checkstr(&argv[2])) return false;
-        c11_string* padstr = pk_tostr(&argv[2]);
-        if(padstr->size != 1)
+        c11_sv padstr = py_tosv(&argv[2]);
+        if(padstr.size != 1)
             return TypeError("The fill character must be exactly one character long");
-        pad = padstr->data[0];
+        pad = padstr.data[0];
     }
-    c11_sv self = c11_string__sv(pk_tostr(&argv[0]));
+    c11_sv self = py_tosv(&argv[0]);
     PY_CHECK_ARG_TYPE(1, tp_int);
     int width = py_toint(py_arg(1));
     if(width <= self.size) {
@@ -21364,17 +24888,17 @@ static bool str_rjust(int argc, py_Ref argv) { return str__widthjust_impl(false,
 
 static bool str_find(int argc, py_Ref argv) {
     if(argc > 3) return TypeError("find() takes at most 3 arguments");
-    c11_string* self = pk_tostr(&argv[0]);
+    c11_sv self = py_tosv(&argv[0]);
     int start = 0;
     if(argc == 3) {
         PY_CHECK_ARG_TYPE(2, tp_int);
         start = py_toint(py_arg(2));
-        if(start < 0) start += c11_sv__u8_length(c11_string__sv(self));
+        if(start < 0) start += c11_sv__u8_length(self);
         if(start < 0) start = 0;
     }
     PY_CHECK_ARG_TYPE(1, tp_str);
-    c11_string* sub = pk_tostr(&argv[1]);
-    int res = c11_sv__index2(c11_string__sv(self), c11_string__sv(sub), start);
+    c11_sv sub = py_tosv(&argv[1]);
+    int res = c11_sv__index2(self, sub, start);
     py_newint(py_retval(), res);
     return true;
 }
@@ -21922,7 +25446,7 @@ static bool pkpy_memory_usage(int argc, py_Ref argv) {
     PY_CHECK_ARGC(0);
     ManagedHeap* heap = &pk_current_vm->heap;
     py_i64 size = MultiPool__total_allocated_bytes(&heap->small_objects);
-    size += heap->large_total_size;
+    size += heap->large_total_size + heap->large_cached_size;
     size += sizeof(VM);
     py_newint(py_retval(), size);
     return true;
@@ -21948,6 +25472,10 @@ static bool pkpy_memory_usage_info(int argc, py_Ref argv) {
     c11_sbuf__write_cstr(&buf, "Total: ~");
     c11_sbuf__write_f64(&buf, large_total_size_mb, 2);
     c11_sbuf__write_cstr(&buf, " MB\n");
+    double large_cached_size_mb = (size_t)(heap->large_cached_size / 1024) / 1024.0;
+    c11_sbuf__write_cstr(&buf, "Cached: ~");
+    c11_sbuf__write_f64(&buf, large_cached_size_mb, 2);
+    c11_sbuf__write_cstr(&buf, " MB\n");
     c11_sbuf__write_cstr(&buf, "== heap.gc ==\n");
     pk_sprintf(&buf, "gc_counter=%d\n", heap->gc_counter);
     pk_sprintf(&buf, "gc_threshold=%d", heap->gc_threshold);
@@ -21957,6 +25485,19 @@ static bool pkpy_memory_usage_info(int argc, py_Ref argv) {
     return true;
 }
 
+static bool pkpy_set_memory_limit(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_i64 limit = 0;
+    if(!py_isnone(argv)) {
+        PY_CHECK_ARG_TYPE(0, tp_int);
+        limit = py_toint(argv);
+        if(limit < 0) return ValueError("memory limit must be non-negative");
+    }
+    py_setmemorylimit((size_t)limit);
+    py_newnone(py_retval());
+    return true;
+}
+
 static bool pkpy_currentvm(int argc, py_Ref argv) {
     PY_CHECK_ARGC(0);
     py_newint(py_retval(), py_currentvm());
@@ -22423,6 +25964,7 @@ void pk__add_module_pkpy() {
 
     py_bindfunc(mod, "memory_usage", pkpy_memory_usage);
     py_bindfunc(mod, "memory_usage_info", pkpy_memory_usage_info);
+    py_bindfunc(mod, "set_memory_limit", pkpy_set_memory_limit);
 
     py_bindfunc(mod, "currentvm", pkpy_currentvm);
 
@@ -22446,7 +25988,13 @@ void pk__add_module_pkpy() {
     pkpy_configmacros_add(configmacros, "PK_ENABLE_THREADS", PK_ENABLE_THREADS);
     pkpy_configmacros_add(configmacros, "PK_ENABLE_DETERMINISM", PK_ENABLE_DETERMINISM);
     pkpy_configmacros_add(configmacros, "PK_ENABLE_WATCHDOG", PK_ENABLE_WATCHDOG);
+    pkpy_configmacros_add(configmacros, "PK_ENABLE_COMPACT_TVALUE", PK_ENABLE_COMPACT_TVALUE);
+    pkpy_configmacros_add(configmacros, "PK_ENABLE_SWISS_DICT", PK_ENABLE_SWISS_DICT);
     pkpy_configmacros_add(configmacros, "PK_GC_MIN_THRESHOLD", PK_GC_MIN_THRESHOLD);
+    pkpy_configmacros_add(configmacros, "PK_GC_RETAINED_ARENAS", PK_GC_RETAINED_ARENAS);
+    pkpy_configmacros_add(configmacros, "PK_STR_VIEW_MIN_SIZE", PK_STR_VIEW_MIN_SIZE);
+    pkpy_configmacros_add(configmacros, "PK_STR_ROPE_MIN_SIZE", PK_STR_ROPE_MIN_SIZE);
+    pkpy_configmacros_add(configmacros, "PK_STR_INDEX_MIN_SIZE", PK_STR_INDEX_MIN_SIZE);
     pkpy_configmacros_add(configmacros, "PK_VM_STACK_SIZE", PK_VM_STACK_SIZE);
 }
 
@@ -23112,6 +26660,390 @@ static bool builtins_round(int argc, py_Ref argv) {
     return pk_callmagic(__round__, argc, argv);
 }
 
+static int builtins_any__visit(py_Ref item, void* ctx) {
+    int res = py_bool(item);
+    if(res == -1) return -1;
+    return !res;  // stop at the first true item
+}
+
+static bool builtins_any(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int res = pk_foreach(argv, builtins_any__visit, NULL);
+    if(res == -1) return false;
+    py_newbool(py_retval(), res == 0);
+    return true;
+}
+
+static int builtins_all__visit(py_Ref item, void* ctx) { return py_bool(item); }
+
+static bool builtins_all(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int res = pk_foreach(argv, builtins_all__visit, NULL);
+    if(res == -1) return false;
+    py_newbool(py_retval(), res == 1);
+    return true;
+}
+
+static int builtins_sum__visit(py_Ref item, void* ctx) {
+    py_Ref acc = ctx;
+    if(acc->type == tp_int && item->type == tp_int) {
+        acc->_i64 += item->_i64;
+        return 1;
+    }
+    if(acc->type == tp_float && (item->type == tp_float || item->type == tp_int)) {
+        acc->_f64 += item->type == tp_float ? item->_f64 : (py_f64)item->_i64;
+        return 1;
+    }
+    if(acc->type == tp_int && item->type == tp_float) {
+        py_newfloat(acc, (py_f64)acc->_i64 + item->_f64);
+        return 1;
+    }
+    if(!py_binaryadd(acc, item)) return -1;
+    *acc = *py_retval();
+    return 1;
+}
+
+// sum(iterable, start=0)
+static bool builtins_sum(int argc, py_Ref argv) {
+    py_Ref acc = py_pushtmp();
+    *acc = *py_arg(1);
+    bool ok = pk_foreach(py_arg(0), builtins_sum__visit, acc) != -1;
+    if(ok) py_assign(py_retval(), acc);
+    py_pop();
+    return ok;
+}
+
+typedef struct MinMaxContext {
+    py_Ref key;  // NULL if no key function
+    py_Name op;  // a candidate replaces the result if `candidate op result`
+    py_Name rop;
+    bool is_empty;
+    py_Ref res;  // stack slots for the result, its key, and the key of the candidate
+    py_Ref res_key;
+    py_Ref item_key;
+} MinMaxContext;
+
+static int builtins_minmax__visit(py_Ref item, void* ctx_) {
+    MinMaxContext* ctx = ctx_;
+    py_Ref item_key = item;
+    if(ctx->key) {
+        if(!py_call(ctx->key, 1, item)) return -1;
+        *ctx->item_key = *py_retval();
+        item_key = ctx->item_key;
+    }
+    if(ctx->is_empty) {
+        ctx->is_empty = false;
+    } else {
+        py_Ref lhs = item_key, rhs = ctx->res_key;
+        int res;
+        if(lhs->type == tp_int && rhs->type == tp_int) {
+            res = ctx->op == __lt__ ? lhs->_i64 < rhs->_i64 : lhs->_i64 > rhs->_i64;
+        } else if(lhs->type == tp_float && rhs->type == tp_float) {
+            res = ctx->op == __lt__ ? lhs->_f64 < rhs->_f64 : lhs->_f64 > rhs->_f64;
+        } else {
+            if(!py_binaryop(lhs, rhs, ctx->op, ctx->rop)) return -1;
+            res = py_bool(py_retval());
+            if(res == -1) return -1;
+        }
+        if(!res) return 1;
+    }
+    *ctx->res = *item;
+    *ctx->res_key = *item_key;
+    return 1;
+}
+
+static bool builtins_minmax(const char* name, py_Name op, py_Name rop, py_Ref argv) {
+    // min(*args, key=None) / max(*args, key=None)
+    py_Ref args = py_arg(0);
+    int length = py_tuple_len(args);
+    if(length == 0) return TypeError("%s expected at least 1 argument, got 0", name);
+    py_Ref iterable = length == 1 ? py_tuple_getitem(args, 0) : args;
+    MinMaxContext ctx = {
+        .key = py_isnone(py_arg(1)) ? NULL : py_arg(1),
+        .op = op,
+        .rop = rop,
+        .is_empty = true,
+    };
+    ctx.res = py_pushtmp();
+    ctx.res_key = py_pushtmp();
+    ctx.item_key = py_pushtmp();
+    bool ok = pk_foreach(iterable, builtins_minmax__visit, &ctx) != -1;
+    if(ok && ctx.is_empty) ok = ValueError("%s() arg is an empty sequence", name);
+    if(ok) py_assign(py_retval(), ctx.res);
+    py_shrink(3);
+    return ok;
+}
+
+static bool builtins_min(int argc, py_Ref argv) {
+    return builtins_minmax("min", __lt__, __gt__, argv);
+}
+
+static bool builtins_max(int argc, py_Ref argv) {
+    return builtins_minmax("max", __gt__, __lt__, argv);
+}
+
+// sorted(iterable, key=None, reverse=False)
+static bool builtins_sorted(int argc, py_Ref argv) {
+    py_Ref args = py_pushtmp();
+    py_pushtmp();
+    py_pushtmp();
+    // [list, key, reverse]
+    if(!py_tpcall(tp_list, 1, py_arg(0))) {
+        py_shrink(3);
+        return false;
+    }
+    args[0] = *py_retval();
+    args[1] = *py_arg(1);
+    args[2] = *py_arg(2);
+    bool ok = list_sort(3, args);
+    if(ok) py_assign(py_retval(), args);
+    py_shrink(3);
+    return ok;
+}
+
+// map(function, *iterables)
+static bool map__new__(int argc, py_Ref argv) {
+    if(argc < 3) return TypeError("map() must have at least two arguments");
+    int n = argc - 2;
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_map, 1 + n, 0);
+    py_setslot(res, 0, py_arg(1));
+    for(int i = 0; i < n; i++) {
+        if(!py_iter(py_arg(2 + i))) {
+            py_pop();
+            return false;
+        }
+        py_setslot(res, 1 + i, py_retval());
+    }
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+bool map__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int n = argv->_obj->slots - 1;
+    py_push(py_getslot(argv, 0));
+    py_pushnil();
+    for(int i = 0; i < n; i++) {
+        int res = py_next(py_getslot(argv, 1 + i));
+        if(res != 1) {
+            py_shrink(2 + i);
+            return res == 0 ? StopIteration() : false;
+        }
+        py_push(py_retval());
+    }
+    return py_vectorcall(n, 0);
+}
+
+// filter(function, iterable)
+static bool filter__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_filter, 2, 0);
+    py_setslot(res, 0, py_arg(1));
+    bool ok = py_iter(py_arg(2));
+    if(ok) {
+        py_setslot(res, 1, py_retval());
+        py_assign(py_retval(), res);
+    }
+    py_pop();
+    return ok;
+}
+
+bool filter__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref f = py_getslot(argv, 0);
+    py_Ref item = py_pushtmp();
+    while(true) {
+        int res = py_next(py_getslot(argv, 1));
+        if(res != 1) {
+            py_pop();
+            return res == 0 ? StopIteration() : false;
+        }
+        *item = *py_retval();
+        if(py_isnone(f)) {
+            res = py_bool(item);
+        } else {
+            res = py_call(f, 1, item) ? py_bool(py_retval()) : -1;
+        }
+        if(res == -1) {
+            py_pop();
+            return false;
+        }
+        if(res) break;
+    }
+    py_assign(py_retval(), item);
+    py_pop();
+    return true;
+}
+
+// zip(*iterables)
+static bool zip__new__(int argc, py_Ref argv) {
+    int n = argc - 1;
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_zip, n, 0);
+    for(int i = 0; i < n; i++) {
+        if(!py_iter(py_arg(1 + i))) {
+            py_pop();
+            return false;
+        }
+        py_setslot(res, i, py_retval());
+    }
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+bool zip__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int n = argv->_obj->slots;
+    if(n == 0) return StopIteration();
+    py_Ref res = py_pushtmp();
+    py_Ref p = py_newtuple(res, n);
+    for(int i = 0; i < n; i++) {
+        int ok = py_next(py_getslot(argv, i));
+        if(ok != 1) {
+            py_pop();
+            return ok == 0 ? StopIteration() : false;
+        }
+        p[i] = *py_retval();
+    }
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+// __new__(cls, iterable, start=0)
+static bool enumerate__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARG_TYPE(2, tp_int);
+    py_Ref res = py_pushtmp();
+    py_i64* ud = py_newobject(res, tp_enumerate, 1, sizeof(py_i64));
+    *ud = py_toint(py_arg(2));
+    bool ok = py_iter(py_arg(1));
+    if(ok) {
+        py_setslot(res, 0, py_retval());
+        py_assign(py_retval(), res);
+    }
+    py_pop();
+    return ok;
+}
+
+bool enumerate__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int res = py_next(py_getslot(argv, 0));
+    if(res != 1) return res == 0 ? StopIteration() : false;
+    py_Ref item = py_pushtmp();
+    *item = *py_retval();
+    py_i64* ud = py_touserdata(argv);
+    py_Ref p = py_newtuple(py_retval(), 2);
+    py_newint(p, (*ud)++);
+    p[1] = *item;
+    py_pop();
+    return true;
+}
+
+// reversed(sequence)
+static bool reversed__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Ref seq = py_arg(1);
+    if(py_istype(seq, tp_range)) {
+        // iterate the mirrored range
+        Range r = *(Range*)py_touserdata(seq);
+        RangeIterator* ud =
+            py_newobject(py_retval(), tp_range_iterator, 0, sizeof(RangeIterator));
+        py_i64 length = 0;
+        if(r.step > 0 && r.start < r.stop) length = (r.stop - r.start - 1) / r.step + 1;
+        if(r.step < 0 && r.start > r.stop) length = (r.start - r.stop - 1) / -r.step + 1;
+        ud->range.start = r.start + (length - 1) * r.step;
+        ud->range.stop = r.start - r.step;
+        ud->range.step = -r.step;
+        ud->current = length > 0 ? ud->range.start : ud->range.stop;
+        return true;
+    }
+    py_Ref res = py_pushtmp();
+    bool is_sequence = py_tpfindmagic(seq->type, __len__) &&
+                       py_tpfindmagic(seq->type, __getitem__) &&
+                       !py_issubclass(seq->type, tp_dict);
+    if(!is_sequence) {
+        // not a sequence, materialize it first
+        if(!py_tpcall(tp_list, 1, seq)) {
+            py_pop();
+            return false;
+        }
+        *res = *py_retval();
+        seq = res;
+    }
+    if(!py_len(seq)) {
+        py_pop();
+        return false;
+    }
+    py_i64 length = py_toint(py_retval());
+    py_i64* ud = py_newobject(py_retval(), tp_reversed, 1, sizeof(py_i64));
+    *ud = length - 1;
+    py_setslot(py_retval(), 0, seq);
+    py_pop();
+    return true;
+}
+
+bool reversed__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_i64* ud = py_touserdata(argv);
+    py_Ref seq = py_getslot(argv, 0);
+    py_i64 index = *ud;
+    if(index < 0) return StopIteration();
+    *ud = index - 1;
+    if(seq->type == tp_list) {
+        if(index >= py_list_len(seq)) return StopIteration();
+        py_assign(py_retval(), py_list_getitem(seq, index));
+        return true;
+    }
+    if(seq->type == tp_tuple) {
+        py_assign(py_retval(), py_tuple_getitem(seq, index));
+        return true;
+    }
+    py_TValue key;
+    py_newint(&key, index);
+    return py_getitem(seq, &key);
+}
+
+static py_Type builtins__newiterator(const char* name, py_CFunction next_f) {
+    py_Type type = pk_newtype(name, tp_object, NULL, NULL, false, true);
+    py_bindmagic(type, __iter__, pk_wrapper__self);
+    py_bindmagic(type, __next__, next_f);
+    return type;
+}
+
+py_Type pk_map__register() {
+    py_Type type = builtins__newiterator("map", map__next__);
+    py_bindmagic(type, __new__, map__new__);
+    return type;
+}
+
+py_Type pk_filter__register() {
+    py_Type type = builtins__newiterator("filter", filter__next__);
+    py_bindmagic(type, __new__, filter__new__);
+    return type;
+}
+
+py_Type pk_zip__register() {
+    py_Type type = builtins__newiterator("zip", zip__next__);
+    py_bindmagic(type, __new__, zip__new__);
+    return type;
+}
+
+py_Type pk_enumerate__register() {
+    py_Type type = builtins__newiterator("enumerate", enumerate__next__);
+    py_bind(py_tpobject(type), "__new__(cls, iterable, start=0)", enumerate__new__);
+    return type;
+}
+
+py_Type pk_reversed__register() {
+    py_Type type = builtins__newiterator("reversed", reversed__next__);
+    py_bindmagic(type, __new__, reversed__new__);
+    return type;
+}
+
 static bool builtins_print(int argc, py_Ref argv) {
     // print(*args, sep=' ', end='\n', flush=False)
     py_TValue* args = py_tuple_data(argv);
@@ -23433,6 +27365,12 @@ py_GlobalRef pk_builtins__register() {
     py_bindfunc(builtins, "abs", builtins_abs);
     py_bindfunc(builtins, "divmod", builtins_divmod);
     py_bindfunc(builtins, "round", builtins_round);
+    py_bindfunc(builtins, "any", builtins_any);
+    py_bindfunc(builtins, "all", builtins_all);
+    py_bind(builtins, "sum(iterable, start=0)", builtins_sum);
+    py_bind(builtins, "min(*args, key=None)", builtins_min);
+    py_bind(builtins, "max(*args, key=None)", builtins_max);
+    py_bind(builtins, "sorted(iterable, key=None, reverse=False)", builtins_sorted);
 
     py_bind(builtins, "print(*args, sep=' ', end='\\n', flush=False)", builtins_print);
 
@@ -23472,10 +27410,11 @@ void function__gc_mark(void* ud, c11_vector* p_stack) {
     pk__mark_value(&func->globals);
     if(func->closure) {
         NameDict* dict = func->closure;
-        for(int i = 0; i < dict->capacity; i++) {
-            NameDict_KV* kv = &dict->items[i];
-            if(kv->key == NULL) continue;
-            pk__mark_value(&kv->value);
+        int i = 0;
+        py_Name key;
+        py_TValue* value;
+        while(NameDict__next(dict, &i, &key, &value)) {
+            pk__mark_value(value);
         }
     }
     FuncDecl__gc_mark(func->decl, p_stack);
@@ -23824,6 +27763,7 @@ typedef enum {
     PKL_CALL,
     PKL_OBJECT,
     PKL_EOF,
+    PKL_VEC4I,
     // clang-format on
 } PickleOp;
 
@@ -24006,6 +27946,36 @@ static bool _check_function(Function* f) {
     return true;
 }
 
+// same format as dict-based objects, unset slots are skipped
+static bool pkl__write_slotted_object(PickleObject* buf, py_TValue* obj, py_TypeInfo* ti) {
+    int n = obj->_obj->slots;
+    py_TValue* slots = PyObject__slots(obj->_obj);
+    py_Name* names = PK_MALLOC(sizeof(py_Name) * c11__max(n, 1));
+    pk_member__names(ti, names);
+    int length = 0;
+    for(int i = n - 1; i >= 0; i--) {
+        if(py_isnil(&slots[i])) continue;
+        if(!pkl__write_object(buf, &slots[i])) {
+            PK_FREE(names);
+            return false;
+        }
+        length++;
+    }
+    pkl__emit_op(buf, PKL_OBJECT);
+    pkl__emit_int(buf, obj->type);
+    buf->used_types[obj->type] = true;
+    pkl__emit_int(buf, length);
+    for(int i = 0; i < n; i++) {
+        if(py_isnil(&slots[i])) continue;
+        c11_sv field = py_name2sv(names[i]);
+        // include '\0'
+        PickleObject__write_bytes(buf, field.data, field.size + 1);
+    }
+    PK_FREE(names);
+    pkl__store_memo(buf, obj->_obj);
+    return true;
+}
+
 static bool pkl__write_object(PickleObject* buf, py_TValue* obj) {
     switch(obj->type) {
         case tp_nil: {
@@ -24110,6 +28080,15 @@ static bool pkl__write_object(PickleObject* buf, py_TValue* obj) {
             pkl__emit_int(buf, val.z);
             return true;
         }
+        case tp_vec4i: {
+            c11_vec4i val = py_tovec4i(obj);
+            pkl__emit_op(buf, PKL_VEC4I);
+            pkl__emit_int(buf, val.x);
+            pkl__emit_int(buf, val.y);
+            pkl__emit_int(buf, val.z);
+            pkl__emit_int(buf, val.w);
+            return true;
+        }
         case tp_type: {
             pkl__emit_op(buf, PKL_TYPE);
             py_Type type = py_totype(obj);
@@ -24218,21 +28197,32 @@ static bool pkl__write_object(PickleObject* buf, py_TValue* obj) {
                 pkl__store_memo(buf, obj->_obj);
                 return true;
             }
+            if(ti->is_python && obj->_obj->slots >= 0) {
+                return pkl__write_slotted_object(buf, obj, ti);
+            }
             if(ti->is_python) {
                 NameDict* dict = PyObject__dict(obj->_obj);
-                for(int i = dict->capacity - 1; i >= 0; i--) {
-                    NameDict_KV* kv = &dict->items[i];
-                    if(kv->key == NULL) continue;
-                    if(!pkl__write_object(buf, &kv->value)) return false;
+                // values are written in reverse order so that the first field is on top
+                if(dict->shape) {
+                    for(int i = dict->length - 1; i >= 0; i--) {
+                        if(!pkl__write_object(buf, &dict->values[i])) return false;
+                    }
+                } else {
+                    for(int i = dict->capacity - 1; i >= 0; i--) {
+                        NameDict_KV* kv = &dict->items[i];
+                        if(kv->key == NULL) continue;
+                        if(!pkl__write_object(buf, &kv->value)) return false;
+                    }
                 }
                 pkl__emit_op(buf, PKL_OBJECT);
                 pkl__emit_int(buf, obj->type);
                 buf->used_types[obj->type] = true;
                 pkl__emit_int(buf, dict->length);
-                for(int i = 0; i < dict->capacity; i++) {
-                    NameDict_KV* kv = &dict->items[i];
-                    if(kv->key == NULL) continue;
-                    c11_sv field = py_name2sv(kv->key);
+                int i = 0;
+                py_Name key;
+                py_TValue* value;
+                while(NameDict__next(dict, &i, &key, &value)) {
+                    c11_sv field = py_name2sv(key);
                     // include '\0'
                     PickleObject__write_bytes(buf, field.data, field.size + 1);
                 }
@@ -24414,8 +28404,7 @@ bool py_pickle_loads_body(const unsigned char* p, int memo_length, c11_smallmap_
             }
             case PKL_STRING: {
                 int size = pkl__read_int(&p);
-                char* dst = py_newstrn(py_pushtmp(), size);
-                memcpy(dst, p, size);
+                py_newstrv(py_pushtmp(), (c11_sv){(const char*)p, size});
                 p += size;
                 break;
             }
@@ -24493,6 +28482,15 @@ bool py_pickle_loads_body(const unsigned char* p, int memo_length, c11_smallmap_
                 py_newvec3i(py_pushtmp(), val);
                 break;
             }
+            case PKL_VEC4I: {
+                c11_vec4i val;
+                val.x = pkl__read_int(&p);
+                val.y = pkl__read_int(&p);
+                val.z = pkl__read_int(&p);
+                val.w = pkl__read_int(&p);
+                py_newvec4i(py_pushtmp(), val);
+                break;
+            }
             case PKL_TYPE: {
                 py_Type type = (py_Type)pkl__read_int(&p);
                 type = pkl__fix_type(type, type_mapping);
@@ -24543,13 +28541,21 @@ bool py_pickle_loads_body(const unsigned char* p, int memo_length, c11_smallmap_
             case PKL_OBJECT: {
                 py_Type type = (py_Type)pkl__read_int(&p);
                 type = pkl__fix_type(type, type_mapping);
-                py_newobject(py_retval(), type, -1, 0);
-                NameDict* dict = PyObject__dict(py_retval()->_obj);
+                py_TypeInfo* ti = pk_typeinfo(type);
+                py_newobject(py_retval(), type, ti->instance_slots, 0);
+                PyObject* obj = py_retval()->_obj;
                 int dict_length = pkl__read_int(&p);
                 for(int i = 0; i < dict_length; i++) {
                     py_StackRef value = py_peek(-1);
                     c11_sv field = {(const char*)p, strlen((const char*)p)};
-                    NameDict__set(dict, py_namev(field), value);
+                    py_Name name = py_namev(field);
+                    if(obj->slots == -1) {
+                        NameDict__set(PyObject__dict(obj), name, value);
+                    } else {
+                        int index = pk_member__index(ti, name);
+                        if(index < 0) return AttributeError(py_retval(), name);
+                        PyObject__slots(obj)[index] = *value;
+                    }
                     py_pop();
                     p += field.size + 1;
                 }
@@ -24711,6 +28717,38 @@ c11_vec2i py_tovec2i(py_Ref self) {
     return self->_vec2i;
 }
 
+#if PK_ENABLE_COMPACT_TVALUE
+// vectors wider than 8 bytes do not fit into a compact py_TValue and are boxed
+void py_newvec3(py_OutRef out, c11_vec3 v) {
+    c11_vec3* ud = py_newobject(out, tp_vec3, 0, sizeof(c11_vec3));
+    *ud = v;
+}
+
+c11_vec3 py_tovec3(py_Ref self) {
+    assert(self->type == tp_vec3);
+    return *(c11_vec3*)py_touserdata(self);
+}
+
+void py_newvec3i(py_OutRef out, c11_vec3i v) {
+    c11_vec3i* ud = py_newobject(out, tp_vec3i, 0, sizeof(c11_vec3i));
+    *ud = v;
+}
+
+c11_vec3i py_tovec3i(py_Ref self) {
+    assert(self->type == tp_vec3i);
+    return *(c11_vec3i*)py_touserdata(self);
+}
+
+void py_newvec4i(py_OutRef out, c11_vec4i v) {
+    c11_vec4i* ud = py_newobject(out, tp_vec4i, 0, sizeof(c11_vec4i));
+    *ud = v;
+}
+
+c11_vec4i py_tovec4i(py_Ref self) {
+    assert(self->type == tp_vec4i);
+    return *(c11_vec4i*)py_touserdata(self);
+}
+#else
 void py_newvec3(py_OutRef out, c11_vec3 v) {
     out->type = tp_vec3;
     out->is_ptr = false;
@@ -24743,6 +28781,7 @@ c11_vec4i py_tovec4i(py_Ref self) {
     assert(self->type == tp_vec4i);
     return self->_vec4i;
 }
+#endif
 
 c11_mat3x3* py_newmat3x3(py_OutRef out) {
     return py_newobject(out, tp_mat3x3, 0, sizeof(c11_mat3x3));
@@ -26162,243 +30201,2195 @@ int64_t mt19937__randint(mt19937* self, int64_t a, int64_t b) {
     }
 }
 
-static bool Random__new__(int argc, py_Ref argv) {
-    mt19937* ud = py_newobject(py_retval(), py_totype(argv), 0, sizeof(mt19937));
-    mt19937__ctor(ud);
+static bool Random__new__(int argc, py_Ref argv) {
+    mt19937* ud = py_newobject(py_retval(), py_totype(argv), 0, sizeof(mt19937));
+    mt19937__ctor(ud);
+    return true;
+}
+
+static bool Random__init__(int argc, py_Ref argv) {
+    if(argc == 1) {
+        // do nothing
+    } else if(argc == 2) {
+        mt19937* ud = py_touserdata(py_arg(0));
+        if(!py_isnone(&argv[1])) {
+            PY_CHECK_ARG_TYPE(1, tp_int);
+            py_i64 seed = py_toint(py_arg(1));
+            mt19937__seed(ud, (uint32_t)seed);
+        }
+    } else {
+        return TypeError("Random(): expected 1 or 2 arguments, got %d");
+    }
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool Random_seed(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    mt19937* ud = py_touserdata(py_arg(0));
+    py_i64 seed;
+    if(py_isnone(&argv[1])) {
+        seed = time_ns();
+    } else {
+        PY_CHECK_ARG_TYPE(1, tp_int);
+        seed = py_toint(py_arg(1));
+    }
+    mt19937__seed(ud, (uint32_t)seed);
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool Random_random(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    mt19937* ud = py_touserdata(py_arg(0));
+    py_f64 res = mt19937__random(ud);
+    py_newfloat(py_retval(), res);
+    return true;
+}
+
+static bool Random_uniform(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    mt19937* ud = py_touserdata(py_arg(0));
+    py_f64 a, b;
+    if(!py_castfloat(py_arg(1), &a)) return false;
+    if(!py_castfloat(py_arg(2), &b)) return false;
+    py_f64 res = mt19937__uniform(ud, a, b);
+    py_newfloat(py_retval(), res);
+    return true;
+}
+
+static bool Random_shuffle(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    PY_CHECK_ARG_TYPE(1, tp_list);
+    mt19937* ud = py_touserdata(py_arg(0));
+    py_Ref L = py_arg(1);
+    int length = py_list_len(L);
+    for(int i = length - 1; i > 0; i--) {
+        int j = mt19937__randint(ud, 0, i);
+        py_list_swap(L, i, j);
+    }
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool Random_randint(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    PY_CHECK_ARG_TYPE(1, tp_int);
+    PY_CHECK_ARG_TYPE(2, tp_int);
+    mt19937* ud = py_touserdata(py_arg(0));
+    py_i64 a = py_toint(py_arg(1));
+    py_i64 b = py_toint(py_arg(2));
+    if(a > b) return ValueError("randint(a, b): a must be less than or equal to b");
+    py_i64 res = mt19937__randint(ud, a, b);
+    py_newint(py_retval(), res);
+    return true;
+}
+
+static bool Random_choice(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    mt19937* ud = py_touserdata(py_arg(0));
+    if (py_isstr(py_arg(1))) {
+        c11_sv sv = py_tosv(py_arg(1));
+        int length = c11_sv__u8_length(sv);
+        if(length == 0) return IndexError("cannot choose from an empty sequence");
+        int index = mt19937__randint(ud, 0, length - 1);
+        c11_sv ch = c11_sv__u8_getitem(sv, index);
+        py_newstrv(py_retval(), ch);
+    } else {
+        py_TValue* p;
+        int length = pk_arrayview(py_arg(1), &p);
+        if(length == -1) return TypeError("choice(): argument must be a list, tuple or str");
+        if(length == 0) return IndexError("cannot choose from an empty sequence");
+        int index = mt19937__randint(ud, 0, length - 1);
+        py_assign(py_retval(), p + index);
+    }
+    return true;
+}
+
+static bool Random_choices(int argc, py_Ref argv) {
+    mt19937* ud = py_touserdata(py_arg(0));
+    py_TValue* p;
+    int length = pk_arrayview(py_arg(1), &p);
+    if(length == -1) return TypeError("choices(): argument must be a list or tuple");
+    if(length == 0) return IndexError("cannot choose from an empty sequence");
+    py_Ref weights = py_arg(2);
+    if(!py_checktype(py_arg(3), tp_int)) return false;
+    py_i64 k = py_toint(py_arg(3));
+
+    py_f64* cum_weights = PK_MALLOC(sizeof(py_f64) * length);
+    if(py_isnone(weights)) {
+        for(int i = 0; i < length; i++)
+            cum_weights[i] = i + 1;
+    } else {
+        py_TValue* w;
+        int wlen = pk_arrayview(weights, &w);
+        if(wlen == -1) {
+            PK_FREE(cum_weights);
+            return TypeError("choices(): weights must be a list or tuple");
+        }
+        if(wlen != length) {
+            PK_FREE(cum_weights);
+            return ValueError("len(weights) != len(population)");
+        }
+        if(!py_castfloat(&w[0], &cum_weights[0])) {
+            PK_FREE(cum_weights);
+            return false;
+        }
+        for(int i = 1; i < length; i++) {
+            py_f64 tmp;
+            if(!py_castfloat(&w[i], &tmp)) {
+                PK_FREE(cum_weights);
+                return false;
+            }
+            cum_weights[i] = cum_weights[i - 1] + tmp;
+        }
+    }
+
+    py_f64 total = cum_weights[length - 1];
+    if(total <= 1e-6) {
+        PK_FREE(cum_weights);
+        return ValueError("total of weights must be greater than 1e-6");
+    }
+
+    py_newlistn(py_retval(), k);
+    for(int i = 0; i < k; i++) {
+        py_f64 key = mt19937__random(ud) * total;
+        int index;
+        c11__lower_bound(py_f64, cum_weights, length, key, c11__less, &index);
+        assert(index != length);
+        py_list_setitem(py_retval(), i, p + index);
+    }
+
+    PK_FREE(cum_weights);
+    return true;
+}
+
+void pk__add_module_random() {
+    py_Ref mod = py_newmodule("random");
+    py_Type type = py_newtype("Random", tp_object, mod, NULL);
+
+    py_bindmagic(type, __new__, Random__new__);
+    py_bindmagic(type, __init__, Random__init__);
+    py_bindmethod(type, "seed", Random_seed);
+    py_bindmethod(type, "random", Random_random);
+    py_bindmethod(type, "uniform", Random_uniform);
+    py_bindmethod(type, "randint", Random_randint);
+    py_bindmethod(type, "shuffle", Random_shuffle);
+    py_bindmethod(type, "choice", Random_choice);
+    py_bind(py_tpobject(type), "choices(self, population, weights=None, k=1)", Random_choices);
+
+    py_Ref inst = py_pushtmp();
+    if(!py_tpcall(type, 0, NULL)) goto __ERROR;
+    py_assign(inst, py_retval());
+
+#define ADD_INST_BOUNDMETHOD(name)                                                                 \
+    if(!py_getattr(inst, py_name(name))) goto __ERROR;                                             \
+    py_setdict(mod, py_name(name), py_retval());
+
+    ADD_INST_BOUNDMETHOD("seed");
+    ADD_INST_BOUNDMETHOD("random");
+    ADD_INST_BOUNDMETHOD("uniform");
+    ADD_INST_BOUNDMETHOD("randint");
+    ADD_INST_BOUNDMETHOD("shuffle");
+    ADD_INST_BOUNDMETHOD("choice");
+    ADD_INST_BOUNDMETHOD("choices");
+
+#undef ADD_INST_BOUNDMETHOD
+
+    py_pop();  // pop inst
+    return;
+
+__ERROR:
+    py_printexc();
+    c11__abort("failed to add module random");
+}
+
+#undef N
+#undef M
+#undef MATRIX_A
+#undef UPPER_MASK
+#undef LOWER_MASK
+#undef ADD_INST_BOUNDMETHOD
+
+void py_newRandom(py_OutRef out) {
+    py_Type type = py_gettype("random", py_name("Random"));
+    assert(type != 0);
+    mt19937* ud = py_newobject(out, type, 0, sizeof(mt19937));
+    mt19937__ctor(ud);
+}
+
+void py_Random_seed(py_Ref self, py_i64 seed) {
+    mt19937* ud = py_touserdata(self);
+    mt19937__seed(ud, (uint32_t)seed);
+}
+
+py_f64 py_Random_random(py_Ref self) {
+    mt19937* ud = py_touserdata(self);
+    return mt19937__random(ud);
+}
+
+py_f64 py_Random_uniform(py_Ref self, py_f64 a, py_f64 b) {
+    mt19937* ud = py_touserdata(self);
+    return mt19937__uniform(ud, a, b);
+}
+
+py_i64 py_Random_randint(py_Ref self, py_i64 a, py_i64 b) {
+    mt19937* ud = py_touserdata(self);
+    if(a > b) { c11__abort("randint(a, b): a must be less than or equal to b"); }
+    return mt19937__randint(ud, a, b);
+}
+// src/modules/functools.c
+static uint64_t LruCache__mix(uint64_t h) {
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+// hash the arguments as a whole, without packing them into a tuple
+static bool LruCache__hash(int size, int kwargc, py_Ref argv, uint64_t* out) {
+    uint64_t h = (uint64_t)size | ((uint64_t)kwargc << 32);
+    for(int i = 0; i < size; i++) {
+        py_i64 x;
+        if(!py_hash(&argv[i], &x)) return false;
+        h = LruCache__mix(h ^ (uint64_t)x);
+    }
+    *out = h;
+    return true;
+}
+
+static LruCacheNode* LruCache__node(LruCache* self, int index) {
+    return c11__at(LruCacheNode, &self->nodes, index);
+}
+
+/// 1: same arguments, 0: different arguments, -1: error
+static int LruCache__match(LruCache* self, int index, int size, int kwargc, py_Ref argv) {
+    LruCacheNode* node = LruCache__node(self, index);
+    if(node->size != size || node->kwargc != kwargc) return 0;
+    for(int i = 0; i < size; i++) {
+        // `__eq__` may run arbitrary code, so the node is fetched again each time
+        node = LruCache__node(self, index);
+        py_Ref item = size == 1 ? &node->key : py_tuple_getitem(&node->key, i);
+        if(self->typed && item->type != argv[i].type) return 0;
+        int res = py_equal(item, &argv[i]);
+        if(res != 1) return res;
+    }
+    return 1;
+}
+
+/// Find the node of the arguments, `*p_index` is -1 if they are not cached.
+static bool LruCache__find(LruCache* self,
+                           uint64_t hash,
+                           int size,
+                           int kwargc,
+                           py_Ref argv,
+                           int* p_index) {
+    int mask = self->capacity - 1;
+    for(int slot = hash & mask;; slot = (slot + 1) & mask) {
+        int index = self->table[slot];
+        if(index == -1) break;
+        if(LruCache__node(self, index)->hash != hash) continue;
+        int res = LruCache__match(self, index, size, kwargc, argv);
+        if(res == -1) return false;
+        if(res == 1) {
+            *p_index = index;
+            return true;
+        }
+    }
+    *p_index = -1;
+    return true;
+}
+
+static void LruCache__link_front(LruCache* self, int index) {
+    LruCacheNode* node = LruCache__node(self, index);
+    if(self->head == -1) {
+        node->prev = node->next = index;
+    } else {
+        LruCacheNode* head = LruCache__node(self, self->head);
+        node->next = self->head;
+        node->prev = head->prev;
+        LruCache__node(self, head->prev)->next = index;
+        head->prev = index;
+    }
+    self->head = index;
+}
+
+static void LruCache__unlink(LruCache* self, int index) {
+    LruCacheNode* node = LruCache__node(self, index);
+    if(node->next == index) {
+        self->head = -1;
+        return;
+    }
+    LruCache__node(self, node->prev)->next = node->next;
+    LruCache__node(self, node->next)->prev = node->prev;
+    if(self->head == index) self->head = node->next;
+}
+
+// remove a node from the linear probing table by shifting the following run backwards
+static void LruCache__unindex(LruCache* self, int index) {
+    int mask = self->capacity - 1;
+    int hole = LruCache__node(self, index)->hash & mask;
+    while(self->table[hole] != index) {
+        hole = (hole + 1) & mask;
+    }
+    for(int slot = (hole + 1) & mask; self->table[slot] != -1; slot = (slot + 1) & mask) {
+        int home = LruCache__node(self, self->table[slot])->hash & mask;
+        // an entry stays if its home is cyclically within (hole, slot]
+        bool stays = hole <= slot ? (hole < home && home <= slot) : (hole < home || home <= slot);
+        if(stays) continue;
+        self->table[hole] = self->table[slot];
+        hole = slot;
+    }
+    self->table[hole] = -1;
+}
+
+static void LruCache__index(LruCache* self, int index) {
+    int mask = self->capacity - 1;
+    int slot = LruCache__node(self, index)->hash & mask;
+    while(self->table[slot] != -1) {
+        slot = (slot + 1) & mask;
+    }
+    self->table[slot] = index;
+}
+
+static size_t LruCache__buffer_size(LruCache* self) {
+    return (size_t)self->nodes.capacity * sizeof(LruCacheNode) +
+           (size_t)self->capacity * sizeof(int);
+}
+
+static void LruCache__resize_table(LruCache* self, int capacity) {
+    PK_FREE(self->table);
+    self->capacity = capacity;
+    self->table = PK_MALLOC(sizeof(int) * capacity);
+    memset(self->table, -1, sizeof(int) * capacity);
+    for(int i = 0; i < self->nodes.length; i++) {
+        LruCache__index(self, i);
+    }
+}
+
+static void LruCache__ctor(LruCache* self, int maxsize, bool typed) {
+    c11_vector__ctor(&self->nodes, sizeof(LruCacheNode));
+    self->table = NULL;
+    LruCache__resize_table(self, 8);
+    self->head = -1;
+    self->maxsize = maxsize;
+    self->typed = typed;
+    self->hits = 0;
+    self->misses = 0;
+}
+
+static void LruCache__dtor(LruCache* self) {
+    c11_vector__dtor(&self->nodes);
+    PK_FREE(self->table);
+}
+
+static void LruCache__insert(LruCache* self,
+                             uint64_t hash,
+                             int size,
+                             int kwargc,
+                             py_Ref argv,
+                             py_Ref result) {
+    size_t buffer_size = LruCache__buffer_size(self);
+    int index;
+    if(self->nodes.length == self->maxsize) {
+        // recycle the least recently used node
+        index = LruCache__node(self, self->head)->prev;
+        LruCache__unlink(self, index);
+        LruCache__unindex(self, index);
+    } else {
+        index = self->nodes.length;
+        c11_vector__emplace(&self->nodes);
+        // keep the load factor at most 1/2
+        if(self->nodes.length * 2 > self->capacity) {
+            LruCache__resize_table(self, self->capacity * 2);
+        }
+    }
+    LruCacheNode* node = LruCache__node(self, index);
+    node->hash = hash;
+    node->size = size;
+    node->kwargc = kwargc;
+    node->result = *result;
+    if(size == 1) {
+        node->key = argv[0];
+    } else {
+        // the node is seen by the GC while the tuple is being allocated
+        py_newnone(&node->key);
+        py_Ref key = py_pushtmp();
+        py_Ref p = py_newtuple(key, size);
+        for(int i = 0; i < size; i++) {
+            p[i] = argv[i];
+        }
+        LruCache__node(self, index)->key = *key;
+        py_pop();
+    }
+    LruCache__index(self, index);
+    if(self->maxsize != -1) LruCache__link_front(self, index);
+    size_t new_buffer_size = LruCache__buffer_size(self);
+    if(new_buffer_size > buffer_size) {
+        ManagedHeap__account_buffer(&pk_current_vm->heap, new_buffer_size - buffer_size);
+    }
+}
+
+///////////////////////////////
+static bool lru_cache_wrapper__new__(int argc, py_Ref argv) {
+    // __new__(cls, user_function, maxsize=128, typed=False)
+    if(!py_callable(py_arg(1))) return TypeError("the first argument must be callable");
+    int maxsize = -1;
+    if(!py_isnone(py_arg(2))) {
+        PY_CHECK_ARG_TYPE(2, tp_int);
+        py_i64 val = py_toint(py_arg(2));
+        maxsize = (int)c11__max(0, c11__min(val, INT32_MAX));
+    }
+    PY_CHECK_ARG_TYPE(3, tp_bool);
+    LruCache* ud = py_newobject(py_retval(), tp_lru_cache_wrapper, 1, sizeof(LruCache));
+    LruCache__ctor(ud, maxsize, py_tobool(py_arg(3)));
+    py_setslot(py_retval(), 0, py_arg(1));
+    return true;
+}
+
+static bool LruCache__call_user_function(py_Ref func, int argc, int kwargc, py_Ref argv) {
+    if(kwargc == 0) return py_call(func, argc, argv);
+    py_push(func);
+    py_pushnil();
+    for(int i = 0; i < argc + kwargc * 2; i++) {
+        py_push(&argv[i]);
+    }
+    return py_vectorcall(argc, kwargc);
+}
+
+bool lru_cache_wrapper__vectorcall(py_Ref wrapper, int argc, int kwargc, py_Ref argv) {
+    LruCache* self = py_touserdata(wrapper);
+    py_Ref func = py_getslot(wrapper, 0);
+    if(self->maxsize == 0) {
+        self->misses++;
+        return LruCache__call_user_function(func, argc, kwargc, argv);
+    }
+    // keyword names are part of the key, in the order they were given like CPython
+    int size = argc + kwargc * 2;
+    uint64_t hash;
+    if(!LruCache__hash(size, kwargc, argv, &hash)) return false;
+    int index;
+    if(!LruCache__find(self, hash, size, kwargc, argv, &index)) return false;
+    if(index != -1) {
+        self->hits++;
+        if(self->maxsize != -1 && self->head != index) {
+            LruCache__unlink(self, index);
+            LruCache__link_front(self, index);
+        }
+        py_assign(py_retval(), &LruCache__node(self, index)->result);
+        return true;
+    }
+    self->misses++;
+    if(!LruCache__call_user_function(func, argc, kwargc, argv)) return false;
+    py_Ref result = py_pushtmp();
+    *result = *py_retval();
+    // a recursive call may have cached the same arguments in the meantime
+    if(!LruCache__find(self, hash, size, kwargc, argv, &index)) return false;
+    if(index == -1) LruCache__insert(self, hash, size, kwargc, argv, result);
+    py_assign(py_retval(), result);
+    py_pop();
+    return true;
+}
+
+static bool lru_cache_wrapper__call__(int argc, py_Ref argv) {
+    // calls with keyword arguments are dispatched by VM__vectorcall directly
+    return lru_cache_wrapper__vectorcall(argv, argc - 1, 0, argv + 1);
+}
+
+static bool lru_cache_wrapper_cache_info(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    LruCache* self = py_touserdata(argv);
+    py_newobject(py_retval(), tp_CacheInfo, 4, 0);
+    py_newint(py_getslot(py_retval(), 0), self->hits);
+    py_newint(py_getslot(py_retval(), 1), self->misses);
+    if(self->maxsize == -1) {
+        py_newnone(py_getslot(py_retval(), 2));
+    } else {
+        py_newint(py_getslot(py_retval(), 2), self->maxsize);
+    }
+    py_newint(py_getslot(py_retval(), 3), self->nodes.length);
+    return true;
+}
+
+static bool lru_cache_wrapper_cache_clear(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    LruCache* self = py_touserdata(argv);
+    c11_vector__clear(&self->nodes);
+    memset(self->table, -1, sizeof(int) * self->capacity);
+    self->head = -1;
+    self->hits = 0;
+    self->misses = 0;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool lru_cache_wrapper__wrapped__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_assign(py_retval(), py_getslot(argv, 0));
+    return true;
+}
+
+static bool lru_cache_wrapper__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    if(!py_repr(py_getslot(argv, 0))) return false;
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    pk_sprintf(&buf, "<lru_cache of %v>", py_tosv(py_retval()));
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+static const char* const CacheInfo__fields[] = {"hits", "misses", "maxsize", "currsize"};
+
+static bool CacheInfo__field(int argc, py_Ref argv, int i) {
+    PY_CHECK_ARGC(1);
+    py_assign(py_retval(), py_getslot(argv, i));
+    return true;
+}
+
+static bool CacheInfo_hits(int argc, py_Ref argv) { return CacheInfo__field(argc, argv, 0); }
+
+static bool CacheInfo_misses(int argc, py_Ref argv) { return CacheInfo__field(argc, argv, 1); }
+
+static bool CacheInfo_maxsize(int argc, py_Ref argv) { return CacheInfo__field(argc, argv, 2); }
+
+static bool CacheInfo_currsize(int argc, py_Ref argv) { return CacheInfo__field(argc, argv, 3); }
+
+static bool CacheInfo__tuple(py_Ref self, py_OutRef out) {
+    py_Ref p = py_newtuple(out, 4);
+    for(int i = 0; i < 4; i++) {
+        p[i] = *py_getslot(self, i);
+    }
+    return true;
+}
+
+static bool CacheInfo__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    c11_sbuf__write_cstr(&buf, "CacheInfo(");
+    for(int i = 0; i < 4; i++) {
+        if(i > 0) c11_sbuf__write_cstr(&buf, ", ");
+        if(!py_repr(py_getslot(argv, i))) {
+            c11_sbuf__dtor(&buf);
+            return false;
+        }
+        pk_sprintf(&buf, "%s=%v", CacheInfo__fields[i], py_tosv(py_retval()));
+    }
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+static bool CacheInfo__eq__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Ref self = py_pushtmp();
+    CacheInfo__tuple(argv, self);
+    py_Ref other = py_pushtmp();
+    if(py_istype(py_arg(1), tp_CacheInfo)) {
+        CacheInfo__tuple(py_arg(1), other);
+    } else {
+        *other = *py_arg(1);
+    }
+    if(!py_eq(self, other)) return false;
+    py_shrink(2);
+    return true;
+}
+
+static bool CacheInfo__iter__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref tuple = py_pushtmp();
+    CacheInfo__tuple(argv, tuple);
+    if(!py_iter(tuple)) return false;
+    py_pop();
+    return true;
+}
+
+static bool CacheInfo__getitem__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Ref tuple = py_pushtmp();
+    CacheInfo__tuple(argv, tuple);
+    if(!py_getitem(tuple, py_arg(1))) return false;
+    py_pop();
+    return true;
+}
+
+// partial(func, *args, **kwargs)
+// keywords are kept as flat [name, value] pairs in the layout of the vectorcall stack,
+// so that VM__vectorcall can splice them in directly
+static bool partial__set_keyword(py_Ref key, py_Ref val, void* ctx) {
+    return py_dict_setitem(ctx, key, val);
+}
+
+static void partial__keywords(py_Ref pairs, py_OutRef out) {
+    py_newdict(out);
+    int n = py_tuple_len(pairs);
+    py_TValue* p = py_tuple_data(pairs);
+    for(int i = 0; i < n; i += 2) {
+        // keys are names, this never fails
+        py_dict_setitem(out, py_name2ref((py_Name)(uintptr_t)py_toint(&p[i])), &p[i + 1]);
+    }
+}
+
+static bool partial__new__(int argc, py_Ref argv) {
+    // __new__(cls, func, *args, **kwargs)
+    py_Ref func = py_arg(1);
+    py_Ref args = py_arg(2);
+    py_Ref kwargs = py_arg(3);
+    if(!py_callable(func)) return TypeError("the first argument must be callable");
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_partial, 3, 0);
+    if(func->type == tp_partial) {
+        // flatten nested partials
+        py_Ref inner_args = py_getslot(func, 1);
+        int n = py_tuple_len(inner_args);
+        int m = py_tuple_len(args);
+        py_TValue* p = py_newtuple(py_getslot(res, 1), n + m);
+        memcpy(p, py_tuple_data(inner_args), n * sizeof(py_TValue));
+        memcpy(p + n, py_tuple_data(args), m * sizeof(py_TValue));
+        py_Ref merged = py_pushtmp();
+        partial__keywords(py_getslot(func, 2), merged);
+        if(!py_dict_apply(kwargs, partial__set_keyword, merged)) return false;
+        *kwargs = *merged;
+        py_pop();
+        py_setslot(res, 0, py_getslot(func, 0));
+    } else {
+        py_setslot(res, 0, func);
+        py_setslot(res, 1, args);
+    }
+    py_TValue* p = py_newtuple(py_getslot(res, 2), py_dict_len(kwargs) * 2);
+    if(!py_dict_apply(kwargs, unpack_dict_to_buffer, &p)) return false;
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool partial__call__(int argc, py_Ref argv) {
+    // __call__(self, *args, **kwargs)
+    // only reached by an explicit `__call__`, calls are normally patched in VM__vectorcall
+    py_Ref self = py_arg(0);
+    py_Ref bound = py_getslot(self, 1);
+    py_Ref pairs = py_getslot(self, 2);
+    int n = py_tuple_len(bound);
+    int m = py_tuple_len(py_arg(1));
+    int kwargc = py_tuple_len(pairs) / 2 + py_dict_len(py_arg(2));
+    py_push(py_getslot(self, 0));
+    py_pushnil();
+    for(int i = 0; i < n; i++) {
+        py_push(py_tuple_getitem(bound, i));
+    }
+    for(int i = 0; i < m; i++) {
+        py_push(py_tuple_getitem(py_arg(1), i));
+    }
+    for(int i = 0; i < py_tuple_len(pairs); i++) {
+        py_push(py_tuple_getitem(pairs, i));
+    }
+    py_TValue* p = py_peek(0);
+    for(int i = py_tuple_len(pairs) / 2; i < kwargc; i++) {
+        py_pushtmp();
+        py_pushtmp();
+    }
+    if(!py_dict_apply(py_arg(2), unpack_dict_to_buffer, &p)) return false;
+    return py_vectorcall(n + m, kwargc);
+}
+
+static bool partial_func(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_assign(py_retval(), py_getslot(argv, 0));
+    return true;
+}
+
+static bool partial_args(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_assign(py_retval(), py_getslot(argv, 1));
+    return true;
+}
+
+static bool partial_keywords(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    partial__keywords(py_getslot(argv, 2), py_retval());
+    return true;
+}
+
+static bool partial__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref args = py_getslot(argv, 1);
+    py_Ref pairs = py_getslot(argv, 2);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    c11_sbuf__write_cstr(&buf, "functools.partial(");
+    int n = py_tuple_len(args);
+    for(int i = -1; i < n; i++) {
+        if(!py_repr(i == -1 ? py_getslot(argv, 0) : py_tuple_getitem(args, i))) {
+            c11_sbuf__dtor(&buf);
+            return false;
+        }
+        if(i >= 0) c11_sbuf__write_cstr(&buf, ", ");
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
+    }
+    for(int i = 0; i < py_tuple_len(pairs); i += 2) {
+        if(!py_repr(py_tuple_getitem(pairs, i + 1))) {
+            c11_sbuf__dtor(&buf);
+            return false;
+        }
+        py_Name name = (py_Name)(uintptr_t)py_toint(py_tuple_getitem(pairs, i));
+        pk_sprintf(&buf, ", %n=%v", name, py_tosv(py_retval()));
+    }
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+// reduce(function, iterable[, initial])
+static bool functools_reduce(int argc, py_Ref argv) {
+    if(argc != 2 && argc != 3) return TypeError("reduce expected 2 or 3 arguments, got %d", argc);
+    if(!py_iter(py_arg(1))) return false;
+    py_Ref it = py_pushtmp();
+    *it = *py_retval();
+    py_Ref args = py_pushtmp();  // [value, element]
+    py_pushtmp();
+    if(argc == 3) {
+        args[0] = *py_arg(2);
+    } else {
+        int res = py_next(it);
+        if(res == -1) return false;
+        if(res == 0) return TypeError("reduce() of empty sequence with no initial value");
+        args[0] = *py_retval();
+    }
+    while(true) {
+        int res = py_next(it);
+        if(res == -1) return false;
+        if(res == 0) break;
+        args[1] = *py_retval();
+        if(!py_call(py_arg(0), 2, args)) return false;
+        args[0] = *py_retval();
+    }
+    py_assign(py_retval(), args);
+    py_shrink(3);
+    return true;
+}
+
+void pk__add_module_functools() {
+    py_GlobalRef mod = py_newmodule("_functools");
+
+    py_Type wrapper =
+        py_newtype("_lru_cache_wrapper", tp_object, mod, (void (*)(void*))LruCache__dtor);
+    assert(wrapper == tp_lru_cache_wrapper);
+    py_bind(py_tpobject(wrapper),
+            "__new__(cls, user_function, maxsize=128, typed=False)",
+            lru_cache_wrapper__new__);
+    py_bindmagic(wrapper, __call__, lru_cache_wrapper__call__);
+    py_bindmagic(wrapper, __repr__, lru_cache_wrapper__repr__);
+    py_bindproperty(wrapper, "__wrapped__", lru_cache_wrapper__wrapped__, NULL);
+    py_bindmethod(wrapper, "cache_info", lru_cache_wrapper_cache_info);
+    py_bindmethod(wrapper, "cache_clear", lru_cache_wrapper_cache_clear);
+
+    py_Type info = py_newtype("CacheInfo", tp_object, mod, NULL);
+    assert(info == tp_CacheInfo);
+    py_bindproperty(info, "hits", CacheInfo_hits, NULL);
+    py_bindproperty(info, "misses", CacheInfo_misses, NULL);
+    py_bindproperty(info, "maxsize", CacheInfo_maxsize, NULL);
+    py_bindproperty(info, "currsize", CacheInfo_currsize, NULL);
+    py_bindmagic(info, __repr__, CacheInfo__repr__);
+    py_bindmagic(info, __eq__, CacheInfo__eq__);
+    py_bindmagic(info, __iter__, CacheInfo__iter__);
+    py_bindmagic(info, __getitem__, CacheInfo__getitem__);
+
+    py_Type partial = py_newtype("partial", tp_object, mod, NULL);
+    assert(partial == tp_partial);
+    py_bind(py_tpobject(partial), "__new__(cls, func, *args, **kwargs)", partial__new__);
+    py_bind(py_tpobject(partial), "__call__(self, *args, **kwargs)", partial__call__);
+    py_bindmagic(partial, __repr__, partial__repr__);
+    py_bindproperty(partial, "func", partial_func, NULL);
+    py_bindproperty(partial, "args", partial_args, NULL);
+    py_bindproperty(partial, "keywords", partial_keywords, NULL);
+
+    py_bindfunc(mod, "reduce", functools_reduce);
+}
+
+// src/modules/itertools.c
+// index state of the combinatoric iterators, permutations keep their cycles after `indices`
+typedef struct {
+    int n;  // pool size, or the number of pools for product
+    int r;  // length of each result
+    bool started;
+    bool stopped;
+    int indices[];
+} Combinatorics;
+
+static Combinatorics* Combinatorics__new(py_OutRef out, py_Type type, int n, int r, int count) {
+    Combinatorics* self = py_newobject(out, type, 1, sizeof(Combinatorics) + count * sizeof(int));
+    self->n = n;
+    self->r = r;
+    self->started = false;
+    self->stopped = false;
+    for(int i = 0; i < count; i++) {
+        self->indices[i] = i;
+    }
+    return self;
+}
+
+static void Combinatorics__result(Combinatorics* self, py_Ref pool) {
+    py_TValue* p = py_newtuple(py_retval(), self->r);
+    py_TValue* data = py_tuple_data(pool);
+    for(int i = 0; i < self->r; i++) {
+        p[i] = data[self->indices[i]];
+    }
+}
+
+static bool Combinatorics__stop(Combinatorics* self) {
+    self->stopped = true;
+    return StopIteration();
+}
+
+// chain(*iterables)
+static bool itertools_chain__new__(int argc, py_Ref argv) {
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_itertools_chain, 2, 0);
+    if(!py_iter(py_arg(1))) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_chain_from_iterable_STATIC(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_itertools_chain, 2, 0);
+    if(!py_iter(argv)) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_chain__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref active = py_getslot(argv, 1);
+    while(true) {
+        if(!py_isnil(active)) {
+            int res = py_next(active);
+            if(res != 0) return res == 1;
+            py_newnil(active);
+        }
+        int res = py_next(py_getslot(argv, 0));
+        if(res != 1) return res == 0 ? StopIteration() : false;
+        *active = *py_retval();
+        if(!py_iter(active)) return false;
+        *active = *py_retval();
+    }
+}
+
+// islice(iterable, stop) or islice(iterable, start, stop[, step])
+typedef struct {
+    py_i64 next;   // index of the next item to yield
+    py_i64 stop;   // -1 if unbounded
+    py_i64 step;
+    py_i64 index;  // index of the next item to pull from the iterator
+} ISlice;
+
+static bool itertools_islice__index(py_Ref arg, py_i64 none, py_i64* out) {
+    if(py_isnone(arg)) {
+        *out = none;
+        return true;
+    }
+    if(py_isint(arg) && py_toint(arg) >= 0) {
+        *out = py_toint(arg);
+        return true;
+    }
+    return ValueError("Indices for islice() must be None or an integer: 0 <= x <= sys.maxsize.");
+}
+
+static bool itertools_islice__new__(int argc, py_Ref argv) {
+    // __new__(cls, iterable, *args)
+    int n = py_tuple_len(py_arg(2));
+    py_TValue* args = py_tuple_data(py_arg(2));
+    if(n < 1 || n > 3) return TypeError("islice expected 2 to 4 arguments, got %d", n + 1);
+    ISlice ud = {.next = 0, .stop = -1, .step = 1, .index = 0};
+    if(n == 1) {
+        if(!itertools_islice__index(&args[0], -1, &ud.stop)) return false;
+    } else {
+        if(!itertools_islice__index(&args[0], 0, &ud.next)) return false;
+        if(!itertools_islice__index(&args[1], -1, &ud.stop)) return false;
+        if(n == 3 && !py_isnone(&args[2])) {
+            if(!py_isint(&args[2]) || py_toint(&args[2]) <= 0) {
+                return ValueError("Step for islice() must be a positive integer or None.");
+            }
+            ud.step = py_toint(&args[2]);
+        }
+    }
+    py_Ref res = py_pushtmp();
+    *(ISlice*)py_newobject(res, tp_itertools_islice, 1, sizeof(ISlice)) = ud;
+    if(!py_iter(py_arg(1))) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_islice__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    ISlice* ud = py_touserdata(argv);
+    while(ud->stop == -1 || ud->next < ud->stop) {
+        int res = py_next(py_getslot(argv, 0));
+        if(res != 1) return res == 0 ? StopIteration() : false;
+        if(ud->index++ == ud->next) {
+            // saturate instead of wrapping around
+            ud->next = ud->next > INT64_MAX - ud->step ? INT64_MAX : ud->next + ud->step;
+            return true;
+        }
+    }
+    return StopIteration();
+}
+
+// count(start=0, step=1)
+static bool itertools_count__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    for(int i = 1; i < 3; i++) {
+        if(!py_isint(py_arg(i)) && !py_isfloat(py_arg(i))) {
+            return TypeError("a number is required");
+        }
+    }
+    py_newobject(py_retval(), tp_itertools_count, 2, 0);
+    py_setslot(py_retval(), 0, py_arg(1));
+    py_setslot(py_retval(), 1, py_arg(2));
+    return true;
+}
+
+static bool itertools_count__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref curr = py_getslot(argv, 0);
+    py_Ref step = py_getslot(argv, 1);
+    // numbers are unboxed, so the current value needs no rooting
+    py_TValue value = *curr;
+    if(py_isint(curr) && py_isint(step)) {
+        py_newint(curr, py_toint(curr) + py_toint(step));
+    } else {
+        if(!py_binaryadd(curr, step)) return false;
+        *curr = *py_retval();
+    }
+    *py_retval() = value;
+    return true;
+}
+
+static bool itertools_count__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref step = py_getslot(argv, 1);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    // repr of a number never fails
+    py_repr(py_getslot(argv, 0));
+    pk_sprintf(&buf, "count(%v", py_tosv(py_retval()));
+    if(!py_isint(step) || py_toint(step) != 1) {
+        py_repr(step);
+        pk_sprintf(&buf, ", %v", py_tosv(py_retval()));
+    }
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+// repeat(object, times=None)
+static bool itertools_repeat__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    py_i64 times = -1;  // -1 means forever
+    if(!py_isnone(py_arg(2))) {
+        PY_CHECK_ARG_TYPE(2, tp_int);
+        times = c11__max(py_toint(py_arg(2)), 0);
+    }
+    py_i64* ud = py_newobject(py_retval(), tp_itertools_repeat, 1, sizeof(py_i64));
+    *ud = times;
+    py_setslot(py_retval(), 0, py_arg(1));
+    return true;
+}
+
+static bool itertools_repeat__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_i64* ud = py_touserdata(argv);
+    if(*ud == 0) return StopIteration();
+    if(*ud > 0) (*ud)--;
+    py_assign(py_retval(), py_getslot(argv, 0));
+    return true;
+}
+
+static bool itertools_repeat__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_i64 times = *(py_i64*)py_touserdata(argv);
+    if(!py_repr(py_getslot(argv, 0))) return false;
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    pk_sprintf(&buf, "repeat(%v", py_tosv(py_retval()));
+    if(times >= 0) pk_sprintf(&buf, ", %i", times);
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+// cycle(iterable)
+typedef struct {
+    int index;
+    bool exhausted;
+} Cycle;
+
+static bool itertools_cycle__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Ref res = py_pushtmp();
+    Cycle* ud = py_newobject(res, tp_itertools_cycle, 2, sizeof(Cycle));
+    ud->index = 0;
+    ud->exhausted = false;
+    py_newlist(py_getslot(res, 1));
+    if(!py_iter(py_arg(1))) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_cycle__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Cycle* ud = py_touserdata(argv);
+    py_Ref saved = py_getslot(argv, 1);
+    if(!ud->exhausted) {
+        // save items on the first pass
+        int res = py_next(py_getslot(argv, 0));
+        if(res == -1) return false;
+        if(res == 1) {
+            py_list_append(saved, py_retval());
+            return true;
+        }
+        ud->exhausted = true;
+        py_newnil(py_getslot(argv, 0));
+    }
+    int length = py_list_len(saved);
+    if(length == 0) return StopIteration();
+    py_assign(py_retval(), py_list_getitem(saved, ud->index));
+    ud->index = (ud->index + 1) % length;
+    return true;
+}
+
+// product(*iterables, repeat=1)
+static bool itertools_product__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    PY_CHECK_ARG_TYPE(2, tp_int);
+    py_i64 repeat = py_toint(py_arg(2));
+    if(repeat < 0) return ValueError("repeat argument cannot be negative");
+    int n = py_tuple_len(py_arg(1));
+    if(n > 0 && repeat > INT32_MAX / n) return ValueError("repeat argument too large");
+    py_Ref pools = py_pushtmp();
+    py_newtuple(pools, n * (int)repeat);
+    for(int i = 0; i < n; i++) {
+        if(!py_tpcall(tp_tuple, 1, py_tuple_getitem(py_arg(1), i))) return false;
+        for(int j = 0; j < repeat; j++) {
+            py_tuple_setitem(pools, j * n + i, py_retval());
+        }
+    }
+    n *= (int)repeat;
+    Combinatorics* ud = Combinatorics__new(py_retval(), tp_itertools_product, n, n, n);
+    memset(ud->indices, 0, n * sizeof(int));
+    py_setslot(py_retval(), 0, pools);
+    py_pop();
+    return true;
+}
+
+static bool itertools_product__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Combinatorics* ud = py_touserdata(argv);
+    py_TValue* pools = py_tuple_data(py_getslot(argv, 0));
+    if(ud->stopped) return StopIteration();
+    if(!ud->started) {
+        ud->started = true;
+        for(int i = 0; i < ud->n; i++) {
+            if(py_tuple_len(&pools[i]) == 0) return Combinatorics__stop(ud);
+        }
+    } else {
+        // advance the rightmost index like an odometer
+        int i = ud->n - 1;
+        for(; i >= 0; i--) {
+            if(++ud->indices[i] < py_tuple_len(&pools[i])) break;
+            ud->indices[i] = 0;
+        }
+        if(i < 0) return Combinatorics__stop(ud);
+    }
+    py_TValue* p = py_newtuple(py_retval(), ud->n);
+    for(int i = 0; i < ud->n; i++) {
+        p[i] = *py_tuple_getitem(&pools[i], ud->indices[i]);
+    }
+    return true;
+}
+
+static bool itertools__pool(py_Ref iterable, py_Ref r, int* n, int* k) {
+    if(!py_tpcall(tp_tuple, 1, iterable)) return false;
+    *n = py_tuple_len(py_retval());
+    if(py_isnone(r)) {
+        *k = *n;
+        return true;
+    }
+    if(!py_checkint(r)) return false;
+    if(py_toint(r) < 0) return ValueError("r must be non-negative");
+    *k = (int)c11__min(py_toint(r), INT32_MAX / 2);
+    return true;
+}
+
+// permutations(iterable, r=None)
+static bool itertools_permutations__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    int n, r;
+    if(!itertools__pool(py_arg(1), py_arg(2), &n, &r)) return false;
+    py_Ref pool = py_pushtmp();
+    *pool = *py_retval();
+    Combinatorics* ud = Combinatorics__new(py_retval(), tp_itertools_permutations, n, r, n + r);
+    int* cycles = ud->indices + n;
+    for(int i = 0; i < r; i++) {
+        cycles[i] = n - i;
+    }
+    py_setslot(py_retval(), 0, pool);
+    py_pop();
+    return true;
+}
+
+static bool itertools_permutations__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Combinatorics* ud = py_touserdata(argv);
+    int n = ud->n;
+    int* indices = ud->indices;
+    int* cycles = indices + n;
+    if(ud->stopped) return StopIteration();
+    if(!ud->started) {
+        ud->started = true;
+        if(ud->r > n) return Combinatorics__stop(ud);
+    } else {
+        int i = ud->r - 1;
+        for(; i >= 0; i--) {
+            if(--cycles[i] == 0) {
+                // rotate indices[i:] left by one
+                int first = indices[i];
+                memmove(indices + i, indices + i + 1, (n - i - 1) * sizeof(int));
+                indices[n - 1] = first;
+                cycles[i] = n - i;
+            } else {
+                int j = n - cycles[i];
+                int tmp = indices[i];
+                indices[i] = indices[j];
+                indices[j] = tmp;
+                break;
+            }
+        }
+        if(i < 0) return Combinatorics__stop(ud);
+    }
+    Combinatorics__result(ud, py_getslot(argv, 0));
+    return true;
+}
+
+// combinations(iterable, r)
+static bool itertools_combinations__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    int n, r;
+    if(!itertools__pool(py_arg(1), py_arg(2), &n, &r)) return false;
+    py_Ref pool = py_pushtmp();
+    *pool = *py_retval();
+    Combinatorics__new(py_retval(), tp_itertools_combinations, n, r, r);
+    py_setslot(py_retval(), 0, pool);
+    py_pop();
+    return true;
+}
+
+static bool itertools_combinations__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Combinatorics* ud = py_touserdata(argv);
+    int n = ud->n, r = ud->r;
+    int* indices = ud->indices;
+    if(ud->stopped) return StopIteration();
+    if(!ud->started) {
+        ud->started = true;
+        if(r > n) return Combinatorics__stop(ud);
+    } else {
+        // find the rightmost index that is not at its maximum
+        int i = r - 1;
+        while(i >= 0 && indices[i] == i + n - r) {
+            i--;
+        }
+        if(i < 0) return Combinatorics__stop(ud);
+        indices[i]++;
+        for(int j = i + 1; j < r; j++) {
+            indices[j] = indices[j - 1] + 1;
+        }
+    }
+    Combinatorics__result(ud, py_getslot(argv, 0));
+    return true;
+}
+
+// groupby(iterable, key=None)
+// slots: [iterator, keyfunc, tgtkey, currkey, currvalue, currgrouper]
+// a _grouper is only valid while it is `currgrouper` of its parent
+static bool itertools_groupby__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_itertools_groupby, 6, 0);
+    py_setslot(res, 1, py_arg(2));
+    if(!py_iter(py_arg(1))) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+// 1: stepped, 0: exhausted, -1: error
+static int itertools_groupby__step(py_Ref self) {
+    int res = py_next(py_getslot(self, 0));
+    if(res != 1) return res;
+    py_Ref value = py_pushtmp();
+    *value = *py_retval();
+    py_Ref keyfunc = py_getslot(self, 1);
+    if(py_isnone(keyfunc)) {
+        py_setslot(self, 3, value);
+    } else {
+        if(!py_call(keyfunc, 1, value)) return -1;
+        py_setslot(self, 3, py_retval());
+    }
+    py_setslot(self, 4, value);
+    py_pop();
+    return 1;
+}
+
+static bool itertools_groupby__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref tgtkey = py_getslot(argv, 2);
+    py_Ref currkey = py_getslot(argv, 3);
+    py_newnil(py_getslot(argv, 5));
+    // skip the rest of the current group
+    while(true) {
+        if(!py_isnil(currkey)) {
+            if(py_isnil(tgtkey)) break;
+            int eq = py_equal(tgtkey, currkey);
+            if(eq == -1) return false;
+            if(!eq) break;
+        }
+        int res = itertools_groupby__step(argv);
+        if(res != 1) return res == 0 ? StopIteration() : false;
+    }
+    *tgtkey = *currkey;
+    py_Ref grouper = py_pushtmp();
+    py_newobject(grouper, tp_itertools_grouper, 2, 0);
+    py_setslot(grouper, 0, argv);
+    py_setslot(grouper, 1, tgtkey);
+    py_setslot(argv, 5, grouper);
+    py_TValue* p = py_newtuple(py_retval(), 2);
+    p[0] = *currkey;
+    p[1] = *grouper;
+    py_pop();
+    return true;
+}
+
+static bool itertools_grouper__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref parent = py_getslot(argv, 0);
+    if(!py_isidentical(py_getslot(parent, 5), argv)) return StopIteration();
+    py_Ref currvalue = py_getslot(parent, 4);
+    if(py_isnil(currvalue)) {
+        int res = itertools_groupby__step(parent);
+        if(res != 1) return res == 0 ? StopIteration() : false;
+    }
+    int eq = py_equal(py_getslot(argv, 1), py_getslot(parent, 3));
+    if(eq == -1) return false;
+    if(!eq) return StopIteration();
+    py_assign(py_retval(), currvalue);
+    py_newnil(currvalue);
+    return true;
+}
+
+// accumulate(iterable, func=None, initial=None)
+// slots: [iterator, func, total, initial]
+static bool itertools_accumulate__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(4);
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_itertools_accumulate, 4, 0);
+    py_setslot(res, 1, py_arg(2));
+    if(!py_isnone(py_arg(3))) py_setslot(res, 3, py_arg(3));
+    if(!py_iter(py_arg(1))) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_accumulate__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref total = py_getslot(argv, 2);
+    py_Ref initial = py_getslot(argv, 3);
+    if(!py_isnil(initial)) {
+        *total = *initial;
+        py_newnil(initial);
+        py_assign(py_retval(), total);
+        return true;
+    }
+    int res = py_next(py_getslot(argv, 0));
+    if(res != 1) return res == 0 ? StopIteration() : false;
+    if(!py_isnil(total)) {
+        py_Ref func = py_getslot(argv, 1);
+        py_Ref args = py_pushtmp();
+        py_pushtmp();
+        args[0] = *total;
+        args[1] = *py_retval();
+        bool ok = py_isnone(func) ? py_binaryadd(&args[0], &args[1]) : py_call(func, 2, args);
+        if(!ok) return false;
+        py_shrink(2);
+    }
+    *total = *py_retval();
+    return true;
+}
+
+// takewhile(predicate, iterable)
+static bool itertools_takewhile__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    py_Ref res = py_pushtmp();
+    bool* stopped = py_newobject(res, tp_itertools_takewhile, 2, sizeof(bool));
+    *stopped = false;
+    py_setslot(res, 0, py_arg(1));
+    if(!py_iter(py_arg(2))) return false;
+    py_setslot(res, 1, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_takewhile__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    bool* stopped = py_touserdata(argv);
+    if(*stopped) return StopIteration();
+    int res = py_next(py_getslot(argv, 1));
+    if(res != 1) return res == 0 ? StopIteration() : false;
+    py_Ref item = py_pushtmp();
+    *item = *py_retval();
+    if(!py_call(py_getslot(argv, 0), 1, item)) return false;
+    res = py_bool(py_retval());
+    if(res == -1) return false;
+    if(!res) {
+        *stopped = true;
+        py_pop();
+        return StopIteration();
+    }
+    py_assign(py_retval(), item);
+    py_pop();
+    return true;
+}
+
+// dropwhile(predicate, iterable)
+static bool itertools_dropwhile__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    py_Ref res = py_pushtmp();
+    bool* taking = py_newobject(res, tp_itertools_dropwhile, 2, sizeof(bool));
+    *taking = false;
+    py_setslot(res, 0, py_arg(1));
+    if(!py_iter(py_arg(2))) return false;
+    py_setslot(res, 1, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_dropwhile__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    bool* taking = py_touserdata(argv);
+    py_Ref item = py_pushtmp();
+    while(true) {
+        int res = py_next(py_getslot(argv, 1));
+        if(res != 1) {
+            py_pop();
+            return res == 0 ? StopIteration() : false;
+        }
+        if(*taking) break;
+        *item = *py_retval();
+        if(!py_call(py_getslot(argv, 0), 1, item)) return false;
+        res = py_bool(py_retval());
+        if(res == -1) return false;
+        if(!res) {
+            *taking = true;
+            py_assign(py_retval(), item);
+            break;
+        }
+    }
+    py_pop();
+    return true;
+}
+
+// pairwise(iterable)
+static bool itertools_pairwise__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Ref res = py_pushtmp();
+    py_newobject(res, tp_itertools_pairwise, 2, 0);
+    if(!py_iter(py_arg(1))) return false;
+    py_setslot(res, 0, py_retval());
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool itertools_pairwise__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    py_Ref it = py_getslot(argv, 0);
+    py_Ref old = py_getslot(argv, 1);
+    if(py_isnil(old)) {
+        int res = py_next(it);
+        if(res != 1) return res == 0 ? StopIteration() : false;
+        *old = *py_retval();
+    }
+    int res = py_next(it);
+    if(res != 1) {
+        py_newnil(old);
+        return res == 0 ? StopIteration() : false;
+    }
+    py_Ref item = py_pushtmp();
+    *item = *py_retval();
+    py_TValue* p = py_newtuple(py_retval(), 2);
+    p[0] = *old;
+    p[1] = *item;
+    *old = *item;
+    py_pop();
+    return true;
+}
+
+static py_Type itertools__newtype(const char* name, py_GlobalRef mod, py_CFunction next) {
+    py_Type type = py_newtype(name, tp_object, mod, NULL);
+    py_bindmagic(type, __iter__, pk_wrapper__self);
+    py_bindmagic(type, __next__, next);
+    return type;
+}
+
+void pk__add_module_itertools() {
+    py_GlobalRef mod = py_newmodule("itertools");
+    py_Type type;
+
+    type = itertools__newtype("chain", mod, itertools_chain__next__);
+    assert(type == tp_itertools_chain);
+    py_bind(py_tpobject(type), "__new__(cls, *iterables)", itertools_chain__new__);
+    py_bindstaticmethod(type, "from_iterable", itertools_chain_from_iterable_STATIC);
+
+    type = itertools__newtype("islice", mod, itertools_islice__next__);
+    assert(type == tp_itertools_islice);
+    py_bind(py_tpobject(type), "__new__(cls, iterable, *args)", itertools_islice__new__);
+
+    type = itertools__newtype("count", mod, itertools_count__next__);
+    assert(type == tp_itertools_count);
+    py_bind(py_tpobject(type), "__new__(cls, start=0, step=1)", itertools_count__new__);
+    py_bindmagic(type, __repr__, itertools_count__repr__);
+
+    type = itertools__newtype("repeat", mod, itertools_repeat__next__);
+    assert(type == tp_itertools_repeat);
+    py_bind(py_tpobject(type), "__new__(cls, object, times=None)", itertools_repeat__new__);
+    py_bindmagic(type, __repr__, itertools_repeat__repr__);
+
+    type = itertools__newtype("cycle", mod, itertools_cycle__next__);
+    assert(type == tp_itertools_cycle);
+    py_bindmagic(type, __new__, itertools_cycle__new__);
+
+    type = itertools__newtype("product", mod, itertools_product__next__);
+    assert(type == tp_itertools_product);
+    py_bind(py_tpobject(type), "__new__(cls, *iterables, repeat=1)", itertools_product__new__);
+
+    type = itertools__newtype("permutations", mod, itertools_permutations__next__);
+    assert(type == tp_itertools_permutations);
+    py_bind(py_tpobject(type), "__new__(cls, iterable, r=None)", itertools_permutations__new__);
+
+    type = itertools__newtype("combinations", mod, itertools_combinations__next__);
+    assert(type == tp_itertools_combinations);
+    py_bind(py_tpobject(type), "__new__(cls, iterable, r)", itertools_combinations__new__);
+
+    type = itertools__newtype("groupby", mod, itertools_groupby__next__);
+    assert(type == tp_itertools_groupby);
+    py_bind(py_tpobject(type), "__new__(cls, iterable, key=None)", itertools_groupby__new__);
+
+    type = itertools__newtype("_grouper", mod, itertools_grouper__next__);
+    assert(type == tp_itertools_grouper);
+
+    type = itertools__newtype("accumulate", mod, itertools_accumulate__next__);
+    assert(type == tp_itertools_accumulate);
+    py_bind(py_tpobject(type),
+            "__new__(cls, iterable, func=None, initial=None)",
+            itertools_accumulate__new__);
+
+    type = itertools__newtype("takewhile", mod, itertools_takewhile__next__);
+    assert(type == tp_itertools_takewhile);
+    py_bindmagic(type, __new__, itertools_takewhile__new__);
+
+    type = itertools__newtype("dropwhile", mod, itertools_dropwhile__next__);
+    assert(type == tp_itertools_dropwhile);
+    py_bindmagic(type, __new__, itertools_dropwhile__new__);
+
+    type = itertools__newtype("pairwise", mod, itertools_pairwise__next__);
+    assert(type == tp_itertools_pairwise);
+    py_bindmagic(type, __new__, itertools_pairwise__new__);
+}
+
+// src/modules/operator.c
+#define DEF_OPERATOR_BINARY(name, f)                                                               \
+    static bool operator_##name(int argc, py_Ref argv) {                                           \
+        PY_CHECK_ARGC(2);                                                                          \
+        return f(&argv[0], &argv[1]);                                                              \
+    }
+
+DEF_OPERATOR_BINARY(lt, py_lt)
+DEF_OPERATOR_BINARY(le, py_le)
+DEF_OPERATOR_BINARY(eq, py_eq)
+DEF_OPERATOR_BINARY(ne, py_ne)
+DEF_OPERATOR_BINARY(ge, py_ge)
+DEF_OPERATOR_BINARY(gt, py_gt)
+DEF_OPERATOR_BINARY(add, py_binaryadd)
+DEF_OPERATOR_BINARY(sub, py_binarysub)
+DEF_OPERATOR_BINARY(mul, py_binarymul)
+DEF_OPERATOR_BINARY(truediv, py_binarytruediv)
+DEF_OPERATOR_BINARY(floordiv, py_binaryfloordiv)
+DEF_OPERATOR_BINARY(mod, py_binarymod)
+DEF_OPERATOR_BINARY(pow, py_binarypow)
+DEF_OPERATOR_BINARY(matmul, py_binarymatmul)
+DEF_OPERATOR_BINARY(lshift, py_binarylshift)
+DEF_OPERATOR_BINARY(rshift, py_binaryrshift)
+DEF_OPERATOR_BINARY(and_, py_binaryand)
+DEF_OPERATOR_BINARY(or_, py_binaryor)
+DEF_OPERATOR_BINARY(xor, py_binaryxor)
+DEF_OPERATOR_BINARY(getitem, py_getitem)
+
+#undef DEF_OPERATOR_BINARY
+
+static bool operator_neg(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    return pk_callmagic(__neg__, 1, argv);
+}
+
+static bool operator_invert(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    return pk_callmagic(__invert__, 1, argv);
+}
+
+static bool operator_truth(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int res = py_bool(argv);
+    if(res == -1) return false;
+    py_newbool(py_retval(), res);
+    return true;
+}
+
+static bool operator_not_(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    int res = py_bool(argv);
+    if(res == -1) return false;
+    py_newbool(py_retval(), !res);
+    return true;
+}
+
+static bool operator_is_(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_newbool(py_retval(), py_isidentical(&argv[0], &argv[1]));
+    return true;
+}
+
+static bool operator_is_not(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_newbool(py_retval(), !py_isidentical(&argv[0], &argv[1]));
+    return true;
+}
+
+// like CPython, the in-place forms mutate a list and return it
+static bool operator_iadd(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!py_istype(argv, tp_list)) return py_binaryadd(&argv[0], &argv[1]);
+    // `list += x` accepts any iterable
+    if(!py_call(py_tpfindname(tp_list, py_name("extend")), 2, argv)) return false;
+    py_assign(py_retval(), argv);
+    return true;
+}
+
+static bool operator_imul(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!py_binarymul(&argv[0], &argv[1])) return false;
+    if(!py_istype(argv, tp_list)) return true;
+    py_Ref repeated = py_pushtmp();
+    py_assign(repeated, py_retval());
+    py_list_clear(argv);
+    int length = py_list_len(repeated);
+    for(int i = 0; i < length; i++) {
+        py_list_append(argv, py_list_getitem(repeated, i));
+    }
+    py_pop();
+    py_assign(py_retval(), argv);
+    return true;
+}
+
+static bool operator_contains(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Ref magic = py_tpfindmagic(argv->type, __contains__);
+    if(!magic) return TypeError("'%t' type does not support '__contains__'", argv->type);
+    if(!py_call(magic, 2, argv)) return false;
+    py_newbool(py_retval(), py_tobool(py_retval()));
+    return true;
+}
+
+static bool operator_setitem(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    if(!py_setitem(&argv[0], &argv[1], &argv[2])) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool operator_delitem(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!py_delitem(&argv[0], &argv[1])) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+// itemgetter(*items)
+static bool operator_itemgetter__new__(int argc, py_Ref argv) {
+    if(argc < 2) return TypeError("itemgetter expected 1 argument, got 0");
+    int n = argc - 1;
+    py_newobject(py_retval(), tp_operator_itemgetter, n, 0);
+    for(int i = 0; i < n; i++) {
+        py_setslot(py_retval(), i, py_arg(1 + i));
+    }
+    return true;
+}
+
+static bool operator_itemgetter__call__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    int n = argv->_obj->slots;
+    if(n == 1) return py_getitem(py_arg(1), py_getslot(argv, 0));
+    py_Ref res = py_pushtmp();
+    py_newtuple(res, n);
+    for(int i = 0; i < n; i++) {
+        if(!py_getitem(py_arg(1), py_getslot(argv, i))) return false;
+        py_tuple_setitem(res, i, py_retval());
+    }
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+// attrgetter(*attrs)
+// each dotted path is stored as its names followed by a NULL
+typedef struct {
+    int n;
+    py_Name names[];
+} AttrGetter;
+
+static bool operator_attrgetter__new__(int argc, py_Ref argv) {
+    if(argc < 2) return TypeError("attrgetter expected 1 argument, got 0");
+    int n = argc - 1;
+    int length = n;
+    for(int i = 0; i < n; i++) {
+        if(!py_checkstr(py_arg(1 + i))) return false;
+        c11_sv path = py_tosv(py_arg(1 + i));
+        for(int j = 0; j < path.size; j++) {
+            length += path.data[j] == '.';
+        }
+        length++;
+    }
+    AttrGetter* ud = py_newobject(py_retval(),
+                                  tp_operator_attrgetter,
+                                  0,
+                                  sizeof(AttrGetter) + length * sizeof(py_Name));
+    ud->n = n;
+    py_Name* p = ud->names;
+    for(int i = 0; i < n; i++) {
+        c11_sv path = py_tosv(py_arg(1 + i));
+        int start = 0;
+        for(int j = 0; j <= path.size; j++) {
+            if(j == path.size || path.data[j] == '.') {
+                *p++ = py_namev((c11_sv){path.data + start, j - start});
+                start = j + 1;
+            }
+        }
+        *p++ = NULL;
+    }
+    return true;
+}
+
+static bool operator_attrgetter__call__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    AttrGetter* ud = py_touserdata(argv);
+    py_Ref res = py_pushtmp();
+    py_Ref obj = py_pushtmp();
+    if(ud->n > 1) py_newtuple(res, ud->n);
+    py_Name* p = ud->names;
+    for(int i = 0; i < ud->n; i++) {
+        *obj = *py_arg(1);
+        for(; *p; p++) {
+            if(!py_getattr(obj, *p)) return false;
+            *obj = *py_retval();
+        }
+        p++;
+        if(ud->n > 1) py_tuple_setitem(res, i, obj);
+    }
+    py_assign(py_retval(), ud->n > 1 ? res : obj);
+    py_shrink(2);
+    return true;
+}
+
+// methodcaller(name, *args, **kwargs)
+// slots: [name, args, flat keyword pairs]
+static bool operator_methodcaller__new__(int argc, py_Ref argv) {
+    PY_CHECK_ARG_TYPE(1, tp_str);
+    py_Ref res = py_pushtmp();
+    py_Name* name = py_newobject(res, tp_operator_methodcaller, 3, sizeof(py_Name));
+    *name = py_namev(py_tosv(py_arg(1)));
+    py_setslot(res, 0, py_arg(1));
+    py_setslot(res, 1, py_arg(2));
+    py_TValue* p = py_newtuple(py_getslot(res, 2), py_dict_len(py_arg(3)) * 2);
+    if(!py_dict_apply(py_arg(3), unpack_dict_to_buffer, &p)) return false;
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
+static bool operator_methodcaller__call__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    py_Name name = *(py_Name*)py_touserdata(argv);
+    py_Ref args = py_getslot(argv, 1);
+    py_Ref pairs = py_getslot(argv, 2);
+    py_push(py_arg(1));
+    if(!py_pushmethod(name)) {
+        if(!py_getattr(py_arg(1), name)) return false;
+        *py_peek(-1) = *py_retval();
+        py_pushnil();
+    }
+    int n = py_tuple_len(args);
+    for(int i = 0; i < n; i++) {
+        py_push(py_tuple_getitem(args, i));
+    }
+    for(int i = 0; i < py_tuple_len(pairs); i++) {
+        py_push(py_tuple_getitem(pairs, i));
+    }
+    return py_vectorcall(n, py_tuple_len(pairs) / 2);
+}
+
+void pk__add_module_operator() {
+    py_GlobalRef mod = py_newmodule("operator");
+
+    py_bindfunc(mod, "lt", operator_lt);
+    py_bindfunc(mod, "le", operator_le);
+    py_bindfunc(mod, "eq", operator_eq);
+    py_bindfunc(mod, "ne", operator_ne);
+    py_bindfunc(mod, "ge", operator_ge);
+    py_bindfunc(mod, "gt", operator_gt);
+    py_bindfunc(mod, "not_", operator_not_);
+    py_bindfunc(mod, "truth", operator_truth);
+    py_bindfunc(mod, "is_", operator_is_);
+    py_bindfunc(mod, "is_not", operator_is_not);
+    py_bindfunc(mod, "add", operator_add);
+    py_bindfunc(mod, "sub", operator_sub);
+    py_bindfunc(mod, "mul", operator_mul);
+    py_bindfunc(mod, "truediv", operator_truediv);
+    py_bindfunc(mod, "floordiv", operator_floordiv);
+    py_bindfunc(mod, "mod", operator_mod);
+    py_bindfunc(mod, "pow", operator_pow);
+    py_bindfunc(mod, "matmul", operator_matmul);
+    py_bindfunc(mod, "neg", operator_neg);
+    py_bindfunc(mod, "invert", operator_invert);
+    py_bindfunc(mod, "lshift", operator_lshift);
+    py_bindfunc(mod, "rshift", operator_rshift);
+    py_bindfunc(mod, "and_", operator_and_);
+    py_bindfunc(mod, "or_", operator_or_);
+    py_bindfunc(mod, "xor", operator_xor);
+    py_bindfunc(mod, "contains", operator_contains);
+    py_bindfunc(mod, "getitem", operator_getitem);
+    py_bindfunc(mod, "setitem", operator_setitem);
+    py_bindfunc(mod, "delitem", operator_delitem);
+    // there are no in-place magic methods, so besides lists the in-place forms share the binary ones
+    py_bindfunc(mod, "iadd", operator_iadd);
+    py_bindfunc(mod, "isub", operator_sub);
+    py_bindfunc(mod, "imul", operator_imul);
+    py_bindfunc(mod, "itruediv", operator_truediv);
+    py_bindfunc(mod, "ifloordiv", operator_floordiv);
+    py_bindfunc(mod, "imod", operator_mod);
+    py_bindfunc(mod, "iand", operator_and_);
+    py_bindfunc(mod, "ior", operator_or_);
+    py_bindfunc(mod, "ixor", operator_xor);
+    py_bindfunc(mod, "ilshift", operator_lshift);
+    py_bindfunc(mod, "irshift", operator_rshift);
+
+    py_Type type;
+
+    type = py_newtype("itemgetter", tp_object, mod, NULL);
+    assert(type == tp_operator_itemgetter);
+    py_bindmagic(type, __new__, operator_itemgetter__new__);
+    py_bindmagic(type, __call__, operator_itemgetter__call__);
+
+    type = py_newtype("attrgetter", tp_object, mod, NULL);
+    assert(type == tp_operator_attrgetter);
+    py_bindmagic(type, __new__, operator_attrgetter__new__);
+    py_bindmagic(type, __call__, operator_attrgetter__call__);
+
+    type = py_newtype("methodcaller", tp_object, mod, NULL);
+    assert(type == tp_operator_methodcaller);
+    py_bind(py_tpobject(type), "__new__(cls, name, *args, **kwargs)", operator_methodcaller__new__);
+    py_bindmagic(type, __call__, operator_methodcaller__call__);
+}
+
+// src/modules/heapq.c
+static bool heapq__check_size(List* heap, int length) {
+    // a comparison ran arbitrary code which resized the heap
+    if(heap->length != length) return RuntimeError("list changed size during iteration");
     return true;
 }
 
-static bool Random__init__(int argc, py_Ref argv) {
-    if(argc == 1) {
-        // do nothing
-    } else if(argc == 2) {
-        mt19937* ud = py_touserdata(py_arg(0));
-        if(!py_isnone(&argv[1])) {
-            PY_CHECK_ARG_TYPE(1, tp_int);
-            py_i64 seed = py_toint(py_arg(1));
-            mt19937__seed(ud, (uint32_t)seed);
-        }
-    } else {
-        return TypeError("Random(): expected 1 or 2 arguments, got %d");
+static void heapq__swap(List* heap, int a, int b) {
+    py_TValue* data = heap->data;
+    py_TValue tmp = data[a];
+    data[a] = data[b];
+    data[b] = tmp;
+}
+
+// `heap` is a heap at all indices >= startpos, except possibly for pos
+static bool heapq__siftdown(List* heap, int startpos, int pos) {
+    int length = heap->length;
+    // follow the path to the root, moving parents down until the item fits
+    while(pos > startpos) {
+        int parentpos = (pos - 1) >> 1;
+        int res = py_less(c11__at(py_TValue, heap, pos), c11__at(py_TValue, heap, parentpos));
+        if(res == -1) return false;
+        if(!heapq__check_size(heap, length)) return false;
+        if(!res) break;
+        heapq__swap(heap, pos, parentpos);
+        pos = parentpos;
     }
-    py_newnone(py_retval());
     return true;
 }
 
-static bool Random_seed(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(2);
-    mt19937* ud = py_touserdata(py_arg(0));
-    py_i64 seed;
-    if(py_isnone(&argv[1])) {
-        seed = time_ns();
-    } else {
-        PY_CHECK_ARG_TYPE(1, tp_int);
-        seed = py_toint(py_arg(1));
+static bool heapq__siftup(List* heap, int pos) {
+    int endpos = heap->length;
+    int startpos = pos;
+    // bubble up the smaller child until hitting a leaf
+    while(pos < endpos >> 1) {
+        int childpos = 2 * pos + 1;
+        if(childpos + 1 < endpos) {
+            int res = py_less(c11__at(py_TValue, heap, childpos),
+                              c11__at(py_TValue, heap, childpos + 1));
+            if(res == -1) return false;
+            if(!heapq__check_size(heap, endpos)) return false;
+            if(!res) childpos++;
+        }
+        heapq__swap(heap, pos, childpos);
+        pos = childpos;
     }
-    mt19937__seed(ud, (uint32_t)seed);
+    // put the item to its final place by sifting its parents down
+    return heapq__siftdown(heap, startpos, pos);
+}
+
+static bool heapq_heappush(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    PY_CHECK_ARG_TYPE(0, tp_list);
+    List* heap = py_touserdata(argv);
+    py_list_append(argv, py_arg(1));
+    if(!heapq__siftdown(heap, 0, heap->length - 1)) return false;
     py_newnone(py_retval());
     return true;
 }
 
-static bool Random_random(int argc, py_Ref argv) {
+static bool heapq_heappop(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
-    mt19937* ud = py_touserdata(py_arg(0));
-    py_f64 res = mt19937__random(ud);
-    py_newfloat(py_retval(), res);
+    PY_CHECK_ARG_TYPE(0, tp_list);
+    List* heap = py_touserdata(argv);
+    if(heap->length == 0) return IndexError("index out of range");
+    py_TValue lastelt = c11_vector__back(py_TValue, heap);
+    c11_vector__pop(heap);
+    if(heap->length == 0) {
+        py_assign(py_retval(), &lastelt);
+        return true;
+    }
+    py_Ref returnitem = py_pushtmp();
+    *returnitem = c11__getitem(py_TValue, heap, 0);
+    c11__setitem(py_TValue, heap, 0, lastelt);
+    if(!heapq__siftup(heap, 0)) return false;
+    py_assign(py_retval(), returnitem);
+    py_pop();
     return true;
 }
 
-static bool Random_uniform(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(3);
-    mt19937* ud = py_touserdata(py_arg(0));
-    py_f64 a, b;
-    if(!py_castfloat(py_arg(1), &a)) return false;
-    if(!py_castfloat(py_arg(2), &b)) return false;
-    py_f64 res = mt19937__uniform(ud, a, b);
-    py_newfloat(py_retval(), res);
+static bool heapq_heapreplace(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    PY_CHECK_ARG_TYPE(0, tp_list);
+    List* heap = py_touserdata(argv);
+    if(heap->length == 0) return IndexError("index out of range");
+    py_Ref returnitem = py_pushtmp();
+    *returnitem = c11__getitem(py_TValue, heap, 0);
+    c11__setitem(py_TValue, heap, 0, *py_arg(1));
+    if(!heapq__siftup(heap, 0)) return false;
+    py_assign(py_retval(), returnitem);
+    py_pop();
     return true;
 }
 
-static bool Random_shuffle(int argc, py_Ref argv) {
+static bool heapq_heappushpop(int argc, py_Ref argv) {
     PY_CHECK_ARGC(2);
-    PY_CHECK_ARG_TYPE(1, tp_list);
-    mt19937* ud = py_touserdata(py_arg(0));
-    py_Ref L = py_arg(1);
-    int length = py_list_len(L);
-    for(int i = length - 1; i > 0; i--) {
-        int j = mt19937__randint(ud, 0, i);
-        py_list_swap(L, i, j);
+    PY_CHECK_ARG_TYPE(0, tp_list);
+    List* heap = py_touserdata(argv);
+    if(heap->length == 0) {
+        py_assign(py_retval(), py_arg(1));
+        return true;
     }
-    py_newnone(py_retval());
+    int res = py_less(c11__at(py_TValue, heap, 0), py_arg(1));
+    if(res == -1) return false;
+    if(!res) {
+        py_assign(py_retval(), py_arg(1));
+        return true;
+    }
+    if(heap->length == 0) return IndexError("index out of range");
+    py_Ref returnitem = py_pushtmp();
+    *returnitem = c11__getitem(py_TValue, heap, 0);
+    c11__setitem(py_TValue, heap, 0, *py_arg(1));
+    if(!heapq__siftup(heap, 0)) return false;
+    py_assign(py_retval(), returnitem);
+    py_pop();
     return true;
 }
 
-static bool Random_randint(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(3);
-    PY_CHECK_ARG_TYPE(1, tp_int);
-    PY_CHECK_ARG_TYPE(2, tp_int);
-    mt19937* ud = py_touserdata(py_arg(0));
-    py_i64 a = py_toint(py_arg(1));
-    py_i64 b = py_toint(py_arg(2));
-    if(a > b) return ValueError("randint(a, b): a must be less than or equal to b");
-    py_i64 res = mt19937__randint(ud, a, b);
-    py_newint(py_retval(), res);
+static bool heapq_heapify(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    PY_CHECK_ARG_TYPE(0, tp_list);
+    List* heap = py_touserdata(argv);
+    // transform bottom-up, starting from the last item with a child
+    for(int i = heap->length / 2 - 1; i >= 0; i--) {
+        if(!heapq__siftup(heap, i)) return false;
+    }
+    py_newnone(py_retval());
     return true;
 }
 
-static bool Random_choice(int argc, py_Ref argv) {
-    PY_CHECK_ARGC(2);
-    mt19937* ud = py_touserdata(py_arg(0));
-    if (py_isstr(py_arg(1))) {
-        c11_sv sv = py_tosv(py_arg(1));
-        int length = c11_sv__u8_length(sv);
-        if(length == 0) return IndexError("cannot choose from an empty sequence");
-        int index = mt19937__randint(ud, 0, length - 1);
-        c11_sv ch = c11_sv__u8_getitem(sv, index);
-        py_newstrv(py_retval(), ch);
-    } else {
-        py_TValue* p;
-        int length = pk_arrayview(py_arg(1), &p);
-        if(length == -1) return TypeError("choice(): argument must be a list, tuple or str");
-        if(length == 0) return IndexError("cannot choose from an empty sequence");
-        int index = mt19937__randint(ud, 0, length - 1);
-        py_assign(py_retval(), p + index);
+typedef struct {
+    py_TValue* keys;
+    bool largest;
+} heapq_Selection;
+
+// whether item `a` is output before item `b`, ties are kept in input order
+static int heapq_Selection__before(heapq_Selection* self, int a, int b) {
+    py_TValue* lhs = &self->keys[self->largest ? b : a];
+    py_TValue* rhs = &self->keys[self->largest ? a : b];
+    int res = py_less(lhs, rhs);
+    if(res != 0) return res;
+    res = py_less(rhs, lhs);
+    if(res != 0) return res == -1 ? -1 : 0;
+    return a < b;
+}
+
+// the top of `heap` is the selected item that is output last
+static bool heapq_Selection__sift(heapq_Selection* self, int* heap, int pos, int end) {
+    while(2 * pos + 1 < end) {
+        int child = 2 * pos + 1;
+        if(child + 1 < end) {
+            int res = heapq_Selection__before(self, heap[child], heap[child + 1]);
+            if(res == -1) return false;
+            if(res) child++;
+        }
+        int res = heapq_Selection__before(self, heap[pos], heap[child]);
+        if(res == -1) return false;
+        if(!res) break;
+        int tmp = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = tmp;
+        pos = child;
     }
     return true;
 }
 
-static bool Random_choices(int argc, py_Ref argv) {
-    mt19937* ud = py_touserdata(py_arg(0));
-    py_TValue* p;
-    int length = pk_arrayview(py_arg(1), &p);
-    if(length == -1) return TypeError("choices(): argument must be a list or tuple");
-    if(length == 0) return IndexError("cannot choose from an empty sequence");
-    py_Ref weights = py_arg(2);
-    if(!py_checktype(py_arg(3), tp_int)) return false;
-    py_i64 k = py_toint(py_arg(3));
-
-    py_f64* cum_weights = PK_MALLOC(sizeof(py_f64) * length);
-    if(py_isnone(weights)) {
-        for(int i = 0; i < length; i++)
-            cum_weights[i] = i + 1;
-    } else {
-        py_TValue* w;
-        int wlen = pk_arrayview(weights, &w);
-        if(wlen == -1) {
-            PK_FREE(cum_weights);
-            return TypeError("choices(): weights must be a list or tuple");
-        }
-        if(wlen != length) {
-            PK_FREE(cum_weights);
-            return ValueError("len(weights) != len(population)");
-        }
-        if(!py_castfloat(&w[0], &cum_weights[0])) {
-            PK_FREE(cum_weights);
-            return false;
-        }
-        for(int i = 1; i < length; i++) {
-            py_f64 tmp;
-            if(!py_castfloat(&w[i], &tmp)) {
-                PK_FREE(cum_weights);
-                return false;
-            }
-            cum_weights[i] = cum_weights[i - 1] + tmp;
+bool pk_nselect(py_TValue* keys, int length, int n, bool largest, int* out) {
+    if(n <= 0) return true;
+    // keep the best `n` items in a heap of indices, with the worst one on top
+    heapq_Selection self = {keys, largest};
+    int* heap = out;
+    bool ok = true;
+    for(int i = 0; i < n; i++) {
+        heap[i] = i;
+    }
+    for(int i = n / 2 - 1; ok && i >= 0; i--) {
+        ok = heapq_Selection__sift(&self, heap, i, n);
+    }
+    for(int i = n; ok && i < length; i++) {
+        int res = heapq_Selection__before(&self, i, heap[0]);
+        if(res == -1) {
+            ok = false;
+        } else if(res) {
+            heap[0] = i;
+            ok = heapq_Selection__sift(&self, heap, 0, n);
         }
     }
+    // move the worst item to the back until the heap is sorted
+    for(int end = n - 1; ok && end > 0; end--) {
+        int tmp = heap[0];
+        heap[0] = heap[end];
+        heap[end] = tmp;
+        ok = heapq_Selection__sift(&self, heap, 0, end);
+    }
+    return ok;
+}
 
-    py_f64 total = cum_weights[length - 1];
-    if(total <= 1e-6) {
-        PK_FREE(cum_weights);
-        return ValueError("total of weights must be greater than 1e-6");
+static bool heapq__select(py_Ref argv, bool largest) {
+    // (n, iterable, key=None)
+    PY_CHECK_ARG_TYPE(0, tp_int);
+    py_i64 n = py_toint(py_arg(0));
+    py_Ref key = py_arg(2);
+    py_Ref items = py_pushtmp();
+    if(!py_tpcall(tp_list, 1, py_arg(1))) return false;
+    *items = *py_retval();
+    int length = py_list_len(items);
+    if(n > length) n = length;
+    if(n <= 0) {
+        py_newlist(py_retval());
+        py_pop();
+        return true;
     }
 
-    py_newlistn(py_retval(), k);
-    for(int i = 0; i < k; i++) {
-        py_f64 key = mt19937__random(ud) * total;
-        int index;
-        c11__lower_bound(py_f64, cum_weights, length, key, c11__less, &index);
-        assert(index != length);
-        py_list_setitem(py_retval(), i, p + index);
+    py_Ref keys = items;
+    if(!py_isnone(key)) {
+        keys = py_pushtmp();
+        py_newlistn(keys, length);
+        for(int i = 0; i < length; i++) {
+            if(!py_call(key, 1, py_list_getitem(items, i))) return false;
+            py_list_setitem(keys, i, py_retval());
+        }
     }
 
-    PK_FREE(cum_weights);
-    return true;
+    int* indices = PK_MALLOC(sizeof(int) * n);
+    bool ok = pk_nselect(py_list_data(keys), length, n, largest, indices);
+    if(ok) {
+        py_newlistn(py_retval(), n);
+        for(int i = 0; i < n; i++) {
+            py_list_setitem(py_retval(), i, py_list_getitem(items, indices[i]));
+        }
+        py_shrink(keys == items ? 1 : 2);
+    }
+    PK_FREE(indices);
+    return ok;
 }
 
-void pk__add_module_random() {
-    py_Ref mod = py_newmodule("random");
-    py_Type type = py_newtype("Random", tp_object, mod, NULL);
-
-    py_bindmagic(type, __new__, Random__new__);
-    py_bindmagic(type, __init__, Random__init__);
-    py_bindmethod(type, "seed", Random_seed);
-    py_bindmethod(type, "random", Random_random);
-    py_bindmethod(type, "uniform", Random_uniform);
-    py_bindmethod(type, "randint", Random_randint);
-    py_bindmethod(type, "shuffle", Random_shuffle);
-    py_bindmethod(type, "choice", Random_choice);
-    py_bind(py_tpobject(type), "choices(self, population, weights=None, k=1)", Random_choices);
-
-    py_Ref inst = py_pushtmp();
-    if(!py_tpcall(type, 0, NULL)) goto __ERROR;
-    py_assign(inst, py_retval());
-
-#define ADD_INST_BOUNDMETHOD(name)                                                                 \
-    if(!py_getattr(inst, py_name(name))) goto __ERROR;                                             \
-    py_setdict(mod, py_name(name), py_retval());
-
-    ADD_INST_BOUNDMETHOD("seed");
-    ADD_INST_BOUNDMETHOD("random");
-    ADD_INST_BOUNDMETHOD("uniform");
-    ADD_INST_BOUNDMETHOD("randint");
-    ADD_INST_BOUNDMETHOD("shuffle");
-    ADD_INST_BOUNDMETHOD("choice");
-    ADD_INST_BOUNDMETHOD("choices");
+static bool heapq_nsmallest(int argc, py_Ref argv) {
+    // nsmallest(n, iterable, key=None)
+    return heapq__select(argv, false);
+}
 
-#undef ADD_INST_BOUNDMETHOD
+static bool heapq_nlargest(int argc, py_Ref argv) {
+    // nlargest(n, iterable, key=None)
+    return heapq__select(argv, true);
+}
 
-    py_pop();  // pop inst
-    return;
+void pk__add_module_heapq() {
+    py_Ref mod = py_newmodule("heapq");
 
-__ERROR:
-    py_printexc();
-    c11__abort("failed to add module random");
+    py_bindfunc(mod, "heappush", heapq_heappush);
+    py_bindfunc(mod, "heappop", heapq_heappop);
+    py_bindfunc(mod, "heapreplace", heapq_heapreplace);
+    py_bindfunc(mod, "heappushpop", heapq_heappushpop);
+    py_bindfunc(mod, "heapify", heapq_heapify);
+    py_bind(mod, "nsmallest(n, iterable, key=None)", heapq_nsmallest);
+    py_bind(mod, "nlargest(n, iterable, key=None)", heapq_nlargest);
 }
 
-#undef N
-#undef M
-#undef MATRIX_A
-#undef UPPER_MASK
-#undef LOWER_MASK
-#undef ADD_INST_BOUNDMETHOD
+// src/modules/bisect.c
+// (a, x, lo=0, hi=None, key=None), `x` is compared as is against the keys of `a`
+static bool bisect__search(py_Ref argv, py_Ref x, bool right, int* out) {
+    py_Ref a = py_arg(0);
+    PY_CHECK_ARG_TYPE(2, tp_int);
+    py_i64 lo = py_toint(py_arg(2));
+    if(lo < 0) return ValueError("lo must be non-negative");
+    py_i64 hi;
+    if(py_isnone(py_arg(3))) {
+        if(!py_len(a)) return false;
+        if(!py_checkint(py_retval())) return false;
+        hi = py_toint(py_retval());
+    } else {
+        PY_CHECK_ARG_TYPE(3, tp_int);
+        hi = py_toint(py_arg(3));
+    }
+    py_Ref key = py_isnone(py_arg(4)) ? NULL : py_arg(4);
 
-void py_newRandom(py_OutRef out) {
-    py_Type type = py_gettype("random", py_name("Random"));
-    assert(type != 0);
-    mt19937* ud = py_newobject(out, type, 0, sizeof(mt19937));
-    mt19937__ctor(ud);
+    py_Ref item = py_pushtmp();
+    while(lo < hi) {
+        py_i64 mid = lo + (hi - lo) / 2;
+        py_TValue* data;
+        int length = pk_arrayview(a, &data);
+        if(length != -1) {
+            if(mid >= length) return IndexError("list index out of range");
+            *item = data[mid];
+        } else {
+            py_newint(item, mid);
+            if(!py_getitem(a, item)) return false;
+            *item = *py_retval();
+        }
+        if(key) {
+            if(!py_call(key, 1, item)) return false;
+            *item = *py_retval();
+        }
+        int res = right ? py_less(x, item) : py_less(item, x);
+        if(res == -1) return false;
+        if(res == right) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    py_pop();
+    *out = (int)lo;
+    return true;
 }
 
-void py_Random_seed(py_Ref self, py_i64 seed) {
-    mt19937* ud = py_touserdata(self);
-    mt19937__seed(ud, (uint32_t)seed);
+static bool bisect__insort(py_Ref argv, bool right) {
+    py_Ref x = py_arg(1);
+    if(!py_isnone(py_arg(4))) {
+        if(!py_call(py_arg(4), 1, x)) return false;
+        x = py_pushtmp();
+        *x = *py_retval();
+    }
+    int index;
+    bool ok = bisect__search(argv, x, right, &index);
+    if(x != py_arg(1)) py_pop();
+    if(!ok) return false;
+    py_Ref a = py_arg(0);
+    if(py_istype(a, tp_list)) {
+        c11_vector__insert(py_TValue, (List*)py_touserdata(a), index, *py_arg(1));
+    } else {
+        py_Ref args = py_pushtmp();
+        py_pushtmp();
+        py_newint(&args[0], index);
+        args[1] = *py_arg(1);
+        if(!py_getattr(a, py_name("insert"))) return false;
+        if(!py_call(py_retval(), 2, args)) return false;
+        py_shrink(2);
+    }
+    py_newnone(py_retval());
+    return true;
 }
 
-py_f64 py_Random_random(py_Ref self) {
-    mt19937* ud = py_touserdata(self);
-    return mt19937__random(ud);
+static bool bisect_bisect_left(int argc, py_Ref argv) {
+    int index;
+    if(!bisect__search(argv, py_arg(1), false, &index)) return false;
+    py_newint(py_retval(), index);
+    return true;
 }
 
-py_f64 py_Random_uniform(py_Ref self, py_f64 a, py_f64 b) {
-    mt19937* ud = py_touserdata(self);
-    return mt19937__uniform(ud, a, b);
+static bool bisect_bisect_right(int argc, py_Ref argv) {
+    int index;
+    if(!bisect__search(argv, py_arg(1), true, &index)) return false;
+    py_newint(py_retval(), index);
+    return true;
 }
 
-py_i64 py_Random_randint(py_Ref self, py_i64 a, py_i64 b) {
-    mt19937* ud = py_touserdata(self);
-    if(a > b) { c11__abort("randint(a, b): a must be less than or equal to b"); }
-    return mt19937__randint(ud, a, b);
+static bool bisect_insort_left(int argc, py_Ref argv) { return bisect__insort(argv, false); }
+
+static bool bisect_insort_right(int argc, py_Ref argv) { return bisect__insort(argv, true); }
+
+void pk__add_module_bisect() {
+    py_Ref mod = py_newmodule("bisect");
+
+    py_bind(mod, "bisect_left(a, x, lo=0, hi=None, key=None)", bisect_bisect_left);
+    py_bind(mod, "bisect_right(a, x, lo=0, hi=None, key=None)", bisect_bisect_right);
+    py_bind(mod, "insort_left(a, x, lo=0, hi=None, key=None)", bisect_insort_left);
+    py_bind(mod, "insort_right(a, x, lo=0, hi=None, key=None)", bisect_insort_right);
+    // aliases
+    py_setdict(mod, py_name("bisect"), py_getdict(mod, py_name("bisect_right")));
+    py_setdict(mod, py_name("insort"), py_getdict(mod, py_name("insort_right")));
 }
+
 // src/modules/array2d.c
 #include <limits.h>
 
@@ -27967,6 +33958,454 @@ void py_array2d_setitem(py_Ref self, int x, int y, py_Ref value) {
     c11_array2d* ud = py_touserdata(self);
     c11_array2d__set(ud, x, y, value);
 }
+// src/modules/collections.c
+static void Deque__ctor(Deque* self, int maxlen) {
+    self->capacity = 8;
+    self->data = PK_MALLOC(sizeof(py_TValue) * self->capacity);
+    self->head = 0;
+    self->length = 0;
+    self->maxlen = maxlen;
+    self->state = 0;
+}
+
+static void Deque__dtor(Deque* self) { PK_FREE(self->data); }
+
+static py_TValue* Deque__at(Deque* self, int index) {
+    return &self->data[(self->head + index) & (self->capacity - 1)];
+}
+
+static void Deque__grow(Deque* self) {
+    int capacity = self->capacity * 2;
+    py_TValue* data = PK_MALLOC(sizeof(py_TValue) * capacity);
+    // unwrap the items so they start at slot 0
+    int first = c11__min(self->length, self->capacity - self->head);
+    memcpy(data, self->data + self->head, sizeof(py_TValue) * first);
+    memcpy(data + first, self->data, sizeof(py_TValue) * (self->length - first));
+    PK_FREE(self->data);
+    ManagedHeap__account_buffer(&pk_current_vm->heap, sizeof(py_TValue) * self->capacity);
+    self->data = data;
+    self->capacity = capacity;
+    self->head = 0;
+}
+
+static void Deque__append(Deque* self, py_Ref val) {
+    self->state++;
+    if(self->length == self->maxlen) {
+        if(self->maxlen == 0) return;
+        // evict the leftmost item
+        self->head = (self->head + 1) & (self->capacity - 1);
+        self->length--;
+    }
+    if(self->length == self->capacity) Deque__grow(self);
+    *Deque__at(self, self->length) = *val;
+    self->length++;
+}
+
+static void Deque__appendleft(Deque* self, py_Ref val) {
+    self->state++;
+    if(self->length == self->maxlen) {
+        if(self->maxlen == 0) return;
+        self->length--;  // evict the rightmost item
+    }
+    if(self->length == self->capacity) Deque__grow(self);
+    self->head = (self->head - 1) & (self->capacity - 1);
+    self->data[self->head] = *val;
+    self->length++;
+}
+
+// move the last `n` items to the front, one contiguous run at a time
+static void Deque__rotate_right(Deque* self, int n) {
+    int mask = self->capacity - 1;
+    while(n > 0) {
+        int src_end = (self->head + self->length) & mask;
+        int dst_end = self->head;
+        if(src_end == 0) src_end = self->capacity;
+        if(dst_end == 0) dst_end = self->capacity;
+        int run = c11__min(n, c11__min(src_end, dst_end));
+        memmove(self->data + dst_end - run, self->data + src_end - run, sizeof(py_TValue) * run);
+        self->head = (self->head - run) & mask;
+        n -= run;
+    }
+}
+
+// move the first `n` items to the back, one contiguous run at a time
+static void Deque__rotate_left(Deque* self, int n) {
+    int mask = self->capacity - 1;
+    while(n > 0) {
+        int src = self->head;
+        int dst = (self->head + self->length) & mask;
+        int run = c11__min(n, c11__min(self->capacity - src, self->capacity - dst));
+        memmove(self->data + dst, self->data + src, sizeof(py_TValue) * run);
+        self->head = (self->head + run) & mask;
+        n -= run;
+    }
+}
+
+static int Deque__extend_visit(py_Ref item, void* ctx) {
+    Deque__append(ctx, item);
+    return 1;
+}
+
+static int Deque__extendleft_visit(py_Ref item, void* ctx) {
+    Deque__appendleft(ctx, item);
+    return 1;
+}
+
+static bool Deque__extend(py_Ref self, py_Ref iterable, bool left) {
+    int (*f)(py_Ref, void*) = left ? Deque__extendleft_visit : Deque__extend_visit;
+    if(iterable->is_ptr && iterable->_obj == self->_obj) {
+        // extending a deque with itself, snapshot it first
+        if(!py_tpcall(tp_list, 1, iterable)) return false;
+        py_Ref snapshot = py_pushtmp();
+        *snapshot = *py_retval();
+        bool ok = pk_foreach(snapshot, f, py_touserdata(self)) != -1;
+        py_pop();
+        return ok;
+    }
+    return pk_foreach(iterable, f, py_touserdata(self)) != -1;
+}
+
+static bool Deque__index(Deque* self, py_Ref index, int* out) {
+    if(!py_checkint(index)) return false;
+    py_i64 i = py_toint(index);
+    if(i < 0) i += self->length;
+    if(i < 0 || i >= self->length) return IndexError("deque index out of range");
+    *out = (int)i;
+    return true;
+}
+
+///////////////////////////////
+static bool deque__new__(int argc, py_Ref argv) {
+    // __new__(cls, *args, **kwargs)
+    py_Type cls = py_totype(argv);
+    int slots = cls == tp_deque ? 0 : -1;
+    Deque* ud = py_newobject(py_retval(), cls, slots, sizeof(Deque));
+    Deque__ctor(ud, -1);
+    return true;
+}
+
+static bool deque__init__(int argc, py_Ref argv) {
+    // __init__(self, iterable=None, maxlen=None)
+    Deque* self = py_touserdata(argv);
+    int maxlen = -1;
+    if(!py_isnone(py_arg(2))) {
+        if(!py_checkint(py_arg(2))) return false;
+        py_i64 val = py_toint(py_arg(2));
+        if(val < 0 || val > INT32_MAX) return ValueError("maxlen must be non-negative");
+        maxlen = (int)val;
+    }
+    self->length = 0;
+    self->maxlen = maxlen;
+    self->state++;
+    if(!py_isnone(py_arg(1)) && !Deque__extend(argv, py_arg(1), false)) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque__len__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    py_newint(py_retval(), self->length);
+    return true;
+}
+
+static bool deque__getitem__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Deque* self = py_touserdata(argv);
+    int index;
+    if(!Deque__index(self, py_arg(1), &index)) return false;
+    py_assign(py_retval(), Deque__at(self, index));
+    return true;
+}
+
+static bool deque__setitem__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(3);
+    Deque* self = py_touserdata(argv);
+    int index;
+    if(!Deque__index(self, py_arg(1), &index)) return false;
+    *Deque__at(self, index) = *py_arg(2);
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque__contains__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Deque* self = py_touserdata(argv);
+    uint32_t state = self->state;
+    for(int i = 0; i < self->length; i++) {
+        int res = py_equal(Deque__at(self, i), py_arg(1));
+        if(res == -1) return false;
+        if(self->state != state) return RuntimeError("deque mutated during iteration");
+        if(res) {
+            py_newbool(py_retval(), true);
+            return true;
+        }
+    }
+    py_newbool(py_retval(), false);
+    return true;
+}
+
+static bool deque__iter__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    DequeIterator* ud = py_newobject(py_retval(), tp_deque_iterator, 1, sizeof(DequeIterator));
+    ud->index = 0;
+    ud->state = self->state;
+    py_setslot(py_retval(), 0, argv);
+    return true;
+}
+
+bool deque_iterator__next__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    DequeIterator* ud = py_touserdata(argv);
+    Deque* self = py_touserdata(py_getslot(argv, 0));
+    if(ud->state != self->state) return RuntimeError("deque mutated during iteration");
+    if(ud->index >= self->length) return StopIteration();
+    py_assign(py_retval(), Deque__at(self, ud->index++));
+    return true;
+}
+
+static bool deque__eq__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!py_isinstance(py_arg(1), tp_deque)) {
+        py_newnotimplemented(py_retval());
+        return true;
+    }
+    Deque* self = py_touserdata(argv);
+    Deque* other = py_touserdata(py_arg(1));
+    if(self->length != other->length) {
+        py_newbool(py_retval(), false);
+        return true;
+    }
+    uint32_t state = self->state;
+    uint32_t other_state = other->state;
+    for(int i = 0; i < self->length; i++) {
+        int res = py_equal(Deque__at(self, i), Deque__at(other, i));
+        if(res == -1) return false;
+        if(self->state != state || other->state != other_state) {
+            return RuntimeError("deque mutated during iteration");
+        }
+        if(!res) {
+            py_newbool(py_retval(), false);
+            return true;
+        }
+    }
+    py_newbool(py_retval(), true);
+    return true;
+}
+
+static bool deque__ne__(int argc, py_Ref argv) {
+    if(!deque__eq__(argc, argv)) return false;
+    if(py_isbool(py_retval())) {
+        bool res = py_tobool(py_retval());
+        py_newbool(py_retval(), !res);
+    }
+    return true;
+}
+
+static bool deque__repr__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    c11_sbuf buf;
+    c11_sbuf__ctor(&buf);
+    pk_sprintf(&buf, "%t([", argv->type);
+    uint32_t state = self->state;
+    for(int i = 0; i < self->length; i++) {
+        if(i > 0) c11_sbuf__write_cstr(&buf, ", ");
+        if(!py_repr(Deque__at(self, i))) {
+            c11_sbuf__dtor(&buf);
+            return false;
+        }
+        if(self->state != state) {
+            c11_sbuf__dtor(&buf);
+            return RuntimeError("deque mutated during iteration");
+        }
+        c11_sbuf__write_sv(&buf, py_tosv(py_retval()));
+    }
+    c11_sbuf__write_char(&buf, ']');
+    if(self->maxlen != -1) pk_sprintf(&buf, ", maxlen=%d", self->maxlen);
+    c11_sbuf__write_char(&buf, ')');
+    c11_sbuf__py_submit(&buf, py_retval());
+    return true;
+}
+
+static bool deque__reduce__(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    py_Ref args = py_pushtmp();
+    py_Ref p = py_newtuple(args, 2);
+    py_newlistn(&p[0], self->length);
+    for(int i = 0; i < self->length; i++) {
+        py_list_setitem(&p[0], i, Deque__at(self, i));
+    }
+    if(self->maxlen == -1) {
+        py_newnone(&p[1]);
+    } else {
+        py_newint(&p[1], self->maxlen);
+    }
+    p = py_newtuple(py_retval(), 2);
+    p[0] = *py_tpobject(argv->type);
+    p[1] = *args;
+    py_pop();
+    return true;
+}
+
+static bool deque_maxlen(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    if(self->maxlen == -1) {
+        py_newnone(py_retval());
+    } else {
+        py_newint(py_retval(), self->maxlen);
+    }
+    return true;
+}
+
+static bool deque_append(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Deque__append(py_touserdata(argv), py_arg(1));
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque_appendleft(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Deque__appendleft(py_touserdata(argv), py_arg(1));
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque_pop(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    if(self->length == 0) return IndexError("pop from an empty deque");
+    self->state++;
+    self->length--;
+    py_assign(py_retval(), Deque__at(self, self->length));
+    return true;
+}
+
+static bool deque_popleft(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    if(self->length == 0) return IndexError("pop from an empty deque");
+    self->state++;
+    py_assign(py_retval(), &self->data[self->head]);
+    self->head = (self->head + 1) & (self->capacity - 1);
+    self->length--;
+    return true;
+}
+
+static bool deque_extend(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!Deque__extend(argv, py_arg(1), false)) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque_extendleft(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    if(!Deque__extend(argv, py_arg(1), true)) return false;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque_clear(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    self->state++;
+    self->head = 0;
+    self->length = 0;
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool deque_copy(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    Deque* self = py_touserdata(argv);
+    int slots = argv->type == tp_deque ? 0 : -1;
+    Deque* ud = py_newobject(py_retval(), argv->type, slots, sizeof(Deque));
+    *ud = *self;
+    ud->data = PK_MALLOC(sizeof(py_TValue) * self->capacity);
+    memcpy(ud->data, self->data, sizeof(py_TValue) * self->capacity);
+    ud->state = 0;
+    return true;
+}
+
+static bool deque_count(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(2);
+    Deque* self = py_touserdata(argv);
+    uint32_t state = self->state;
+    int count = 0;
+    for(int i = 0; i < self->length; i++) {
+        int res = py_equal(Deque__at(self, i), py_arg(1));
+        if(res == -1) return false;
+        if(self->state != state) return RuntimeError("deque mutated during iteration");
+        count += res;
+    }
+    py_newint(py_retval(), count);
+    return true;
+}
+
+static bool deque_rotate(int argc, py_Ref argv) {
+    // rotate(self, n=1)
+    PY_CHECK_ARG_TYPE(1, tp_int);
+    Deque* self = py_touserdata(argv);
+    if(self->length > 1) {
+        int n = (int)(py_toint(py_arg(1)) % self->length);
+        if(n < 0) n += self->length;
+        // take the shorter way around
+        if(n <= self->length / 2) {
+            Deque__rotate_right(self, n);
+        } else {
+            Deque__rotate_left(self, self->length - n);
+        }
+        self->state++;
+    }
+    py_newnone(py_retval());
+    return true;
+}
+
+void pk__add_module_collections() {
+    py_GlobalRef mod = py_newmodule("_collections");
+
+    py_Type deque = py_newtype("deque", tp_object, mod, (void (*)(void*))Deque__dtor);
+    assert(deque == tp_deque);
+    py_bind(py_tpobject(deque), "__new__(cls, *args, **kwargs)", deque__new__);
+    py_bind(py_tpobject(deque), "__init__(self, iterable=None, maxlen=None)", deque__init__);
+    py_bindmagic(deque, __len__, deque__len__);
+    py_bindmagic(deque, __getitem__, deque__getitem__);
+    py_bindmagic(deque, __setitem__, deque__setitem__);
+    py_bindmagic(deque, __contains__, deque__contains__);
+    py_bindmagic(deque, __iter__, deque__iter__);
+    py_bindmagic(deque, __eq__, deque__eq__);
+    py_bindmagic(deque, __ne__, deque__ne__);
+    py_bindmagic(deque, __repr__, deque__repr__);
+    py_bindmagic(deque, __reduce__, deque__reduce__);
+    py_bindproperty(deque, "maxlen", deque_maxlen, NULL);
+    py_bindmethod(deque, "append", deque_append);
+    py_bindmethod(deque, "appendleft", deque_appendleft);
+    py_bindmethod(deque, "pop", deque_pop);
+    py_bindmethod(deque, "popleft", deque_popleft);
+    py_bindmethod(deque, "extend", deque_extend);
+    py_bindmethod(deque, "extendleft", deque_extendleft);
+    py_bindmethod(deque, "clear", deque_clear);
+    py_bindmethod(deque, "copy", deque_copy);
+    py_bindmethod(deque, "count", deque_count);
+    py_bind(py_tpobject(deque), "rotate(self, n=1)", deque_rotate);
+    py_setdict(py_tpobject(deque), __hash__, py_None());
+
+    py_Type iterator = py_newtype("deque_iterator", tp_object, mod, NULL);
+    assert(iterator == tp_deque_iterator);
+    py_bindmagic(iterator, __iter__, pk_wrapper__self);
+    py_bindmagic(iterator, __next__, deque_iterator__next__);
+
+    py_Type counter = pk_Counter__register(mod);
+    assert(counter == tp_Counter);
+    py_Type defaultdict = pk_defaultdict__register(mod);
+    assert(defaultdict == tp_defaultdict);
+}
+
 // src/modules/easing.c
 // https://easings.net/
 
@@ -30629,6 +37068,105 @@ static bool gc_collect_hint(int argc, py_Ref argv) {
     return true;
 }
 
+static bool gc_shrink(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(0);
+    ManagedHeap* heap = &pk_current_vm->heap;
+    size_t released = ManagedHeap__shrink(heap);
+    py_newint(py_retval(), (py_i64)released);
+    return true;
+}
+
+static bool gc_set_retained_arenas(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(1);
+    PY_CHECK_ARG_TYPE(0, tp_int);
+    py_i64 n = py_toint(argv);
+    if(n < 0) return ValueError("retained arenas must be non-negative");
+    ManagedHeap* heap = &pk_current_vm->heap;
+    heap->small_objects.retained_arenas = (int)c11__min(n, INT32_MAX);
+    py_newnone(py_retval());
+    return true;
+}
+
+static bool gc_get_retained_arenas(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(0);
+    ManagedHeap* heap = &pk_current_vm->heap;
+    py_newint(py_retval(), heap->small_objects.retained_arenas);
+    return true;
+}
+
+static void gc__stats_timing(py_Ref dict,
+                             const char* key,
+                             int64_t total,
+                             int64_t p50,
+                             int64_t p99,
+                             int64_t max) {
+    py_Ref timing = py_pushtmp();
+    py_newdict(timing);
+    py_newint(py_retval(), total);
+    py_dict_setitem_by_str(timing, "total", py_retval());
+    py_newint(py_retval(), p50);
+    py_dict_setitem_by_str(timing, "p50", py_retval());
+    py_newint(py_retval(), p99);
+    py_dict_setitem_by_str(timing, "p99", py_retval());
+    py_newint(py_retval(), max);
+    py_dict_setitem_by_str(timing, "max", py_retval());
+    py_dict_setitem_by_str(dict, key, timing);
+    py_pop();
+}
+
+static bool gc_get_stats(int argc, py_Ref argv) {
+    PY_CHECK_ARGC(0);
+    py_GCStats stats;
+    py_gc_stats(&stats);
+
+    py_Ref res = py_pushtmp();
+    py_newdict(res);
+#define SET_INT(key, value)                                                                        \
+    py_newint(py_retval(), (value));                                                               \
+    py_dict_setitem_by_str(res, key, py_retval());
+    SET_INT("collections", stats.collections);
+    SET_INT("auto_collections", stats.auto_collections);
+    SET_INT("small_freed", stats.small_freed);
+    SET_INT("large_freed", stats.large_freed);
+    SET_INT("threshold", stats.gc_threshold);
+    SET_INT("threshold_raised", stats.threshold_raised);
+    SET_INT("threshold_lowered", stats.threshold_lowered);
+#undef SET_INT
+    gc__stats_timing(res,
+                     "mark_ns",
+                     stats.mark_ns_total,
+                     stats.mark_ns_p50,
+                     stats.mark_ns_p99,
+                     stats.mark_ns_max);
+    gc__stats_timing(res,
+                     "sweep_ns",
+                     stats.sweep_ns_total,
+                     stats.sweep_ns_p50,
+                     stats.sweep_ns_p99,
+                     stats.sweep_ns_max);
+
+    py_Ref freed = py_pushtmp();
+    py_newdict(freed);
+    int types_length = pk_current_vm->types.length;
+    for(py_Type i = 1; i < types_length; i++) {
+        int64_t count = py_gc_freedcount(i);
+        if(count == 0) continue;
+        py_Ref key = py_pushtmp();
+        py_Ref val = py_pushtmp();
+        py_newint(key, i);
+        py_newint(val, count);
+        bool ok = py_dict_setitem(freed, key, val);
+        py_shrink(2);
+        if(!ok) return false;
+    }
+    py_dict_setitem_by_str(res, "freed_by_type", freed);
+    py_pop();
+
+    py_assign(py_retval(), res);
+    py_pop();
+    return true;
+}
+
 static bool gc_setup_debug_callback(int argc, py_Ref argv) {
     PY_CHECK_ARGC(1);
     ManagedHeap* heap = &pk_current_vm->heap;
@@ -30646,6 +37184,10 @@ void pk__add_module_gc() {
 
     py_bindfunc(mod, "collect", gc_collect);
     py_bindfunc(mod, "collect_hint", gc_collect_hint);
+    py_bindfunc(mod, "shrink", gc_shrink);
+    py_bindfunc(mod, "set_retained_arenas", gc_set_retained_arenas);
+    py_bindfunc(mod, "get_retained_arenas", gc_get_retained_arenas);
+    py_bindfunc(mod, "get_stats", gc_get_stats);
     py_bindfunc(mod, "setup_debug_callback", gc_setup_debug_callback);
 }
 
@@ -32469,7 +39011,7 @@ void CallExpr__emit_(Expr* self_, Ctx* ctx) {
     Opcode opcode = OP_CALL;
     if(vargs || vkwargs) {
         // in this case, there is at least one *args or **kwargs as StarredExpr
-        // OP_CALL_VARGS needs to unpack them via vectorcall_buffer
+        // OP_CALL_VARGS needs to unpack them on the stack
         opcode = OP_CALL_VARGS;
     }
 
@@ -32635,6 +39177,21 @@ static int Ctx__add_name(Ctx* self, py_Name name) {
     return CodeObject__add_name(self->co, name);
 }
 
+// identifier-like literals of program source that do not fit into an inline string
+static bool Ctx__is_internable(Ctx* self, c11_sv key) {
+    // eval(), exec() and json.loads() compile data, which must not fill the name table
+    SourceData_ src = self->co->src;
+    if(src->mode != EXEC_MODE || src->is_dynamic) return false;
+    if(key.size < (int)sizeof(((py_TValue*)NULL)->_chars)) return false;
+    for(int i = 0; i < key.size; i++) {
+        char c = key.data[i];
+        bool ok = c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                  (i > 0 && c >= '0' && c <= '9');
+        if(!ok) return false;
+    }
+    return true;
+}
+
 static int Ctx__add_const_string(Ctx* self, c11_sv key) {
     if(key.size > 100) {
         py_Ref tmp = c11_vector__emplace(&self->co->consts);
@@ -32647,7 +39204,12 @@ static int Ctx__add_const_string(Ctx* self, c11_sv key) {
         return *val;
     } else {
         py_Ref tmp = c11_vector__emplace(&self->co->consts);
-        py_newstrv(tmp, key);
+        if(Ctx__is_internable(self, key)) {
+            // share one heap string with py_name2ref() across code objects
+            *tmp = *py_name2ref(py_namev(key));
+        } else {
+            py_newstrv(tmp, key);
+        }
         int index = self->co->consts.length - 1;
         // dedup
         char* new_buf = PK_MALLOC(key.size + 1);
@@ -0,0 +1,177 @@
+//
+//  BenchmarkTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct BenchmarkTests {
+
+    // MARK: - Values
+
+    // Build once with PK_ENABLE_COMPACT_TVALUE=0 and once with =1 and compare,
+    // running under `perf stat -e cache-misses` for the cache side.
+    @Test(
+        .disabled("Performance benchmark")
+    )
+    func valueRepresentation() {
+        Interpreter.run(valueBenchmark)
+    }
+
+    // MARK: - Strings
+
+    @Test(
+        .disabled("Performance benchmark")
+    )
+    func stringMethods() {
+        Interpreter.run(logLineBenchmark)
+    }
+
+    // MARK: - Dicts
+
+    // Compare builds with PK_ENABLE_SWISS_DICT=1 and =0.
+    @Test(
+        .disabled("Performance benchmark")
+    )
+    func dictTable() {
+        Interpreter.run(dictBenchmark)
+    }
+}
+
+let valueBenchmark = """
+import time
+
+def bench(name, f):
+    t0 = time.perf_counter()
+    r = f()
+    print(name, round((time.perf_counter() - t0) * 1000), 'ms', r)
+
+def list_sum():
+    a = [i * 2 for i in range(1000000)]
+    s = 0
+    for _ in range(5):
+        for x in a:
+            s += x
+    return s
+
+def dict_fill_lookup():
+    d = {}
+    for i in range(300000):
+        d[i] = i + 1
+    s = 0
+    for _ in range(3):
+        for i in range(300000):
+            s += d[i]
+    return s
+
+def float_sort():
+    fl = [float(i) for i in range(500000)]
+    fl.sort(reverse=True)
+    return fl[0]
+
+def nested_lists():
+    rows = [[i, i + 1, i + 2] for i in range(200000)]
+    return sum([r[1] for r in rows])
+
+bench('list_sum', list_sum)
+bench('dict_fill_lookup', dict_fill_lookup)
+bench('float_sort', float_sort)
+bench('nested_lists', nested_lists)
+"""
+
+let logLineBenchmark = """
+import time
+
+levels = ['INFO', 'WARN', 'DEBUG', 'ERROR']
+lines = []
+for i in range(20000):
+    lines.append(
+        '2024-05-17T12:' + str(i % 60) + ':' + str(i % 59) + '.123Z ' + levels[i % 4] +
+        ' [worker-' + str(i % 16) + '] request_id=' + str(i * 7919) +
+        ' path=/api/v1/items/' + str(i) + ' status=' + str(200 + i % 5) +
+        ' latency_ms=' + str(i % 997) +
+        ' user_agent="Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7)"  '
+    )
+text = '\\n'.join(lines)
+
+def bench(name, f):
+    t0 = time.perf_counter()
+    r = f()
+    print(name, round((time.perf_counter() - t0) * 1000), 'ms', r)
+
+bench('find', lambda: sum([ln.find('latency_ms=') for ln in lines]))
+bench('find_miss', lambda: sum([ln.find('timeout_exceeded') for ln in lines]))
+bench('index', lambda: sum([ln.index('status=') for ln in lines]))
+bench('in', lambda: len([ln for ln in lines if 'ERROR' in ln]))
+bench('count', lambda: sum([ln.count('=') for ln in lines]))
+bench('split_sp', lambda: sum([len(ln.split(' ')) for ln in lines]))
+bench('split_ws', lambda: sum([len(ln.split()) for ln in lines]))
+bench('split_kv', lambda: sum([len(ln.split(' status=')) for ln in lines]))
+bench('replace', lambda: len(text.replace('worker-', 'w')))
+bench('strip', lambda: sum([len(ln.strip()) for ln in lines]))
+bench('startswith', lambda: len([ln for ln in lines if ln.startswith('2024-05-17T12:1')]))
+bench('lines', lambda: len(text.split('\\n')))
+bench('find_far', lambda: text.find('request_id=' + str(19999 * 7919)))
+"""
+
+let dictBenchmark = """
+import time
+
+def bench(name, f):
+    t0 = time.perf_counter()
+    r = f()
+    print(name, round((time.perf_counter() - t0) * 1000), 'ms', r)
+
+str_keys = ['key' + str(i) for i in range(100000)]
+
+def insert_int():
+    for _ in range(5):
+        d = {}
+        for i in range(200000):
+            d[i] = i
+    return len(d)
+
+def insert_str():
+    for _ in range(5):
+        d = {}
+        for k in str_keys:
+            d[k] = 0
+    return len(d)
+
+ints = {i: i for i in range(200000)}
+strs = {k: 1 for k in str_keys}
+
+def lookup_hit():
+    total = 0
+    for _ in range(10):
+        for k in str_keys:
+            total += strs[k]
+        for i in range(100000):
+            if i in ints:
+                total += 1
+    return total
+
+def lookup_miss():
+    total = 0
+    for _ in range(10):
+        for i in range(200000, 300000):
+            if i in ints:
+                total += 1
+    return total
+
+def churn():
+    small = {}
+    for _ in range(30):
+        for i in range(20000):
+            small[i & 63] = i
+            small.pop((i + 7) & 63, None)
+    return len(small)
+
+bench('insert_int', insert_int)
+bench('insert_str', insert_str)
+bench('lookup_hit', lookup_hit)
+bench('lookup_miss', lookup_miss)
+bench('churn', churn)
+"""
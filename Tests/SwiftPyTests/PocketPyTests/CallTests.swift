@@ -0,0 +1,42 @@
+//
+//  CallTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct CallTests {
+
+    // MARK: - Unpacking
+
+    @Test func unpackedArgumentsCanExceedTheLocalsLimit() {
+        Interpreter.run("""
+        def unpack_count(*args, **kwargs):
+            return len(args) + len(kwargs)
+
+        def unpack_sum3(a, b, c):
+            return a + b + c
+
+        unpack_fives = [5] * 100
+        unpack_kwargs = {}
+        for i in range(200):
+            unpack_kwargs['k' + str(i)] = i
+        unpack_results = [
+            unpack_count(*list(range(1000))),
+            unpack_count(1, *(1, 2), *unpack_fives, k=1),
+            unpack_count(*unpack_fives[:50], **unpack_kwargs),
+            unpack_sum3(*[1, 2, 3]),
+        ]
+        # the value stack has a fixed size
+        try:
+            unpack_count(*list(range(100000)))
+        except RecursionError:
+            unpack_results.append('recursion')
+        unpack_results.append(unpack_count(*list(range(10))))
+        """)
+
+        #expect(Interpreter.evaluate("unpack_results == [1000, 104, 250, 6, 'recursion', 10]") == true)
+    }
+}
@@ -0,0 +1,48 @@
+//
+//  ClassTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct ClassTests {
+
+    // MARK: - Shapes
+
+    @Test func randomAttributeOrdersFallBackToHashDicts() {
+        Interpreter.run("""
+        import random
+        random.seed(1)
+        shape_names = ['a' + str(i) for i in range(24)]
+
+        class ShapeObj:
+            pass
+
+        shape_objs = []
+        for i in range(20000):
+            o = ShapeObj()
+            order = list(shape_names)
+            random.shuffle(order)
+            expected = {}
+            for j, n in enumerate(order[:random.randint(1, 24)]):
+                setattr(o, n, j)
+                expected[n] = j
+            shape_objs.append((o, expected))
+
+        shape_ok = True
+        for o, expected in shape_objs:
+            shape_ok = shape_ok and len(list(o.__dict__.items())) == len(expected)
+            for k, v in expected.items():
+                shape_ok = shape_ok and getattr(o, k) == v
+        o = shape_objs[-1][0]
+        o.extra = 'x'
+        o.a0 = 0
+        del o.a0
+        shape_ok = shape_ok and o.extra == 'x' and not hasattr(o, 'a0')
+        """)
+
+        #expect(Interpreter.evaluate("shape_ok") == true)
+    }
+}
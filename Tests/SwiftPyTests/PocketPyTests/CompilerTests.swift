@@ -0,0 +1,26 @@
+//
+//  CompilerTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct CompilerTests {
+
+    // MARK: - Constants
+
+    @Test func dataLiteralsAreNotInterned() {
+        Interpreter.run("""
+        import json
+        intern_total = 0
+        for i in range(70000):
+            k = 'json_record_field_name_' + str(i)
+            intern_total += json.loads('{"' + k + '": 1}')[k]
+            intern_total += len(eval('"eval_literal_value_' + str(i) + '"')) > 0
+        """)
+
+        #expect(Interpreter.evaluate("intern_total") == 140000)
+    }
+}
@@ -0,0 +1,81 @@
+//
+//  GCTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct GCTests {
+
+    // MARK: - Arenas
+
+    @Test func decommittedArenasAreReused() {
+        Interpreter.run("""
+        import gc
+        decommit_lists = [[i] for i in range(200000)]
+        del decommit_lists
+        # arenas left empty for a whole cycle release their pages
+        gc.collect()
+        gc.collect()
+        decommit_lists = [[i] for i in range(200000)]
+        decommit_total = sum([x[0] for x in decommit_lists])
+        del decommit_lists
+        gc.collect()
+        """)
+
+        #expect(Interpreter.evaluate("decommit_total") == 19999900000)
+        #expect(Interpreter.evaluate("gc.shrink() >= 0") == true)
+    }
+
+    // MARK: - Exceptions
+
+    @Test func caughtExceptionsSurviveCollection() {
+        Interpreter.run("""
+        import gc
+        def exc_raise_value():
+            return int('x')
+        def exc_gen():
+            yield 1
+            raise KeyError('k')
+        exc_caught = []
+        for i in range(100):
+            try:
+                exc_raise_value()
+            except ValueError as e:
+                exc_caught.append(e)
+            try:
+                {}['missing']
+            except KeyError as e:
+                exc_caught.append(e)
+            try:
+                list(map(lambda x: x, exc_gen()))
+            except KeyError as e:
+                exc_caught.append(e)
+        gc.collect()
+        exc_lists = [[i] for i in range(50000)]
+        gc.collect()
+        exc_count = len(exc_caught) + len(exc_lists)
+        del exc_caught, exc_lists
+        """)
+
+        #expect(Interpreter.evaluate("exc_count") == 50300)
+    }
+
+    // MARK: - Stats
+
+    @Test func freedCountsAreKeyedByTypeId() {
+        Interpreter.run("""
+        import gc
+        stats_lists = [[i] for i in range(1000)]
+        del stats_lists
+        gc.collect()
+        stats_freed = gc.get_stats()['freed_by_type']
+        """)
+
+        let list = Int(PyType.list)
+        #expect(Interpreter.evaluate("all([type(k) is int for k in stats_freed])") == true)
+        #expect(Interpreter.evaluate("stats_freed[\(list)] >= 1000") == true)
+    }
+}
@@ -0,0 +1,130 @@
+//
+//  HeapqTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct HeapqTests {
+
+    // MARK: - heapq
+
+    @Test func heapOperations() {
+        Interpreter.run("""
+        import heapq
+        heap_results = []
+        heap_h = []
+        for x in [5, 1, 8, 3, 9, 2, 7]:
+            heapq.heappush(heap_h, x)
+        heap_results.append(heap_h[0])
+        heap_results.append([heapq.heappop(heap_h) for _ in range(len(heap_h))])
+        heap_a = [9, 4, 7, 1, 8, 2, 2, 6]
+        heapq.heapify(heap_a)
+        heap_results.append(list(heap_a))
+        heap_results.append(heapq.heapreplace(heap_a, 5))
+        heap_results.append(heapq.heappushpop(heap_a, 0))
+        heap_results.append(heapq.heappushpop(heap_a, 10))
+        heap_results.append(list(heap_a))
+        heap_t = []
+        for p in [(2, 'b'), (1, 'z'), (2, 'a'), (0, 'q')]:
+            heapq.heappush(heap_t, p)
+        heap_results.append([heapq.heappop(heap_t) for _ in range(4)])
+        heap_f = [1.5, 0.5, 2.5]
+        heapq.heapify(heap_f)
+        heap_results.append(heapq.heappop(heap_f))
+        try:
+            heapq.heappop([])
+        except IndexError:
+            heap_results.append('empty')
+        """)
+
+        #expect(Interpreter.evaluate("heap_results[:3] == [1, [1, 2, 3, 5, 7, 8, 9], [1, 4, 2, 6, 8, 2, 7, 9]]") == true)
+        #expect(Interpreter.evaluate("heap_results[3:7] == [1, 0, 2, [2, 4, 5, 6, 8, 10, 7, 9]]") == true)
+        #expect(Interpreter.evaluate("heap_results[7:] == [[(0, 'q'), (1, 'z'), (2, 'a'), (2, 'b')], 0.5, 'empty']") == true)
+    }
+
+    @Test func nsmallestAndNlargest() {
+        Interpreter.run("""
+        import heapq
+        """)
+
+        #expect(Interpreter.evaluate("heapq.nsmallest(3, [5, 1, 4, 1, 9, 2]) == [1, 1, 2]") == true)
+        #expect(Interpreter.evaluate("heapq.nlargest(3, [5, 1, 4, 1, 9, 2]) == [9, 5, 4]") == true)
+        #expect(Interpreter.evaluate("heapq.nsmallest(2, ['bb', 'a', 'ccc'], key=len) == ['a', 'bb']") == true)
+        #expect(Interpreter.evaluate("heapq.nlargest(2, ['bb', 'a', 'ccc'], key=len) == ['ccc', 'bb']") == true)
+        #expect(Interpreter.evaluate("heapq.nsmallest(0, [1, 2]) == []") == true)
+        #expect(Interpreter.evaluate("heapq.nlargest(10, [3, 1, 2]) == [3, 2, 1]") == true)
+        #expect(Interpreter.evaluate("heapq.nsmallest(3, iter([3, 1, 2, 0])) == [0, 1, 2]") == true)
+    }
+
+    @Test func comparisonsThatResizeTheHeapRaise() {
+        Interpreter.run("""
+        import heapq
+
+        class HeapClearer:
+            def __init__(self, h, v):
+                self.h = h
+                self.v = v
+            def __lt__(self, other):
+                self.h.clear()
+                return self.v < other.v
+
+        def heap_error(f, reverse):
+            h = []
+            for i in range(5):
+                h.append(HeapClearer(h, 4 - i if reverse else i))
+            try:
+                f(h)
+            except RuntimeError as e:
+                return str(e)
+
+        heap_errors = [
+            heap_error(lambda h: heapq.heappush(h, HeapClearer(h, -1)), False),
+            heap_error(heapq.heappop, False),
+            heap_error(heapq.heapify, True),
+        ]
+        """)
+
+        #expect(Interpreter.evaluate("heap_errors == ['list changed size during iteration'] * 3") == true)
+    }
+
+    // MARK: - bisect
+
+    @Test func bisect() {
+        Interpreter.run("""
+        import bisect
+        bisect_s = [1, 2, 2, 2, 3, 5]
+        bisect_k = [('a', 1), ('b', 3), ('c', 5)]
+        """)
+
+        #expect(Interpreter.evaluate("[bisect.bisect_left(bisect_s, 2), bisect.bisect_right(bisect_s, 2), bisect.bisect(bisect_s, 2)] == [1, 4, 4]") == true)
+        #expect(Interpreter.evaluate("[bisect.bisect_left(bisect_s, 0), bisect.bisect_right(bisect_s, 9), bisect.bisect_left(bisect_s, 4)] == [0, 6, 5]") == true)
+        #expect(Interpreter.evaluate("[bisect.bisect_left(bisect_s, 2, 2), bisect.bisect_right(bisect_s, 2, 0, 3), bisect.bisect_left(bisect_s, 5, 1, 4)] == [2, 3, 4]") == true)
+        #expect(Interpreter.evaluate("[bisect.bisect_left(bisect_k, 3, key=lambda p: p[1]), bisect.bisect_right(bisect_k, 3, key=lambda p: p[1])] == [1, 2]") == true)
+        #expect(Interpreter.evaluate("bisect.bisect_left([1.0, 2.5, 3.0], 2.5)") == 1)
+        #expect(Interpreter.evaluate("bisect.bisect_right(['a', 'c', 'e'], 'd')") == 2)
+    }
+
+    @Test func insort() {
+        Interpreter.run("""
+        import bisect
+        insort_s = [1, 2, 2, 2, 3, 5]
+        bisect.insort(insort_s, 4)
+        bisect.insort_left(insort_s, 2)
+        bisect.insort_right(insort_s, 0)
+        insort_k = [('a', 1), ('c', 5)]
+        bisect.insort(insort_k, ('b', 3), key=lambda p: p[1])
+        insort_error = None
+        try:
+            bisect.bisect_left(insort_s, 1, -1)
+        except ValueError as e:
+            insort_error = str(e)
+        """)
+
+        #expect(Interpreter.evaluate("insort_s == [0, 1, 2, 2, 2, 2, 3, 4, 5]") == true)
+        #expect(Interpreter.evaluate("insort_k == [('a', 1), ('b', 3), ('c', 5)]") == true)
+        #expect(Interpreter.evaluate("insort_error") == "lo must be non-negative")
+    }
+}
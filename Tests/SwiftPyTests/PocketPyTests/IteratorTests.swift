@@ -0,0 +1,103 @@
+//
+//  IteratorTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct IteratorTests {
+
+    // MARK: - Builtins
+
+    @Test func mapFilterZip() {
+        #expect(Interpreter.evaluate("list(map(lambda x: x * 2, [1, 2, 3])) == [2, 4, 6]") == true)
+        #expect(Interpreter.evaluate("list(map(lambda a, b: a + b, [1, 2, 3], (10, 20))) == [11, 22]") == true)
+        #expect(Interpreter.evaluate("list(map(str, range(3))) == ['0', '1', '2']") == true)
+        #expect(Interpreter.evaluate("list(filter(lambda x: x % 2, range(7))) == [1, 3, 5]") == true)
+        #expect(Interpreter.evaluate("list(filter(None, [0, 1, '', 'a', None, [], [0]])) == [1, 'a', [0]]") == true)
+        #expect(Interpreter.evaluate("list(zip([1, 2, 3], 'ab')) == [(1, 'a'), (2, 'b')]") == true)
+        #expect(Interpreter.evaluate("list(zip()) == []") == true)
+        #expect(Interpreter.evaluate("list(zip([1, 2], [3, 4], [5, 6])) == [(1, 3, 5), (2, 4, 6)]") == true)
+        #expect(Interpreter.evaluate("sum(map(lambda x: x * x, filter(lambda x: x > 2, range(6))))") == 50)
+    }
+
+    @Test func enumerate() {
+        #expect(Interpreter.evaluate("list(enumerate('abc')) == [(0, 'a'), (1, 'b'), (2, 'c')]") == true)
+        #expect(Interpreter.evaluate("list(enumerate('abc', 10)) == [(10, 'a'), (11, 'b'), (12, 'c')]") == true)
+        #expect(Interpreter.evaluate("list(enumerate([], 5)) == []") == true)
+    }
+
+    @Test func iteratorsAreSinglePass() {
+        Interpreter.run("""
+        iter_m = map(lambda x: x + 1, [1, 2])
+        iter_results = [next(iter_m), next(iter_m)]
+        try:
+            next(iter_m)
+        except StopIteration:
+            iter_results.append('stop')
+        iter_z = zip([1, 2, 3], [4])
+        iter_results.append(list(iter_z))
+        iter_results.append(list(iter_z))
+        iter_e = enumerate(iter([5, 6]))
+        iter_results.append(next(iter_e))
+        iter_results.append(list(iter_e))
+        iter_it = iter([1, 2, 3, 4])
+        iter_results.append(list(zip(iter_it, iter_it)))
+        iter_results.append(dict(list(zip('ab', range(2)))))
+        iter_results.append(list(map(lambda p: p[0] * p[1], zip(range(4), reversed(range(4))))))
+        """)
+
+        #expect(Interpreter.evaluate("iter_results == [2, 3, 'stop', [(1, 4)], [], (0, 5), [(1, 6)], [(1, 2), (3, 4)], {'a': 0, 'b': 1}, [0, 2, 2, 0]]") == true)
+    }
+
+    // MARK: - reversed
+
+    @Test func reversedSequences() {
+        Interpreter.run("""
+        class ReversedSeq:
+            def __len__(self):
+                return 3
+            def __getitem__(self, i):
+                return i * i
+        """)
+
+        #expect(Interpreter.evaluate("list(reversed([1, 2, 3])) == [3, 2, 1]") == true)
+        #expect(Interpreter.evaluate("list(reversed((1, 2))) == [2, 1]") == true)
+        #expect(Interpreter.evaluate("list(reversed('abc')) == ['c', 'b', 'a']") == true)
+        #expect(Interpreter.evaluate("list(reversed(ReversedSeq())) == [4, 1, 0]") == true)
+    }
+
+    @Test func reversedRanges() {
+        #expect(Interpreter.evaluate("list(reversed(range(5))) == [4, 3, 2, 1, 0]") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(1, 10, 3))) == [7, 4, 1]") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(10, 0, -3))) == [1, 4, 7, 10]") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(10, -11, -7))) == [-4, 3, 10]") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(0, -5, -1))) == [-4, -3, -2, -1, 0]") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(-3, 4, 2))) == [3, 1, -1, -3]") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(5, 5))) == []") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(5, 0))) == []") == true)
+        #expect(Interpreter.evaluate("list(reversed(range(0, 5, -1))) == []") == true)
+    }
+
+    @Test func reversedListSeesShrinking() {
+        Interpreter.run("""
+        rev_seen = []
+        rev_a = [1, 2, 3, 4, 5]
+        for x in reversed(rev_a):
+            rev_seen.append(x)
+            if x == 4:
+                rev_a.clear()
+        rev_grown = []
+        rev_b = [1, 2, 3]
+        for x in reversed(rev_b):
+            rev_grown.append(x)
+            if len(rev_b) < 6:
+                rev_b.append(0)
+        """)
+
+        #expect(Interpreter.evaluate("rev_seen == [5, 4]") == true)
+        #expect(Interpreter.evaluate("rev_grown == [3, 2, 1]") == true)
+    }
+}
@@ -0,0 +1,55 @@
+//
+//  MemoryLimitTests.swift
+//  SwiftPy
+//
+
+import Testing
+@testable import SwiftPy
+
+@MainActor
+struct MemoryLimitTests {
+
+    // MARK: - Repetition
+
+    @Test func repeatedSequencesCheckForOverflow() {
+        Interpreter.run("""
+        mul_errors = []
+        for mul_make in [lambda: [0] * (2 ** 60), lambda: [1, 2, 3] * (2 ** 31), lambda: 'ab' * (2 ** 40)]:
+            try:
+                mul_make()
+            except MemoryError:
+                mul_errors.append(True)
+        """)
+
+        #expect(Interpreter.evaluate("len(mul_errors)") == 3)
+        #expect(Interpreter.evaluate("[1, 2] * 3 == [1, 2, 1, 2, 1, 2]") == true)
+        #expect(Interpreter.evaluate("[1] * 0 == [] and [1] * -2 == [] and 3 * [7] == [7, 7, 7]") == true)
+    }
+
+    // MARK: - Limit
+
+    @Test func nativeLoopsRespectMemoryLimit() {
+        Interpreter.run("""
+        import pkpy
+        limit_makers = [
+            lambda: list(range(10 ** 8)),
+            lambda: set(range(10 ** 8)),
+            lambda: sorted(range(10 ** 8)),
+            lambda: [0] * 10 ** 7,
+            lambda: list(range(10 ** 6)) + list(range(10 ** 6)),
+        ]
+        limit_errors = 0
+        pkpy.set_memory_limit(8 * 1024 * 1024)
+        for limit_make in limit_makers:
+            try:
+                limit_make()
+            except MemoryError:
+                limit_errors += 1
+        pkpy.set_memory_limit(None)
+        limit_after = len(list(range(10 ** 6)))
+        """)
+
+        #expect(Interpreter.evaluate("limit_errors") == 5)
+        #expect(Interpreter.evaluate("limit_after") == 1000000)
+    }
+}